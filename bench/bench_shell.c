@@ -0,0 +1,27 @@
+/*
+    ROAE shell micro-benchmarks
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+*/
+
+// Wrappers of the static kernels of the shell used by idabench.c; the
+// shell is compiled here without its main routine (as done with the
+// sqlite3 shell in ida_sqlite3.c)
+
+#define main roaeshell_main
+#include "shell.c"
+#undef main
+
+// CRC-32 of n bytes, as computed by the shell command "crc32"
+uint32_t bench_shell_crc32(const void *buf, size_t n)
+{
+    static int do_table = 1;
+    if (do_table) {
+        crc32_generate_table(crc32_table);
+        do_table = 0;
+    }
+    return crc32_update(crc32_table, 0, buf, n);
+}
@@ -0,0 +1,64 @@
+/*
+    SIARD library micro-benchmarks
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+*/
+
+// Wrappers of the kernels of libsiardxml.cpp used by idabench.c; they are
+// members of internal classes, so the library source is compiled here
+// (the objects of libsiard2sql.a defining the same symbols are not linked)
+
+#include "libsiardxml.cpp"
+
+using namespace IDA;
+
+extern "C" {
+
+    // Append a file as a BLOB literal X'...'; return the length of the literal
+    unsigned long bench_siard_blob_literal(const char *file)
+    {
+        string s;
+        IDA_siard_utils::file_to_blob_literal_append(file, s);
+        return s.size();
+    }
+
+    // Decode a SIARD-encoded text (\u00XX); return the decoded length
+    long bench_siard_decode(const char *s, unsigned long n)
+    {
+        long size = 0;
+        bool has_specials = false;
+        uint8_t *d = IDA_siard_utils::siard_decode(s, n, size, has_specials);
+        free(d);
+        return size;
+    }
+
+    int bench_siard_has_special(const char *s)
+    {
+        return IDA_siard_utils::has_siard_special_chars(s);
+    }
+
+    // Quote a text as an SQL string literal; return the length of the literal
+    unsigned long bench_siard_quote(const char *s)
+    {
+        return IDA_siard_utils::enclose_sqlite_single_quote(s).size();
+    }
+
+    int bench_siard_type_to_sqlite3(const char *type)
+    {
+        return IDA_siard_utils::siard_type_to_sqlite3(type);
+    }
+
+    // Locate and parse (tinyxml2) the rows of a table<N>.xml in memory;
+    // return the number of rows
+    unsigned long bench_siard_parse_rows(const char *xml, unsigned long n)
+    {
+        IDA_memory_input_stream in(xml, n);
+        IDA_SIARDrow_reader rows;
+        rows.open(&in);
+        while (rows.next_row());
+        return rows.get_nrows();
+    }
+}
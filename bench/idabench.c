@@ -0,0 +1,447 @@
+/*
+    ROAE shell micro-benchmarks
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+*/
+
+// Micro-benchmarks of the hot kernels of the shell and its libraries:
+//
+// - hex encoding of BLOBs (IDA_hex_encode() with each kernel, checked and compared
+//   with the former sprintf("%02x") per byte, and
+//   IDA_siard_utils::file_to_blob_literal_append())
+// - SIARD texts: siard_decode(), has_siard_special_chars() and
+//   enclose_sqlite_single_quote(); siard_type_to_sqlite3()
+// - tinyxml2 parsing of the rows of a table<N>.xml (IDA_SIARDrow_reader)
+// - ROAE commands: eval_param() and bind_param_list() (through the C API)
+// - the CRC-32 of the shell command "crc32", and the regexp.c matcher of "grep"
+//
+// Each benchmark is run until it takes the minimum time, and its ns/op (and
+// MB/s of input for the kernels processing bytes) are printed
+//
+// Usage: idabench [-t seconds] [-j results.json] [name_filter ...]
+//   -t seconds: minimum time of each benchmark (default 0.2)
+//   -j file: also write the results as JSON, to compare them over time
+//   name_filter: run only the benchmarks whose names contain one of these strings
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "siard2sql.h"
+#include "roae.h"
+
+// Wrappers of bench_siard.cpp and bench_shell.c
+unsigned long bench_siard_blob_literal(const char *file);
+long bench_siard_decode(const char *s, unsigned long n);
+int bench_siard_has_special(const char *s);
+unsigned long bench_siard_quote(const char *s);
+int bench_siard_type_to_sqlite3(const char *type);
+unsigned long bench_siard_parse_rows(const char *xml, unsigned long n);
+uint32_t bench_shell_crc32(const void *buf, size_t n);
+
+// regexp.c
+typedef struct regexp regexp;
+extern regexp *regcomp(char *text);
+extern int regexec(regexp *re, char *str, int bol, int ignoreCase);
+extern int find_match(char *haystack, char *needle, int ignoreCase);
+
+typedef unsigned long (*bench_fn)(void *ctx);
+
+typedef struct {
+    char name[64];
+    double ns_op;
+    double mb_s;          // 0 if the benchmark does not process bytes
+    long iters;
+    unsigned long bytes;  // Bytes of input per operation
+} bench_result;
+
+#define MAX_RESULTS 64
+static bench_result results[MAX_RESULTS];
+static int nresults = 0;
+
+static double min_time = 0.2;
+static char **filters = NULL;
+static int nfilters = 0;
+static volatile unsigned long sink; // Keeps the results of the benchmarks alive
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int selected(const char *name)
+{
+    if (!nfilters) return 1;
+    for (int k = 0; k < nfilters; k++) {
+        if (strstr(name, filters[k])) return 1;
+    }
+    return 0;
+}
+
+// Run fn(ctx) doubling the number of iterations until it takes min_time,
+// and report the time per operation ('bytes' of input per operation)
+static void run(const char *name, bench_fn fn, void *ctx, unsigned long bytes)
+{
+    if (!selected(name) || nresults >= MAX_RESULTS) return;
+    long iters = 1;
+    double ns;
+    for (;;) {
+        double t0 = now_ns();
+        for (long i = 0; i < iters; i++) sink += fn(ctx);
+        ns = now_ns() - t0;
+        if (ns >= min_time * 1e9 || iters >= (1L << 40)) break;
+        iters *= (ns < min_time * 1e8) ? 10 : 2;
+    }
+
+    bench_result *r = &results[nresults++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->ns_op = ns / iters;
+    r->mb_s = bytes ? (double) bytes * iters / (ns / 1e9) / 1e6 : 0;
+    r->iters = iters;
+    r->bytes = bytes;
+    if (bytes)
+        printf("%-32s %14.1f ns/op %10.1f MB/s\n", r->name, r->ns_op, r->mb_s);
+    else
+        printf("%-32s %14.1f ns/op\n", r->name, r->ns_op);
+    fflush(stdout);
+}
+
+static int write_json(const char *file)
+{
+    FILE *f = fopen(file, "w");
+    if (!f) {
+        fprintf(stderr, "Error: cannot write '%s'\n", file);
+        return -1;
+    }
+    char date[32];
+    time_t t = time(NULL);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+    fprintf(f, "{\n  \"date\": \"%s\",\n  \"hex_kernel\": \"%s\",\n  \"results\": [", date, IDA_hex_encode_kernel());
+    for (int k = 0; k < nresults; k++) {
+        bench_result *r = &results[k];
+        fprintf(f, "%s\n    {\"name\": \"%s\", \"ns_per_op\": %.3f, \"mb_per_s\": %.3f, \"iterations\": %ld, \"bytes_per_op\": %lu}",
+                k ? "," : "", r->name, r->ns_op, r->mb_s, r->iters, r->bytes);
+    }
+    fprintf(f, "\n  ]\n}\n");
+    return fclose(f) ? -1 : 0;
+}
+
+// Input data
+
+// Random bytes
+static unsigned char *random_bytes(unsigned long n, unsigned seed)
+{
+    unsigned char *p = malloc(n + 1);
+    if (!p) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    srand(seed);
+    for (unsigned long k = 0; k < n; k++) p[k] = rand();
+    p[n] = 0;
+    return p;
+}
+
+// Printable text of n chars with one 'special' string every 'every' chars (0: none)
+static char *text(unsigned long n, const char *special, unsigned long every)
+{
+    char *p = (char *) random_bytes(n, n);
+    for (unsigned long k = 0; k < n; k++) p[k] = 'a' + (unsigned char) p[k] % 26;
+    if (every) {
+        unsigned long len = strlen(special);
+        for (unsigned long k = every / 2; k + len <= n; k += every) memcpy(p + k, special, len);
+    }
+    return p;
+}
+
+// Benchmarks
+
+struct buf_ctx {
+    const void *in;
+    unsigned long n;
+    char *out;
+};
+
+static unsigned long bench_hex(void *ctx)
+{
+    struct buf_ctx *c = ctx;
+    return IDA_hex_encode(c->in, c->n, c->out);
+}
+
+// Former encoding of BLOB literals, with sprintf("%02x") per byte (baseline)
+static unsigned long hex_encode_sprintf(const unsigned char *in, unsigned long n, char *out)
+{
+    for (unsigned long k = 0; k < n; k++) {
+        char uu[3];
+        sprintf(uu, "%02x", in[k]);
+        memcpy(out + 2*k, uu, 2);
+    }
+    return 2*n;
+}
+
+static unsigned long bench_hex_sprintf(void *ctx)
+{
+    struct buf_ctx *c = ctx;
+    return hex_encode_sprintf(c->in, c->n, c->out);
+}
+
+static unsigned long bench_blob_literal(void *ctx)
+{
+    return bench_siard_blob_literal(ctx);
+}
+
+static unsigned long bench_decode(void *ctx)
+{
+    struct buf_ctx *c = ctx;
+    return bench_siard_decode(c->in, c->n);
+}
+
+static unsigned long bench_has_special(void *ctx)
+{
+    return bench_siard_has_special(((struct buf_ctx *) ctx)->in);
+}
+
+static unsigned long bench_quote(void *ctx)
+{
+    return bench_siard_quote(((struct buf_ctx *) ctx)->in);
+}
+
+static const char *siard_types[] = {
+    "INTEGER", "VARCHAR(255)", "DECIMAL(10,2)", "BLOB", "TIMESTAMP", "CLOB(65535)",
+    "BOOLEAN", "DOUBLE PRECISION", "NATIONAL CHARACTER VARYING(50)", "DATE",
+};
+#define NSIARD_TYPES (sizeof(siard_types)/sizeof(siard_types[0]))
+
+static unsigned long bench_type(void *ctx)
+{
+    unsigned long *k = ctx;
+    return bench_siard_type_to_sqlite3(siard_types[(*k)++ % NSIARD_TYPES]);
+}
+
+static unsigned long bench_parse(void *ctx)
+{
+    struct buf_ctx *c = ctx;
+    return bench_siard_parse_rows(c->in, c->n);
+}
+
+static char *roae_values[] = {"1", "2", "'three'", NULL};
+
+static unsigned long bench_roae_eval(void *ctx)
+{
+    (void) ctx;
+    char *s = IDA_ROAE_eval_command(0, NULL, 0, roae_values);
+    unsigned long n = s ? strlen(s) : 0;
+    free(s);
+    return n;
+}
+
+static unsigned long bench_roae_bind(void *ctx)
+{
+    (void) ctx;
+    char **v = IDA_ROAE_command_bind_list(0, roae_values);
+    unsigned long n = 0;
+    for (; v && v[n]; n++) free(v[n]);
+    free(v);
+    return n;
+}
+
+static unsigned long bench_crc32(void *ctx)
+{
+    struct buf_ctx *c = ctx;
+    return bench_shell_crc32(c->in, c->n);
+}
+
+// Match each line of a text, like the shell command "grep"
+struct grep_ctx {
+    char **lines;
+    unsigned long nlines;
+    char *pattern;
+    regexp *re;
+};
+
+static unsigned long bench_grep(void *ctx)
+{
+    struct grep_ctx *c = ctx;
+    unsigned long n = 0;
+    for (unsigned long k = 0; k < c->nlines; k++) {
+        // Both return 0 (TRUE in regexp.c) if the line matches; find_match() compiles
+        // the pattern each time, and regexec() uses the same 'bol' argument
+        int nomatch = c->re ? regexec(c->re, c->lines[k], 1, 0) : find_match(c->lines[k], c->pattern, 0);
+        n += !nomatch;
+    }
+    return n;
+}
+
+// A table<N>.xml with nrows rows of 5 columns
+static char *table_xml(unsigned long nrows, unsigned long *n)
+{
+    unsigned long size = 256 + nrows * 256, len = 0;
+    char *p = malloc(size);
+    if (!p) {
+        fprintf(stderr, "Error: out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    len += sprintf(p + len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<table xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd\" version=\"2.1\">\n");
+    for (unsigned long r = 0; r < nrows; r++) {
+        len += sprintf(p + len, "  <row><c1>%lu</c1><c2>name %lu</c2><c3>2006-02-15T04:34:33Z</c3>"
+                                "<c4>%lu.99</c4><c5>Some text\\u005cwith an escape &amp; entity</c5></row>\n", r, r, r % 100);
+    }
+    len += sprintf(p + len, "</table>\n");
+    *n = len;
+    return p;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *json = NULL;
+    int opt;
+    while ((opt = getopt(argc, argv, "t:j:h")) != -1) {
+        switch (opt) {
+            case 't': min_time = atof(optarg); break;
+            case 'j': json = optarg; break;
+            default:
+                fprintf(stderr, "Usage: %s [-t seconds] [-j results.json] [name_filter ...]\n", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    filters = argv + optind;
+    nfilters = argc - optind;
+
+    printf("Default hex kernel: %s\n", IDA_hex_encode_kernel());
+
+    // Hex encoding with each kernel
+    {
+        static const unsigned long sizes[] = {64, 4096, 1 << 20};
+        static const char *kernels[] = {"scalar", "sse2", "avx2"};
+        unsigned char *in = random_bytes(1 << 20, 1);
+        char *out = malloc(2 << 20);
+        char *ref = malloc(2 << 20);
+        hex_encode_sprintf(in, 1 << 20, ref);
+        for (int s = 0; s < 3; s++) {
+            char name[64];
+            struct buf_ctx c = {in, sizes[s], out};
+            snprintf(name, sizeof(name), "hex/sprintf/%lu", sizes[s]);
+            run(name, bench_hex_sprintf, &c, sizes[s]);
+        }
+        for (int k = 0; k < 3; k++) {
+            if (IDA_hex_encode_select(kernels[k])) continue; // Not supported
+            // Check the kernel against the sprintf encoding before timing it
+            IDA_hex_encode(in, 1 << 20, out);
+            if (memcmp(out, ref, 2 << 20)) {
+                fprintf(stderr, "Error: kernel %s gives a wrong encoding\n", kernels[k]);
+                return EXIT_FAILURE;
+            }
+            for (int s = 0; s < 3; s++) {
+                char name[64];
+                struct buf_ctx c = {in, sizes[s], out};
+                snprintf(name, sizeof(name), "hex/%s/%lu", kernels[k], sizes[s]);
+                run(name, bench_hex, &c, sizes[s]);
+            }
+        }
+        IDA_hex_encode_select(NULL);
+        free(ref);
+
+        // A lob file as a BLOB literal
+        char file[] = "/tmp/idabench_XXXXXX";
+        int fd = mkstemp(file);
+        if (fd >= 0 && write(fd, in, 1 << 20) == (1 << 20)) {
+            close(fd);
+            run("blob_literal/1048576", bench_blob_literal, file, 1 << 20);
+        } else if (fd >= 0) {
+            close(fd);
+        }
+        unlink(file);
+        free(in);
+        free(out);
+    }
+
+    // SIARD texts
+    {
+        unsigned long n = 4096;
+        char *plain = text(n, "", 0);
+        char *special = text(n, "\\u005c", 64);
+        char *quotes = text(n, "'", 64);
+        struct buf_ctx cp = {plain, n, NULL}, cs = {special, n, NULL}, cq = {quotes, n, NULL};
+        run("siard_decode/plain/4096", bench_decode, &cp, n);
+        run("siard_decode/special/4096", bench_decode, &cs, n);
+        run("has_siard_special/4096", bench_has_special, &cp, n);
+        run("quote/plain/4096", bench_quote, &cp, n);
+        run("quote/quotes/4096", bench_quote, &cq, n);
+        unsigned long k = 0;
+        run("siard_type_to_sqlite3", bench_type, &k, 0);
+        free(plain);
+        free(special);
+        free(quotes);
+    }
+
+    // tinyxml2 parsing of table rows
+    {
+        unsigned long n;
+        char *xml = table_xml(10000, &n);
+        struct buf_ctx c = {xml, n, NULL};
+        run("parse_rows/10000", bench_parse, &c, n);
+        free(xml);
+    }
+
+    // ROAE commands
+    {
+        char file[] = "/tmp/idabench_XXXXXX";
+        int fd = mkstemp(file);
+        FILE *f = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (f) {
+            fprintf(f, "Command:\n"
+                       "    title = \"Favourites with some restrictions\"\n"
+                       "    Parameters:\n"
+                       "        dummy1\n"
+                       "        dummy2 - second dummy\n"
+                       "        dummy3 - third dummy\n"
+                       "    Body:\n"
+                       "        SELECT * from favourites where\n"
+                       "                   $${dummy1} >  0\n"
+                       "               or  ($${dummy1} <  $${dummy2}\n"
+                       "                    and $${dummy1} <> $${dummy3});\n");
+            fclose(f);
+            if (IDA_ROAE_load(file) == 1) {
+                run("roae/eval_param", bench_roae_eval, NULL, 0);
+                run("roae/bind_param_list", bench_roae_bind, NULL, 0);
+            }
+            IDA_ROAE_clear();
+        }
+        unlink(file);
+    }
+
+    // Shell: crc32 and grep
+    {
+        unsigned long n = 1 << 16;
+        unsigned char *in = random_bytes(n, 2);
+        struct buf_ctx c = {in, n, NULL};
+        run("crc32/65536", bench_crc32, &c, n);
+        free(in);
+
+        unsigned long nlines = 1000, len = 80;
+        char *txt = text(nlines * len, "", 0);
+        char *lines[1000];
+        for (unsigned long k = 0; k < nlines; k++) {
+            lines[k] = txt + k * len;
+            lines[k][len - 1] = '\0';
+        }
+        char pattern[] = "ab[cd]+e";
+        struct grep_ctx g = {lines, nlines, pattern, NULL};
+        run("grep/find_match/1000x80", bench_grep, &g, nlines * len);
+        g.re = regcomp(pattern);
+        if (g.re) run("grep/regexec/1000x80", bench_grep, &g, nlines * len);
+        free(g.re);
+        free(txt);
+    }
+
+    if (json && write_json(json)) return EXIT_FAILURE;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,219 @@
+/*
+    siard2sql - A library to translate SIARD format
+    to sqlite-compliant SQL
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+*/
+
+// Kernels for the conversion of cell contents to sqlite3 literals:
+//
+// - Hex encoding of BLOB contents, used to build literals X'...': every
+//   byte is written as two lower case hex digits straight into the
+//   output buffer, that must have room for 2*n chars (no '\0' is added).
+// - Scanning of texts looking for the chars that must be processed when
+//   quoting ('\'') or decoding them ('\\' of the SIARD escapes \u00XX).
+//
+// There are three kernels: a scalar one (with a lookup table of the 256
+// digit pairs for hex), and SSE2 (16 bytes/iteration) and AVX2 (32
+// bytes/iteration) ones on x86, that are selected at runtime depending on the cpu.
+
+#include <string.h>
+#include "siard2sql.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && !defined(__ivm64__) && !defined(IDA_NO_SIMD)
+#define IDA_HEX_X86
+#include <immintrin.h>
+#endif
+
+static const char IDA_hex_pairs[513] =
+    "000102030405060708090a0b0c0d0e0f"
+    "101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f"
+    "303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f"
+    "505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f"
+    "707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f"
+    "909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeaf"
+    "b0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecf"
+    "d0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeef"
+    "f0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+static unsigned long IDA_hex_encode_scalar(const unsigned char *in, unsigned long n, char *out)
+{
+    unsigned long k = 0;
+    for (; k + 4 <= n; k += 4) {
+        memcpy(out + 2*k,     IDA_hex_pairs + 2*in[k],     2);
+        memcpy(out + 2*k + 2, IDA_hex_pairs + 2*in[k + 1], 2);
+        memcpy(out + 2*k + 4, IDA_hex_pairs + 2*in[k + 2], 2);
+        memcpy(out + 2*k + 6, IDA_hex_pairs + 2*in[k + 3], 2);
+    }
+    for (; k < n; k++) {
+        memcpy(out + 2*k, IDA_hex_pairs + 2*in[k], 2);
+    }
+    return 2*n;
+}
+
+static unsigned long IDA_find_byte2_scalar(const char *p, unsigned long n, char c1, char c2)
+{
+    unsigned long k = 0;
+    for (; k < n; k++) {
+        if (p[k] == c1 || p[k] == c2) break;
+    }
+    return k;
+}
+
+#ifdef IDA_HEX_X86
+
+// Nibbles (0..15) to ASCII: '0'+x, plus ('a'-'0'-10) if x > 9
+#define IDA_HEX_NIBBLES_TO_ASCII(x, add, cmpgt, vand, set1) \
+    add(add(x, set1('0')), vand(cmpgt(x, set1(9)), set1('a' - '0' - 10)))
+
+__attribute__((target("sse2")))
+static unsigned long IDA_hex_encode_sse2(const unsigned char *in, unsigned long n, char *out)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    unsigned long k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i v  = _mm_loadu_si128((const __m128i *)(in + k));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i lo = _mm_and_si128(v, mask);
+        hi = IDA_HEX_NIBBLES_TO_ASCII(hi, _mm_add_epi8, _mm_cmpgt_epi8, _mm_and_si128, _mm_set1_epi8);
+        lo = IDA_HEX_NIBBLES_TO_ASCII(lo, _mm_add_epi8, _mm_cmpgt_epi8, _mm_and_si128, _mm_set1_epi8);
+        _mm_storeu_si128((__m128i *)(out + 2*k),      _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128((__m128i *)(out + 2*k + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    IDA_hex_encode_scalar(in + k, n - k, out + 2*k);
+    return 2*n;
+}
+
+__attribute__((target("avx2")))
+static unsigned long IDA_hex_encode_avx2(const unsigned char *in, unsigned long n, char *out)
+{
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    unsigned long k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i v  = _mm256_loadu_si256((const __m256i *)(in + k));
+        __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), mask);
+        __m256i lo = _mm256_and_si256(v, mask);
+        hi = IDA_HEX_NIBBLES_TO_ASCII(hi, _mm256_add_epi8, _mm256_cmpgt_epi8, _mm256_and_si256, _mm256_set1_epi8);
+        lo = IDA_HEX_NIBBLES_TO_ASCII(lo, _mm256_add_epi8, _mm256_cmpgt_epi8, _mm256_and_si256, _mm256_set1_epi8);
+        // Unpacking works on each 128-bit lane: a = bytes 0-7|16-23, b = bytes 8-15|24-31
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256((__m256i *)(out + 2*k),      _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256((__m256i *)(out + 2*k + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    IDA_hex_encode_sse2(in + k, n - k, out + 2*k);
+    return 2*n;
+}
+
+__attribute__((target("sse2")))
+static unsigned long IDA_find_byte2_sse2(const char *p, unsigned long n, char c1, char c2)
+{
+    const __m128i v1 = _mm_set1_epi8(c1), v2 = _mm_set1_epi8(c2);
+    unsigned long k = 0;
+    for (; k + 16 <= n; k += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(p + k));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, v1), _mm_cmpeq_epi8(v, v2)));
+        if (m) return k + __builtin_ctz(m);
+    }
+    return k + IDA_find_byte2_scalar(p + k, n - k, c1, c2);
+}
+
+__attribute__((target("avx2")))
+static unsigned long IDA_find_byte2_avx2(const char *p, unsigned long n, char c1, char c2)
+{
+    const __m256i v1 = _mm256_set1_epi8(c1), v2 = _mm256_set1_epi8(c2);
+    unsigned long k = 0;
+    for (; k + 32 <= n; k += 32) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(p + k));
+        unsigned m = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(v, v1), _mm256_cmpeq_epi8(v, v2)));
+        if (m) return k + __builtin_ctz(m);
+    }
+    return k + IDA_find_byte2_sse2(p + k, n - k, c1, c2);
+}
+
+#endif
+
+typedef unsigned long (*IDA_hex_encode_fn)(const unsigned char *in, unsigned long n, char *out);
+typedef unsigned long (*IDA_find_byte2_fn)(const char *p, unsigned long n, char c1, char c2);
+
+static struct {
+    const char *name;
+    IDA_hex_encode_fn fn;
+    IDA_find_byte2_fn find2;
+} IDA_hex_kernels[] = {
+#ifdef IDA_HEX_X86
+    {"avx2", IDA_hex_encode_avx2, IDA_find_byte2_avx2},
+    {"sse2", IDA_hex_encode_sse2, IDA_find_byte2_sse2},
+#endif
+    {"scalar", IDA_hex_encode_scalar, IDA_find_byte2_scalar},
+};
+
+#define IDA_HEX_NKERNELS ((int)(sizeof(IDA_hex_kernels)/sizeof(IDA_hex_kernels[0])))
+
+// Selected kernel (index in IDA_hex_kernels, -1 if not selected yet)
+static volatile int IDA_hex_kernel = -1;
+
+static int IDA_hex_kernel_supported(int k)
+{
+#ifdef IDA_HEX_X86
+    __builtin_cpu_init();
+    if (!strcmp(IDA_hex_kernels[k].name, "avx2"))
+        return __builtin_cpu_supports("avx2");
+    if (!strcmp(IDA_hex_kernels[k].name, "sse2"))
+        return __builtin_cpu_supports("sse2");
+#endif
+    return 1;
+}
+
+// Select the kernel (used both by IDA_hex_encode() and IDA_find_byte2()) by name ("scalar", "sse2", "avx2");
+// with NULL or "" the best one supported by the cpu is selected.
+// Return 0 if ok, -1 if the kernel does not exist or is not supported
+int IDA_hex_encode_select(const char *kernel)
+{
+    for (int k = 0; k < IDA_HEX_NKERNELS; k++) {
+        if (kernel && *kernel && strcmp(kernel, IDA_hex_kernels[k].name))
+            continue;
+        if (IDA_hex_kernel_supported(k)) {
+            IDA_hex_kernel = k;
+            return 0;
+        }
+        if (kernel && *kernel)
+            break;
+    }
+    return -1;
+}
+
+// Name of the kernel used by IDA_hex_encode() and IDA_find_byte2()
+const char *IDA_hex_encode_kernel(void)
+{
+    if (IDA_hex_kernel < 0)
+        IDA_hex_encode_select(NULL);
+    return IDA_hex_kernels[IDA_hex_kernel].name;
+}
+
+// Write the n bytes of in as 2*n hex digits in out.
+// Return the number of chars written (2*n)
+unsigned long IDA_hex_encode(const unsigned char *in, unsigned long n, char *out)
+{
+    if (IDA_hex_kernel < 0)
+        IDA_hex_encode_select(NULL);
+    return IDA_hex_kernels[IDA_hex_kernel].fn(in, n, out);
+}
+
+// Return the position of the first char c1 or c2 in the n chars of p, or n if none
+unsigned long IDA_find_byte2(const char *p, unsigned long n, char c1, char c2)
+{
+    if (IDA_hex_kernel < 0)
+        IDA_hex_encode_select(NULL);
+    return IDA_hex_kernels[IDA_hex_kernel].find2(p, n, c1, c2);
+}
@@ -18,7 +18,19 @@
 
 // Functions to extract zip files defined in thirdparty/zlib/contrib/minizip/miniunz.c
 extern int IDA_miniunz_do_unzip(const char *zipfilename, char *filename);
+extern int IDA_miniunz_do_unzip_parallel(const char *zipfilename, int njobs);
 extern void IDA_minunz_close_all_open_zip();
+extern void *IDA_miniunz_open_entry(const char *zipfilename, const char *filename);
+extern long IDA_miniunz_read_entry(void *uf, char *buf, long len);
+extern int IDA_miniunz_close_entry(void *uf);
+extern long IDA_miniunz_extract_entry_cb(const char *zipfilename, const char *filename,
+                                         int (*fn)(void *ctx, const char *buf, long n), void *ctx);
+extern long IDA_miniunz_extract_entry(const char *zipfilename, const char *filename, char *buf, long size);
+extern void IDA_ZIP_set_persistent_index(int enable);
+extern int IDA_ZIP_digest(const char *zipname, char *hex, int n);
+extern int IDA_miniunz_entry_range(const char *zipfilename, const char *filename,
+                                   unsigned long long *offset, unsigned long long *size);
+extern int IDA_miniunz_entry_info(const char *zipfilename, const char *filename, unsigned long *crc, unsigned long long *size);
 
 // Unzip a (SIARD) zip file (see miniunz.c)
 // If filename != NULL, only this particular file is extracted,
@@ -34,6 +46,13 @@ int IDA_unzip_siard_full(const char* siardfile)
     return IDA_unzip(siardfile, NULL);
 }
 
+// Unzip a full (SIARD) zip file with up to njobs threads, each one inflating
+// and writing a share of the files, split by their compressed size (see ida_miniunz_utils.cpp)
+int IDA_unzip_parallel(const char* siardfile, int njobs)
+{
+    return IDA_miniunz_do_unzip_parallel(siardfile, njobs);
+}
+
 // Extract ONLY header/metadata.xml from a SIARD file (see miniunz.c)
 int IDA_unzip_siard_metadata(const char* siardfile)
 {
@@ -81,7 +100,78 @@ char* IDA_get_siard_version_from_dir(const char* path_to_siard, char* buff, long
         return NULL;
 }
 
+// Open a file inside a (SIARD) zip file to read it sequentially,
+// without extracting it (see ida_miniunz.c)
+// Return NULL if the file cannot be opened
+void *IDA_unzip_open_entry(const char *siardfile, const char *filename)
+{
+    return IDA_miniunz_open_entry(siardfile, filename);
+}
+
+// Read up to n bytes from a file opened with IDA_unzip_open_entry()
+// Return the number of bytes read, 0 at the end, or <0 if error
+long IDA_unzip_read_entry(void *entry, char *buf, long n)
+{
+    return IDA_miniunz_read_entry(entry, buf, n);
+}
+
+// Close a file opened with IDA_unzip_open_entry()
+// Return 0 if OK, or <0 if error (e.g., wrong CRC-32 of a file fully read)
+int IDA_unzip_close_entry(void *entry)
+{
+    return IDA_miniunz_close_entry(entry);
+}
+
+// Inflate a file inside a (SIARD) zip file in memory, without writing it to disk:
+// fn(ctx, buf, n) is called for each chunk of n bytes, and must return 0 to go on (see ida_miniunz.c)
+// Return the number of bytes inflated, or <0 if error
+long IDA_unzip_entry_to_callback(const char *siardfile, const char *filename,
+                                 int (*fn)(void *ctx, const char *buf, long n), void *ctx)
+{
+    return IDA_miniunz_extract_entry_cb(siardfile, filename, fn, ctx);
+}
+
+// Inflate a file inside a (SIARD) zip file into the buffer buf of size bytes
+// Return the number of bytes written, or <0 if error or the file does not fit in buf
+long IDA_unzip_entry_to_buffer(const char *siardfile, const char *filename, char *buf, long size)
+{
+    return IDA_miniunz_extract_entry(siardfile, filename, buf, size);
+}
+
+// Check if a file inside a (SIARD) zip file is stored without compression; if so,
+// set its position and length in the zip file, so that it can be read directly
+// from the zip file (e.g., mapping it in memory) without inflating it
+// Return 0 if stored, 1 if compressed, <0 if error (see ida_miniunz.c)
+int IDA_unzip_entry_range(const char *siardfile, const char *filename,
+                          unsigned long long *offset, unsigned long long *size)
+{
+    return IDA_miniunz_entry_range(siardfile, filename, offset, size);
+}
+
+// Get the CRC-32 and the uncompressed size of a file inside a (SIARD) zip file
+// from its central directory, without extracting it (see ida_miniunz.c)
+// Return 0 if ok, != 0 if the file cannot be found
+int IDA_unzip_entry_info(const char *siardfile, const char *filename, unsigned long *crc, unsigned long long *size)
+{
+    return IDA_miniunz_entry_info(siardfile, filename, crc, size);
+}
+
+// Save the index of the entries of each zip to "<zip>.zidx" when the zip is
+// first opened, and load it from there next times while the zip does not change
+// (see ida_miniunz_utils.cpp); disabled by default
+void IDA_unzip_set_persistent_index(int enable)
+{
+    IDA_ZIP_set_persistent_index(enable);
+}
+
 // Public function to close all indexed (cached) open zip
 void IDA_unzip_close_all(){
     IDA_minunz_close_all_open_zip();
-}
\ No newline at end of file
+}
+// Write to 'digest' (at least 33 chars) a hex digest of the content of a (SIARD) zip
+// file, computed from its central directory (see ida_miniunz_utils.cpp)
+// Return 0 if ok, -1 if the zip cannot be read
+int IDA_unzip_digest(const char *siardfile, char *digest, int n)
+{
+    return IDA_ZIP_digest(siardfile, digest, n);
+}
@@ -20,12 +20,17 @@
 #include <fstream>
 #include <string>
 #include <vector>
+#include <list>
 #include <queue>
+#include <deque>
 #include <set>
 #include <unordered_map>
 #include <regex>
 #include <iterator>
 #include <algorithm>
+#include <memory>
+#include <functional>
+#include <chrono>
 
 #include <cstdio>
 #include <cstdarg>
@@ -44,7 +49,31 @@
 #include <libgen.h>
 #include <cassert>
 
+// The catalog cache (see IDA_SIARDcatalog) is mapped in memory, but on ivm64
+#ifndef __ivm64__
+#define IDA_HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+// Tables can be converted in parallel by a pool of threads (see IDA_SIARDtable_pool)
+// Threads are not available on ivm64
+#if !defined(__ivm64__) && !defined(IDA_NO_THREADS)
+#define IDA_THREADS
+#endif
+
+#ifdef IDA_THREADS
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+// Serialize the code changing the working directory or using the table of open zips
+#define IDA_ZIP_LOCK std::lock_guard<std::recursive_mutex> ida_zip_lock_(IDA::IDA_file_utils::zip_mutex)
+#else
+#define IDA_ZIP_LOCK
+#endif
+
 #include "tinyxml2.h"
+#include "sqlite3.h"
 #include "siard2sql.h"
 
 #if !defined(_GNU_SOURCE)
@@ -154,6 +183,12 @@ namespace IDA {
 
             enum SQLITE_COLTYPES ret;
 
+        #ifdef IDA_THREADS
+            // Tables converted in parallel share the cache
+            static std::mutex typecache_mutex;
+            std::lock_guard<std::mutex> typecache_lock(typecache_mutex);
+        #endif
+
             try {
                 // First check the type cache
                 ret = typecache.at(s);
@@ -181,32 +216,34 @@ namespace IDA {
             return ret;
         }
 
+        // Append the hex digits of a uint_8 array to the string s,
+        // encoding them in place after growing s (see libsiardhex.c)
+        static void hex_append(const uint8_t *a, unsigned long size, string &s)
+        {
+            unsigned long pos = s.size();
+            s.resize(pos + 2*size);
+            IDA_hex_encode(a, size, &s[pos]);
+        }
+
         // Convert a string to a sqlite3 BLOB hex literal
         // "SOS" -> "X'534f53'"
         static string string_to_blob_literal(const string &s)
         {
-            std::ostringstream ss;
-            ss << "X'";
-            for (unsigned long k=0; k<s.size(); k++){
-               ss << setfill('0') << setw(2) << hex << (unsigned long)(unsigned char)s[k];
-            }
-            ss << "'";
-            return ss.str();
+            string lit;
+            lit.reserve(2*s.size() + 3);
+            lit.append("X'");
+            hex_append((const uint8_t *)s.data(), s.size(), lit);
+            lit.append("'");
+            return lit;
         }
 
         // Convert a uint_8 array (may include NULLs) to a sqlite3 BLOB hex literal
         // "SOS\0" -> "X'534f5300'"
         static string char_array_to_blob_literal(const uint8_t *s, unsigned long size)
         {
-            std::ostringstream ss;
-            ss << "X'";
-            if (s) {
-                for (unsigned long k = 0; k < size; k++) {
-                    ss << setfill('0') << setw(2) << hex << (unsigned long) (uint8_t) s[k];
-                }
-            }
-            ss << "'";
-            return ss.str();
+            string lit;
+            char_array_to_blob_literal_append(s, size, lit);
+            return lit;
         }
 
         // Convert a uint_8 array (may include NULLs) to a sqlite3 BLOB hex literal
@@ -214,13 +251,10 @@ namespace IDA {
         // "SOS\0" -> "X'534f5300'"
         static void char_array_to_blob_literal_append(const uint8_t *a, unsigned long size, string &s)
         {
+            s.reserve(s.size() + (a ? 2*size : 0) + 3);
             s.append("X'");
             if (a) {
-                for (unsigned long k = 0; k < size; k++) {
-                    char uu[3];
-                    sprintf(uu, "%02x", (uint8_t)a[k]);
-                    s.append(uu);
-                }
+                hex_append(a, size, s);
             }
             s.append("'");
             return;
@@ -231,95 +265,101 @@ namespace IDA {
         // Convert the content of a file to a sqlite3 BLOB hex literal
         // "SOS" -> "X'534f53'"
         static string file_to_blob_literal(const string &file)
+        {
+            string lit;
+            file_to_blob_literal_append(file, lit);
+            return lit;
+        }
+
+        // Convert the content of a file to a sqlite3 BLOB hex literal
+        // appending it to the string s
+        // "SOS" -> "X'534f53'"
+        // Return false if the file cannot be opened
+        static bool file_to_blob_literal_append(const string &file, string &s)
         {
             unsigned char buf[FILE_BLOB_BUFF_SIZE]; // This MUST be unsigned
             FILE *f = fopen(file.c_str(), "r");
             if (!f) {
                 cerr << "Error: opening '" << file << "' (notice: perhaps external file)" << endl;
-                return "X''";
+                s.append("X''");
+                return false;
+            }
+            // Reserve the whole literal at once, so that s is not reallocated
+            // while appending each chunk
+            struct stat st;
+            if (fstat(fileno(f), &st) == 0 && st.st_size > 0) {
+                s.reserve(s.size() + 2*(unsigned long)st.st_size + 3);
             }
-            std::ostringstream ss;
-            ss << "X'";
+            s.append("X'");
             long n;
             while ((n = fread(buf, 1, FILE_BLOB_BUFF_SIZE, f )) > 0) {
-                for (long k=0; k<n; k++){
-                    char uu[3];
-                    sprintf(uu, "%02x", (unsigned char)buf[k]);
-                    ss << uu;
-                    //ss << setfill('0') << setw(2) << hex << (unsigned long)(unsigned char)buf[k];
-                }
+                hex_append(buf, n, s);
             }
             fclose(f);
-            ss << "'";
-            return ss.str();
+            s.append("'");
+            return true;
         }
 
-        // Convert the content of a file to a sqlite3 BLOB hex literal
-        // appending it to the string s
-        // "SOS" -> "X'534f53'"
-        static void file_to_blob_literal_append(const string &file, string &s)
+        // Append the raw content of a file to the string s (no hex encoding),
+        // as needed when binding a lob to a sqlite3 statement
+        // Return false if the file cannot be opened
+        static bool file_to_string_append(const string &file, string &s)
         {
-            unsigned char buf[FILE_BLOB_BUFF_SIZE]; // This MUST be unsigned
+            char buf[FILE_BLOB_BUFF_SIZE];
             FILE *f = fopen(file.c_str(), "r");
             if (!f) {
                 cerr << "Error: opening '" << file << "' (notice: perhaps external file)" << endl;
-                s.append("X''");
-                return;
+                return false;
             }
-            s.append("X'");
-            long n, n4;
-            std::ostringstream ss;
-            while ((n = fread(buf, 1, FILE_BLOB_BUFF_SIZE, f )) > 0) {
-                n4 = n/4;
-                for (long k=0; k<n4; k++){
-                    char uu[2*4+1];
-                    sprintf(uu, "%02x%02x%02x%02x",
-                                           (unsigned char)buf[k*4], (unsigned char)buf[k*4+1],
-                                           (unsigned char)buf[k*4+2], (unsigned char)buf[k*4+3]);
-                    s.append(uu);
-                    //ss << setfill('0') << setw(2) << hex << (unsigned long)(unsigned char)buf[k];
-                }
-                for (long k=n4*4; k<n; k++){
-                    char uu[3];
-                    sprintf(uu, "%02x", (unsigned char)buf[k]);
-                    s.append(uu);
-                    //ss << setfill('0') << setw(2) << hex << (unsigned long)(unsigned char)buf[k];
-                }
-
-                //-- ss.str(string()); // Clear stringstream
-                //-- for (long k=0; k<n; k++){
-                //--     ss << setfill('0') << setw(2) << hex << (unsigned long)(unsigned char)buf[k];
-                //-- }
-                //-- s.append(ss.str());
-                //-- FREE_ALLOCA();
+            long n;
+            while ((n = fread(buf, 1, FILE_BLOB_BUFF_SIZE, f)) > 0) {
+                s.append(buf, n);
             }
             fclose(f);
-            s.append("'");
+            return true;
         }
 
         // Enclose string in single quotes by escaping
         // the existing single quotes, in order to use the
         // input string in sqlite
         // Escaping ' in sqlite is doubling it: ''
-        static string enclose_sqlite_single_quote(string s){
-            static regex e("'");
-            return "'" + regex_replace(s, e, "''") + "'";
+        static string enclose_sqlite_single_quote(const string &s){
+            string q;
+            q.reserve(s.size() + 2);
+            q.push_back('\'');
+            for (unsigned long i = 0, k; i < s.size(); i = k + 1) {
+                k = i + IDA_find_byte2(s.data() + i, s.size() - i, '\'', '\'');
+                q.append(s, i, k - i);
+                if (k < s.size()) q.append("''");
+            }
+            q.push_back('\'');
+            return q;
         }
 
         #define siard_special(s) (!strncmp(s, "\\u00", 4))
 
+        // Return the first SIARD special char "\u00" in the n chars of s, or NULL if none
+        static const char *find_siard_special(const char *s, unsigned long n){
+            const char *end = s + n;
+            while ((s = (const char *)memchr(s, '\\', end - s))) {
+                if (end - s >= 4 && siard_special(s)) return s;
+                s++;
+            }
+            return NULL;
+        }
+
+        // Decoded value of the SIARD special char starting at s ("\u00XX"),
+        // with n chars available (it may be truncated at the end of the text)
+        static uint8_t siard_special_value(const char *s, unsigned long n){
+            char hex[5] = {0};
+            for (unsigned long j = 0; j < 4 && j + 2 < n; j++) hex[j] = s[j + 2];
+            return (uint8_t) strtol(hex, NULL, 16);
+        }
+
         //  Return true if a SIARD coded string has "special" chars, of the form \u005c,
         //  and consequently it needs to be decoded
         static bool has_siard_special_chars(const string &siard_str){
-            bool has_specials = false;
-            const char *s_encod = siard_str.c_str();
-            for (unsigned long i = 0; i < strlen(s_encod); i++) {
-                if (siard_special(&s_encod[i])) {
-                    has_specials = true;
-                    break;
-                }
-            }
-            return has_specials;
+            return find_siard_special(siard_str.c_str(), strlen(siard_str.c_str())) != NULL;
         }
 
         //  Decode a SIARD coded string allocating the decoded form in an
@@ -351,29 +391,82 @@ namespace IDA {
         //
         // Notice that XML entities are already decoded by the XML parser (tinyxml2)
         static uint8_t* siard_decode(const string &siard_str, long &size, bool &has_specials){
+            return siard_decode(siard_str.c_str(), strlen(siard_str.c_str()), size, has_specials);
+        }
+        // Version for the n chars of a C string
+        static uint8_t* siard_decode(const char *s_encod, unsigned long n, long &size, bool &has_specials){
             has_specials = false;
             size = 0;
-            if (siard_str.empty()){
+            if (n == 0){
                 return NULL;
             }
-            const char *s_encod = siard_str.c_str();
-            uint8_t *s_decod = (uint8_t*) malloc(strlen(s_encod) * sizeof(char));
+            uint8_t *s_decod = (uint8_t*) malloc(n * sizeof(char));
             if (s_decod) {
-                for (unsigned long i = 0; i < strlen(s_encod); i++) {
-                    if (siard_special(&s_encod[i])) {
-                        has_specials = true;
-                        char hex[5] = {s_encod[i + 2], s_encod[i + 3], s_encod[i + 4], s_encod[i + 5], '\0'};
-                        unsigned char val = strtol(hex, NULL, 16);
-                        s_decod[size++] = val;
-                        i += 5;
-                    } else {
-                        s_decod[size++] = s_encod[i];
-                    }
+                // Copy the chars between special chars as a whole
+                unsigned long i = 0;
+                const char *sp;
+                while ((sp = find_siard_special(s_encod + i, n - i))) {
+                    has_specials = true;
+                    unsigned long k = sp - s_encod;
+                    memcpy(s_decod + size, s_encod + i, k - i);
+                    size += k - i;
+                    s_decod[size++] = siard_special_value(sp, n - k);
+                    i = min(k + 6, n);
                 }
+                memcpy(s_decod + size, s_encod + i, n - i);
+                size += n - i;
             }
             return s_decod;
         }
 
+        // Append a SIARD coded text to the string s as a sqlite3 literal in a single pass:
+        // the text enclosed in single quotes (doubling the existing ones) if it has no
+        // special chars (\u00XX); otherwise, as the decoded text may have char(0), its
+        // decoded bytes as a blob cast to text: CAST(X'...' AS TEXT)
+        static void siard_text_to_sql_literal_append(const char *t, unsigned long n, string &s){
+            unsigned long start = s.size();
+            s.reserve(start + n + 2);
+            s.push_back('\'');
+            for (unsigned long i = 0, k; i < n; i = k + 1) {
+                k = i + IDA_find_byte2(t + i, n - i, '\'', '\\');
+                s.append(t + i, k - i);
+                if (k == n) break;
+                if (t[k] == '\'') {
+                    s.append("''");
+                } else if (n - k >= 4 && siard_special(t + k)) {
+                    // Start again as a blob; the text before k needs no decoding
+                    s.resize(start);
+                    siard_text_to_blob_literal_append(t, n, k, s);
+                    return;
+                } else {
+                    s.push_back('\\');
+                }
+            }
+            s.push_back('\'');
+        }
+
+        // Append CAST(X'...' AS TEXT) with the decoded bytes of a SIARD coded text
+        // of n chars whose first special char is at position k, hex encoding the
+        // chars straight into s, without an intermediate decoded copy
+        static void siard_text_to_blob_literal_append(const char *t, unsigned long n, unsigned long k, string &s){
+            s.append("CAST(X'");
+            unsigned long pos = s.size();
+            s.resize(pos + 2*n); // The decoded text is not longer than the coded one
+            char *out = &s[pos];
+            unsigned long i = 0;
+            while (true) {
+                out += IDA_hex_encode((const unsigned char *)t + i, k - i, out);
+                if (k >= n) break;
+                uint8_t val = siard_special_value(t + k, n - k);
+                out += IDA_hex_encode(&val, 1, out);
+                i = min(k + 6, n);
+                const char *sp = find_siard_special(t + i, n - i);
+                k = sp ? sp - t : n;
+            }
+            s.resize(out - &s[0]);
+            s.append("' AS TEXT)");
+        }
+
     }; /* class IDA_siard_utils */
 
     // Some useful methods to use when parsing
@@ -400,6 +493,11 @@ namespace IDA {
             return rtrim(ltrim(s));
         }
 
+        static string to_lower(string s){
+            for (char &c: s) c = tolower((unsigned char) c);
+            return s;
+        }
+
         // Return a never-matching regex in case a regex expression is not valid
         // to avoid throwing an exception
         static const char* validate_regex(const char *s) {
@@ -488,6 +586,12 @@ namespace IDA {
 
         static stack<string> dirstack;
 
+    #ifdef IDA_THREADS
+        // Lock for the operations that change the current directory (pushd/popd) or that
+        // access the zips opened by minizip, when several tables are converted in parallel
+        static std::recursive_mutex zip_mutex;
+    #endif
+
         static int pushd(string dir)
         {
             char cwd[PATH_MAX];
@@ -607,6 +711,14 @@ namespace IDA {
             return S_ISDIR(s.st_mode);
         }
 
+        static bool is_regular_file(const string &path)
+        {
+            struct stat s;
+            if (::stat(path.c_str(), &s) != 0)
+                return false;
+            return S_ISREG(s.st_mode);
+        }
+
         // Get and optionally print the free space over the heap (until the top of stack)
         // For debugging purposes
         static unsigned long freeheap(int print=0)
@@ -864,6 +976,7 @@ namespace IDA {
 
             //zips[0] = IDA_file_utils::get_realpath(zips[0]); // Use realpath because pushd is done later
 
+            IDA_ZIP_LOCK;
             if (tmpdir.empty()) tmpdir = create_temp_dir();
             if (IDA_file_utils::pushd(tmpdir)) {
                 // Error pushd, return the path itself
@@ -904,8 +1017,207 @@ namespace IDA {
 
         }
 
+        // Read exactly n bytes from fd into p
+        // Return false if error or the end of the file is reached before
+        static bool read_all(int fd, char *p, unsigned long n)
+        {
+            while (n > 0) {
+                long r = read(fd, p, n);
+                if (r <= 0) return false;
+                p += r; n -= r;
+            }
+            return true;
+        }
+
     }; /* class IDA_file_utils */
     stack<string> IDA_file_utils::dirstack = {};
+#ifdef IDA_THREADS
+    std::recursive_mutex IDA_file_utils::zip_mutex;
+#endif
+
+    // A minimal input stream to read data sequentially, so that
+    // parsers do not depend on where the data come from
+    class IDA_input_stream {
+    public:
+        virtual ~IDA_input_stream() {}
+
+        // Read up to n bytes into buf
+        // Return the number of bytes read, 0 at the end of the stream, or <0 if error
+        virtual long read(char *buf, long n) = 0;
+
+        // If the whole content of the stream is already in memory, return a pointer to it
+        // and set n to its length (the stream is not consumed); otherwise return NULL
+        virtual const char *data(unsigned long &) { return NULL; }
+    };
+
+    // Input stream reading a buffer in memory (not owned by the stream)
+    class IDA_memory_input_stream : public IDA_input_stream {
+        const char *p;
+        unsigned long size, pos = 0;
+    public:
+        IDA_memory_input_stream(const char *p, unsigned long size) : p(p), size(size) {}
+
+        long read(char *buf, long n) override
+        {
+            if (n < 0) return -1;
+            if ((unsigned long) n > size - pos) n = size - pos;
+            memcpy(buf, p + pos, n);
+            pos += n;
+            return n;
+        }
+
+        const char *data(unsigned long &n) override
+        {
+            n = size;
+            return p;
+        }
+    };
+
+    // A whole file mapped read-only in memory (e.g., a .siard file, so that files
+    // stored in it without compression can be used without copying them)
+    // Not available without mmap() (e.g., on ivm64): then open() always fails
+    class IDA_mapped_file {
+        const char *base = NULL;
+        unsigned long size = 0;
+    public:
+        IDA_mapped_file() {}
+        IDA_mapped_file(const IDA_mapped_file&) = delete;
+        IDA_mapped_file &operator=(const IDA_mapped_file&) = delete;
+
+        ~IDA_mapped_file()
+        {
+            close();
+        }
+
+        // Return 0 if OK, -1 if the file cannot be mapped
+        int open(const string &filename)
+        {
+            close();
+        #ifdef IDA_HAVE_MMAP
+            int fd = ::open(filename.c_str(), O_RDONLY);
+            if (fd < 0) return -1;
+            struct stat st;
+            if (fstat(fd, &st) || st.st_size <= 0) {
+                ::close(fd);
+                return -1;
+            }
+            void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            ::close(fd);
+            if (m == MAP_FAILED) return -1;
+            base = (const char*) m;
+            size = st.st_size;
+            return 0;
+        #else
+            return -1;
+        #endif
+        }
+
+        void close()
+        {
+        #ifdef IDA_HAVE_MMAP
+            if (base) munmap((void*) base, size);
+        #endif
+            base = NULL;
+            size = 0;
+        }
+
+        bool is_open() const { return base != NULL; }
+
+        // Pointer to the n bytes at 'offset', or NULL if out of the file
+        const char *range(unsigned long long offset, unsigned long long n) const
+        {
+            if (!base || offset > size || n > size - offset) return NULL;
+            return base + offset;
+        }
+    };
+
+    // Input stream reading a regular file
+    class IDA_file_input_stream : public IDA_input_stream {
+        FILE *f = NULL;
+    public:
+        IDA_file_input_stream() {}
+
+        ~IDA_file_input_stream()
+        {
+            close();
+        }
+
+        // Return 0 if OK, -1 if the file cannot be opened
+        int open(const string &filename)
+        {
+            close();
+            f = fopen(filename.c_str(), "r");
+            return f ? 0 : -1;
+        }
+
+        void close()
+        {
+            if (f) fclose(f);
+            f = NULL;
+        }
+
+        long read(char *buf, long n) override
+        {
+            if (!f) return -1;
+            long r = fread(buf, 1, n, f);
+            if (r == 0 && ferror(f)) return -1;
+            return r;
+        }
+    };
+
+    // Input stream reading a file stored inside a zip (e.g., a .siard file),
+    // inflating it on the fly instead of extracting it to a temporary file
+    class IDA_zip_entry_input_stream : public IDA_input_stream {
+        void *entry = NULL;
+        string name;       // Path of the file inside the zip
+        bool done = false; // Fully read, and its CRC-32 checked
+    public:
+        IDA_zip_entry_input_stream() {}
+
+        ~IDA_zip_entry_input_stream()
+        {
+            close();
+        }
+
+        // Open the file 'filename' (path inside the zip) of the zip file 'zipfile'
+        // Return 0 if OK, -1 if the file cannot be opened
+        int open(const string &zipfile, const string &filename)
+        {
+            close();
+            IDA_ZIP_LOCK;
+            entry = IDA_unzip_open_entry(zipfile.c_str(), filename.c_str());
+            name = filename;
+            done = false;
+            return entry ? 0 : -1;
+        }
+
+        // Return 0 if OK, or <0 if error (e.g., wrong CRC-32 of the file fully read)
+        int close()
+        {
+            IDA_ZIP_LOCK;
+            int err = entry ? IDA_unzip_close_entry(entry) : 0;
+            entry = NULL;
+            return err;
+        }
+
+        // The CRC-32 is checked at the end of the file: a mismatch is returned as
+        // an error instead of the end of the stream
+        long read(char *buf, long n) override
+        {
+            if (done) return 0;
+            if (!entry) return -1;
+            long r = IDA_unzip_read_entry(entry, buf, n);
+            if (r == 0) {
+                int err = close();
+                if (err) {
+                    cerr << "Error: '" << name << "' is corrupted in the zip (error " << err << ")" << endl;
+                    return err;
+                }
+                done = true;
+            }
+            return r;
+        }
+    };
 
     // Some useful methods to use when processing XML
     class IDA_xml_utils {
@@ -998,15 +1310,15 @@ namespace IDA {
                     v.push_back(pe);
                 }
 
-                while (!v.empty()) {
-                    XMLElement *pe = v[0];
+                // v is used as a queue, whose head is v[head]
+                for (unsigned long head = 0; head < v.size(); head++) {
+                    XMLElement *pe = v[head];
                     if (!tagname.compare(pe->Name())) {
                         return pe;
                     }
                     for (XMLElement *ce = pe->FirstChildElement(); ce; ce = ce->NextSiblingElement()) {
                         v.push_back(ce);
                     }
-                    v.erase(v.begin());
                 }
             }
             return NULL;
@@ -1039,6 +1351,32 @@ namespace IDA {
             }
         }
 
+        // Get the numbered children of an element in one pass: elems[k] is set to the first
+        // child tagged "<prefix><k+1>" (numbers start at 1), or NULL if it is missing (e.g.,
+        // it is null); the numeric suffix of the tag is parsed directly
+        static void get_numbered_children(XMLElement *pElem, char prefix, vector<XMLElement*> &elems)
+        {
+            std::fill(elems.begin(), elems.end(), (XMLElement*)NULL);
+            if (!pElem) return;
+            for (XMLElement *pe=pElem->FirstChildElement(); pe; pe = pe->NextSiblingElement()) {
+                const char *name = pe->Name();
+                if (name[0] != prefix || name[1] < '1' || name[1] > '9') continue;
+                unsigned long k = 0;
+                const char *d = name + 1;
+                for (; *d >= '0' && *d <= '9' && k <= elems.size(); d++) {
+                    k = 10*k + (*d - '0');
+                }
+                if (*d || k > elems.size()) continue;
+                if (!elems[k-1]) elems[k-1] = pe;
+            }
+        }
+
+        // Get the columns of a SIARD row: cols[k] is the element <c{k+1}>
+        static void get_row_columns(XMLElement *row, vector<XMLElement*> &cols)
+        {
+            get_numbered_children(row, 'c', cols);
+        }
+
         // Return the text of the first element found matching the tag name
         // If not found, empty string is returned
         static string find_elementText_by_tag(XMLElement *pElem, const string &tagname,
@@ -1369,7 +1707,7 @@ namespace IDA {
             attribute_list.clear();
         }
 
-        bool empty(){
+        bool empty() const {
             return name.empty();
         }
 
@@ -1463,6 +1801,29 @@ namespace IDA {
         return out;
     }
 
+    // A node of the decoding plan of a complex data type (see IDA_SIARDtype_plan)
+    struct IDA_SIARDtype_plan_node {
+        enum kind_e {SIMPLE, ARRAY, DISTINCT, UDT, INTERPRETED, NONE} kind = NONE;
+        enum IDA_siard_utils::SQLITE_COLTYPES simpletype = IDA_siard_utils::COLTYPE_TEXT; // SIMPLE
+        long depth = 0;
+        string treepath;                 // Path of the element, to look for its lob folder
+        char tag_prefix = 0;             // Tags of the children: 'a' (<a1>...) or 'u' (<u1>...)
+        vector<unsigned long> children;  // Plan nodes of the children (elements <a1>,... or <u1>,...)
+        vector<string> prefixes;         // Text written before each child (indent and udt attribute name)
+        string type_schema, type_name;   // INTERPRETED
+    };
+
+    // The decoding plan of a complex data type (udt, array, distinct) of a column:
+    // the type tree is flattened once per table, with the tags of the children, the
+    // attribute names and the tree paths already computed, and then it is run for
+    // each cell; node 0 is the root
+    struct IDA_SIARDtype_plan : public vector<IDA_SIARDtype_plan_node> {
+        // Nested types deeper than this, or beyond this number of nodes (e.g., recursive
+        // types), are interpreted when converting each cell
+        static const long MAX_DEPTH = 32;
+        static const unsigned long MAX_NODES = 10000;
+    };
+
     // The Data Type Table (DTT): this represents a table with all the COMPLEX types found
     // (distinct, udt and arrays) in each schema
     class IDA_SIARDdatatype_table {
@@ -1490,12 +1851,79 @@ namespace IDA {
         // Get the typenode of an entry (needed when traversing the attributes of an utd)
         // If not found, a typenode with empty name is returned
         IDA_SIARDtypenode get_typenode(const string &type_schema, const string &type_name) {
-            IDA_SIARDtypenode tnode; // tnode.name is empty by default
-            try {
-                auto key = pair<string,string>(type_schema, type_name);
-                tnode = datatype_dict.at(key);
-            } catch (...) {}
-            return tnode;
+            const IDA_SIARDtypenode *tnode = find_typenode(type_schema, type_name);
+            return tnode ? *tnode : IDA_SIARDtypenode(); // tnode.name is empty by default
+        }
+
+        // Same as get_typenode() but without copying the typenode; NULL if not found
+        const IDA_SIARDtypenode *find_typenode(const string &type_schema, const string &type_name) const {
+            auto it = datatype_dict.find(pair<string,string>(type_schema, type_name));
+            return (it != datatype_dict.end()) ? &it->second : NULL;
+        }
+
+        // Compile the decoding plan of a complex data type (see IDA_SIARDtype_plan),
+        // appending its nodes to the plan; return the index of the root node.
+        // The plan follows what append_complex_data_type_content() does for each cell
+        unsigned long compile_plan(IDA_SIARDtype_plan &plan, const string &type_schema, const string &type_name,
+                                   long depth = 0, const string &treepath = "") const
+        {
+            unsigned long inode = plan.size();
+            plan.emplace_back();
+            plan[inode].depth = depth;
+            plan[inode].treepath = treepath;
+
+            const IDA_SIARDtypenode *tnode = find_typenode(type_schema, type_name);
+            if (!tnode) {
+                // Not in the Data Type Table: it must be a simple type
+                plan[inode].kind = IDA_SIARDtype_plan_node::SIMPLE;
+                plan[inode].simpletype = IDA_siard_utils::siard_type_to_sqlite3(type_name);
+                return inode;
+            }
+            if (depth >= IDA_SIARDtype_plan::MAX_DEPTH || inode >= IDA_SIARDtype_plan::MAX_NODES) {
+                // Too deep or too big (perhaps a recursive type): interpret it cell by cell
+                plan[inode].kind = IDA_SIARDtype_plan_node::INTERPRETED;
+                plan[inode].type_schema = type_schema;
+                plan[inode].type_name = type_name;
+                return inode;
+            }
+
+            const auto &atts = tnode->getAttributeList();
+            string indent = string(1+depth, ' ');
+            if (tnode->getCategory() == "array") {
+                // Elements <a1>, <a2>, ... of the type of the unique attribute
+                plan[inode].kind = IDA_SIARDtype_plan_node::ARRAY;
+                plan[inode].tag_prefix = 'a';
+                if (!atts.empty()) {
+                    const auto &att = atts[0];
+                    string arr_type = att.getType().empty() ? att.getTypeName() : att.getType();
+                    for (unsigned long i = 1; i <= att.getCardinality(); i++) {
+                        unsigned long ichild = compile_plan(plan, att.getTypeSchema(), arr_type, depth + 1,
+                                                            treepath + "/a" + to_string(i));
+                        plan[inode].children.push_back(ichild);
+                        plan[inode].prefixes.push_back(indent);
+                    }
+                }
+            } else if (tnode->getCategory() == "distinct") {
+                // The base of a 'distinct' data type is a simple type
+                plan[inode].kind = IDA_SIARDtype_plan_node::DISTINCT;
+                string dis_base = atts.empty() ? "" : atts[0].getBase();
+                unsigned long ichild = compile_plan(plan, "", dis_base, depth + 1, treepath);
+                plan[inode].children.push_back(ichild);
+            } else if (tnode->getCategory() == "udt") {
+                // Elements <u1>, <u2>, ... for each attribute
+                plan[inode].kind = IDA_SIARDtype_plan_node::UDT;
+                plan[inode].tag_prefix = 'u';
+                for (const auto& att: atts) {
+                    string u_type = att.getType().empty() ? att.getTypeName() : att.getType();
+                    unsigned long ichild = compile_plan(plan, att.getTypeSchema(), u_type, depth + 1,
+                                                        treepath + "/" + att.getName());
+                    plan[inode].children.push_back(ichild);
+                    plan[inode].prefixes.push_back(indent + "'" + att.getName() + "', ");
+                }
+            } else {
+                plan[inode].kind = IDA_SIARDtype_plan_node::NONE;
+            }
+            return inode;
         }
 
         // Generate the name for an auxiliary table associated to a complex data type (typeSchema, typeName)
@@ -1713,475 +2141,2971 @@ namespace IDA {
     // Two possibilities: unzip the zip fully, or unzipping file by file
     enum unzipmode_e {SIARD_FULL_UNZIP, SIARD_FILE_BY_FILE_UNZIP};
 
-    // Main class to process  "content/schema<M>/table<N>/table<N>.xml" archive
-    class IDA_SIARDcontent{
-        XMLDocument doc;
-        XMLElement *pRootElem = NULL;
-
-        string tablename;
-
-        string siardURI;
-        string tmpdir;
-        enum unzipmode_e unzipmode;
+    // Seconds elapsed since an arbitrary origin, to time the phases of a conversion
+    static inline double IDA_seconds()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
 
-        ostream &sqlout = cout;
-        unsigned long ncols = 0;
-        vector<string> siard_colname_v;
-        vector<IDA_SIARD_type_attribute> siard_coltype_v;
-        vector<IDA_SIARDlobfolder> siard_lobfolder_info_v;
+    // Counters and times of the conversion of one table (see IDA_SIARDmetadata::set_stats())
+    struct IDA_SIARDtable_stats {
+        string schema;
+        string table;
+        unsigned long rows = 0;
+        unsigned long long cells = 0;       // Cells converted (non-empty elements <cN>)
+        unsigned long long text_bytes = 0;  // Bytes of the texts (and numbers) inside the XML
+        unsigned long long lobs = 0;        // Lobs in files, and their bytes
+        unsigned long long lob_bytes = 0;
+        unsigned long long out_bytes = 0;   // SQL written, or growth of the sqlite3 database
+        double unzip_time = 0;              // Extracting or inflating the table XML
+        double parse_time = 0;              // Locating and parsing the rows
+        double emit_time = 0;               // Converting the cells (lobs included) and writing the rows
+    };
 
-    public:
-        unsigned long current_col_id = 0;
-        IDA_SIARDcontent(const string& tablename,
-                         const string& siardURI, const string& tmpdir, enum unzipmode_e unzipmode,
-                         ostream &sqlout, unsigned long ncols,
-                         vector<string> siard_colname_v,
-                         vector<IDA_SIARD_type_attribute> siard_coltype_v,
-                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v)
-                         :
-                tablename(tablename), siardURI(siardURI), tmpdir(tmpdir),
-                sqlout(sqlout), ncols(ncols),
-                siard_colname_v(siard_colname_v),
-                siard_coltype_v(siard_coltype_v), siard_lobfolder_info_v(siard_lobfolder_info_v)
+    // Streaming reader for the rows of a "table<N>.xml" file:
+    //      <table ...> <row> <c1>...</c1> <c2>...</c2> ... </row> <row> ... </row> ... </table>
+    // Data are read in chunks from an input stream, and each <row>...</row> element
+    // is parsed on its own with tinyxml2, so memory use depends on the size of one row
+    // (and the chunk), not on the number of rows of the table
+    class IDA_SIARDrow_reader {
+        IDA_input_stream *in = NULL;
+        string buf;         // Data read but not consumed yet start at buf[pos]
+        size_t pos = 0;
+        bool eof = false;
+        bool error = false; // The input stream failed
+        string header;      // Text before the first row (e.g. <table ... version="2.1">)
+        bool header_done = false;
+        bool header_truncated = false;
+        XMLDocument rowdoc; // DOM of the current row only
+        bool dom = false;   // Rows are taken from the DOM of the whole table (see load_dom())
+        XMLDocument tabledoc;
+        XMLElement *domrow = NULL;
+        unsigned long nrows = 0;
+
+        // Sampling (see set_sampling())
+        unsigned long limit = 0;
+        unsigned long every = 1;
+        unsigned long nseen = 0;
+
+        // Seconds reading the input, and locating and parsing the rows (see get_times())
+        double read_time = 0;
+        double parse_time = 0;
+
+        static const long CHUNK_SIZE = 64*1024;
+        static const size_t HEADER_MAX_SIZE = 4*1024;
+
+        // Read one more chunk from the stream, discarding consumed data
+        // Return false if there are no more data
+        bool fill()
         {
-            this->unzipmode = unzipmode;
-            clear();
+            if (eof || !in) return false;
+            if (pos > 0) {
+                buf.erase(0, pos);
+                pos = 0;
+            }
+            char chunk[CHUNK_SIZE];
+            double t0 = IDA_seconds();
+            long n = in->read(chunk, CHUNK_SIZE);
+            read_time += IDA_seconds() - t0;
+            if (n <= 0) {
+                if (n < 0) {
+                    cerr << "Error reading table XML data" << endl;
+                    error = true;
+                }
+                eof = true;
+                return false;
+            }
+            buf.append(chunk, n);
+            return true;
         }
 
-        void clear()
+        // Kind of the markup starting with '<' found by scan_markup()
+        enum markup_e {
+            MARKUP_MORE,    // More data are needed to know where it ends
+            MARKUP_SKIP,    // Comment, CDATA section or processing instruction
+            MARKUP_DECL,    // Declaration, e.g. <!DOCTYPE ...>
+            MARKUP_START,   // Start tag <x ...>
+            MARKUP_EMPTY,   // Empty-element tag <x .../>
+            MARKUP_END      // End tag </x>
+        };
+
+        // 1 if the data at buf[i] start with 's', 0 if not, -1 if more data are needed
+        int starts_with(size_t i, const char *s) const
         {
-            doc.Clear();
-            pRootElem = NULL;
+            for (size_t k = 0; s[k]; k++) {
+                if (i + k >= buf.size()) return -1;
+                if (buf[i + k] != s[k]) return 0;
+            }
+            return 1;
         }
 
-        int load(const char *xmlfile)
+        // Scan the markup starting with '<' at buf[i], setting 'end' to the position after it
+        // Comments, CDATA sections and processing instructions are scanned as a whole, and
+        // a '>' within the quoted value of an attribute does not end a tag
+        markup_e scan_markup(size_t i, size_t &end) const
         {
-            clear();
-            XMLError result = XML_ERROR_FILE_READ_ERROR;
-
-            try {
-                result = doc.LoadFile(xmlfile);
-            } catch (const std::exception &e) {
-                // catch anything thrown within try block that derives from std::exception
-                cerr << "*EXCEPTION loading XML '" << xmlfile << "'" << endl << " what: '" << e.what() << "'" << endl;
-                result = XML_ERROR_FILE_READ_ERROR;
-                //- exit(126);
-            } catch (...){
-                cerr << "*Unknown EXCEPTION loading XML '" << xmlfile << "' result=" << result << "" << endl;
-                result = XML_ERROR_FILE_READ_ERROR;
-                //- exit(127);
+            static const struct { const char *open, *close; } skipped[] = {
+                { "<!--", "-->" }, { "<![CDATA[", "]]>" }, { "<?", "?>" }
+            };
+            for (auto &m: skipped) {
+                int r = starts_with(i, m.open);
+                if (r < 0) return MARKUP_MORE;
+                if (r) {
+                    size_t e = buf.find(m.close, i + strlen(m.open));
+                    if (e == string::npos) return MARKUP_MORE;
+                    end = e + strlen(m.close);
+                    return MARKUP_SKIP;
+                }
             }
-
-            if (result != XML_SUCCESS){
-                //fprintf(stderr, "Error loading XML file '%s': %d\n", xmlfile, result); // Debug
-                return -1;
-            } else {
-                //fprintf(stderr, "OK loading '%s'\n", xmlfile); // Debug
-                pRootElem = doc.RootElement();
-                // Let us store also the filename
-                // -- xmlfilename = xmlfile;
-                return 0;
+            char q = 0;
+            for (size_t k = i + 1; k < buf.size(); k++) {
+                char c = buf[k];
+                if (q) {
+                    if (c == q) q = 0;
+                } else if (c == '"' || c == '\'') {
+                    q = c;
+                } else if (c == '>') {
+                    end = k + 1;
+                    if (buf[i + 1] == '!') return MARKUP_DECL;
+                    if (buf[i + 1] == '/') return MARKUP_END;
+                    return (buf[k - 1] == '/') ? MARKUP_EMPTY : MARKUP_START;
+                }
             }
+            return MARKUP_MORE;
         }
 
-        int load(string xmlfile)
+        // True if the (complete) tag at buf[i] is a <row> tag (not "<rows", ...)
+        bool is_row_tag(size_t i) const
         {
-            return load(xmlfile.c_str());
+            if (starts_with(i, "<row") != 1) return false;
+            char c = buf[i + 4];
+            return c == '>' || c == '/' || isspace((unsigned char)c);
         }
 
-        // Method to print one xml element, to be used
-        // in IDA_xml_utils::process_tree
-        static void print_element(XMLElement *pElem, string path, long level, va_list va)
+        // Consume the data up to buf[i], keeping them as header if no row was found yet
+        void consume(size_t i)
         {
-            (void) path;
-            (void) va;
-            if (pElem) {
-                const char *elemName = pElem->Name();
-                const char *elemText = pElem->GetText();
-                if (!elemText) elemText = ""; // This element has no string
-                string indent(level, ' '); // Indent with spaces
-                cout << setw(4) << level << "> " << indent << "tagname='" << elemName << "' text='"
-                     << IDA_parsing_utils::trim(elemText) << "'" << " path=" << path << endl;
+            if (!header_done) {
+                if (header.size() < HEADER_MAX_SIZE) header.append(buf, pos, i - pos);
+                else header_truncated = true;
             }
+            pos = i;
         }
 
-        // Print raw
-        void print_tree(){
-            if (pRootElem) {
-                IDA_xml_utils::print_tree(pRootElem);
-            }
+        // Read more data keeping the position 'i', moved as fill() moves the data
+        bool more(size_t &i)
+        {
+            size_t off = i - pos;
+            if (!fill()) return false;
+            i = pos + off;
+            return true;
         }
 
-        // Print using process_tree() method with print_element() function
-        void print_full_tree(){
-            if (pRootElem) {
-                IDA_xml_utils::process_tree(pRootElem, print_element, "", 0);
+        // Body of next_row(): locate the next row (sampled) and parse it into 'rowdoc'
+        XMLElement* read_row(XMLDocument &rowdoc)
+        {
+            if (dom) return dom_row(rowdoc);
+            for (;;) {
+                if (limit && nrows >= limit) return NULL;
+                // Locate the beginning of the row, skipping any other markup
+                size_t s = pos, e;
+                for (;;) {
+                    s = buf.find('<', s);
+                    if (s == string::npos) {
+                        consume(buf.size());
+                        s = pos;
+                        if (!more(s)) return NULL;
+                        continue;
+                    }
+                    markup_e m = scan_markup(s, e);
+                    if (m == MARKUP_MORE) {
+                        consume(s);
+                        if (!more(s)) return NULL;
+                        continue;
+                    }
+                    if (m == MARKUP_DECL && !header_done) {
+                        // E.g., a document type declaration that may define entities
+                        consume(s);
+                        return load_dom(rowdoc);
+                    }
+                    if ((m == MARKUP_START || m == MARKUP_EMPTY) && is_row_tag(s)) break;
+                    s = e;
+                }
+                consume(s);
+                header_done = true;
+
+                // Locate the end of the row: the end tag that closes its start tag
+                long depth = 0;
+                size_t i = s;
+                for (;;) {
+                    markup_e m = scan_markup(i, e);
+                    if (m == MARKUP_MORE) {
+                        if (!more(i)) {
+                            cerr << "Error: unterminated <row> in table XML" << endl;
+                            return NULL;
+                        }
+                        continue;
+                    }
+                    if (m == MARKUP_START) depth++;
+                    else if (m == MARKUP_END) depth--;
+                    if (depth <= 0) break;
+                    size_t from = e;
+                    while ((i = buf.find('<', from)) == string::npos) {
+                        from = buf.size();
+                        if (!more(from)) {
+                            cerr << "Error: unterminated <row> in table XML" << endl;
+                            return NULL;
+                        }
+                    }
+                }
+
+                if (nseen++ % every) {
+                    pos = e; // Not sampled
+                    continue;
+                }
+
+                rowdoc.Clear();
+                XMLError result = rowdoc.Parse(buf.data() + pos, e - pos);
+                pos = e;
+                nrows++;
+                if (result == XML_SUCCESS) {
+                    return rowdoc.RootElement();
+                }
+                // Skip malformed rows
+                cerr << "Error parsing row " << nrows - 1 << " of table XML: " << rowdoc.ErrorStr() << endl;
+            }
+        }
+
+        // Fall back to parsing the whole table XML with the DOM parser, when it cannot
+        // be split into rows (see read_row()); rows are then copied from 'tabledoc'
+        XMLElement* load_dom(XMLDocument &rowdoc)
+        {
+            if (header_truncated) {
+                cerr << "Error: table XML not supported (too long before the first row)" << endl;
+                error = true;
+                return NULL;
+            }
+            while (fill()) ;
+            string doc = header + buf.substr(pos);
+            buf.clear();
+            pos = 0;
+            header_done = true;
+            dom = true;
+            if (tabledoc.Parse(doc.data(), doc.size()) != XML_SUCCESS) {
+                cerr << "Error parsing table XML: " << tabledoc.ErrorStr() << endl;
+                error = true;
+                return NULL;
+            }
+            XMLElement *root = tabledoc.RootElement();
+            domrow = root ? root->FirstChildElement("row") : NULL;
+            return dom_row(rowdoc);
+        }
+
+        // Next row (sampled) of 'tabledoc', copied into 'rowdoc'
+        XMLElement* dom_row(XMLDocument &rowdoc)
+        {
+            while (domrow) {
+                if (limit && nrows >= limit) return NULL;
+                XMLElement *row = domrow;
+                domrow = domrow->NextSiblingElement("row");
+                if (nseen++ % every) continue;
+                rowdoc.Clear();
+                rowdoc.InsertEndChild(row->DeepClone(&rowdoc));
+                nrows++;
+                return rowdoc.RootElement();
+            }
+            return NULL;
+        }
+
+    public:
+        IDA_SIARDrow_reader() {}
+
+        void open(IDA_input_stream *input)
+        {
+            in = input;
+            buf.clear();
+            pos = 0;
+            eof = false;
+            header.clear();
+            header_done = false;
+            header_truncated = false;
+            dom = false;
+            tabledoc.Clear();
+            domrow = NULL;
+            nrows = 0;
+            nseen = 0;
+            read_time = parse_time = 0;
+            error = false;
+        }
+
+        // Read only one row of every 'every' rows (the first one, the (every+1)-th, ...)
+        // and at most 'limit' rows (0: no limit); the rows not read are skipped without
+        // parsing them, and the data after the last row read are not even read
+        void set_sampling(unsigned long limit, unsigned long every)
+        {
+            this->limit = limit;
+            this->every = std::max(1UL, every);
+        }
+
+        // Return the next row element, or NULL when there are no more rows
+        // The element is valid until the next call
+        XMLElement* next_row()
+        {
+            return next_row(rowdoc);
+        }
+
+        // Same as next_row(), but the row is parsed into the document 'doc'
+        // The element is valid until doc is reused
+        XMLElement* next_row(XMLDocument &rowdoc)
+        {
+            double t0 = IDA_seconds(), r0 = read_time;
+            XMLElement *row = read_row(rowdoc);
+            parse_time += (IDA_seconds() - t0) - (read_time - r0);
+            return row;
+        }
+
+        // Seconds spent reading the input stream, and locating and parsing the rows
+        void get_times(double &read, double &parse) const
+        {
+            read = read_time;
+            parse = parse_time;
+        }
+
+        // Get an attribute of the root element (<table>) as found before the first row
+        string get_root_attribute_value(const string &name, const char *not_found_val)
+        {
+            if (dom) {
+                XMLElement *root = tabledoc.RootElement();
+                const char *v = root ? root->Attribute(name.c_str()) : NULL;
+                return v ? v : not_found_val;
+            }
+            regex re("\\s" + name + "\\s*=\\s*[\"']([^\"']*)[\"']");
+            smatch m;
+            if (regex_search(header, m, re)) {
+                return m[1].str();
+            }
+            return not_found_val;
+        }
+
+        // Number of rows read so far
+        unsigned long get_nrows() const
+        {
+            return nrows;
+        }
+
+        // True if the input stream failed (e.g., a corrupted zip entry), so
+        // that rows may be missing
+        bool failed() const
+        {
+            return error;
+        }
+    }; /* class IDA_SIARDrow_reader */
+
+#ifdef IDA_THREADS
+    // Bounded ring buffer with one producer thread and one consumer thread, lock-free
+    // while neither has to wait
+    // push() waits while the ring is full (back-pressure) and pop() while it is empty;
+    // both return false if 'cancel' is set while waiting (see wake())
+    // A thread waiting spins a few times and then sleeps on a condition variable,
+    // that the other thread notifies only if somebody is sleeping
+    template <typename T>
+    class IDA_spsc_ring {
+        static const int SPIN = 64;
+
+        vector<T> slots;
+        size_t cap;
+        std::atomic<size_t> head{0}; // Next slot to pop (written by the consumer)
+        std::atomic<size_t> tail{0}; // Next slot to push (written by the producer)
+        std::mutex m;
+        std::condition_variable cv;
+        std::atomic<int> sleeping{0};
+
+        // Wait until 'ready()' or 'cancel'; returns false if cancelled
+        template <typename F>
+        bool wait(F ready, const std::atomic<bool> &cancel)
+        {
+            for (int i = 0; i < SPIN; i++) {
+                if (ready()) return true;
+                if (cancel.load(std::memory_order_relaxed)) return false;
+                std::this_thread::yield();
+            }
+            std::unique_lock<std::mutex> lk(m);
+            sleeping++;
+            cv.wait(lk, [&]{ return ready() || cancel.load(); });
+            sleeping--;
+            return ready();
+        }
+
+        void notify()
+        {
+            if (sleeping.load()) wake();
+        }
+
+    public:
+        explicit IDA_spsc_ring(size_t n) : slots(n + 1), cap(n + 1) {}
+
+        bool push(T &&v, const std::atomic<bool> &cancel)
+        {
+            size_t t = tail.load(std::memory_order_relaxed);
+            size_t nt = (t + 1) % cap;
+            if (!wait([&]{ return nt != head.load(); }, cancel)) return false;
+            slots[t] = std::move(v);
+            tail.store(nt);
+            notify();
+            return true;
+        }
+
+        bool pop(T &v, const std::atomic<bool> &cancel)
+        {
+            size_t h = head.load(std::memory_order_relaxed);
+            if (!wait([&]{ return h != tail.load(); }, cancel)) return false;
+            v = std::move(slots[h]);
+            head.store((h + 1) % cap);
+            notify();
+            return true;
+        }
+
+        // Wake up the threads waiting in push() or pop(), e.g. once 'cancel' is set
+        void wake()
+        {
+            std::lock_guard<std::mutex> lk(m);
+            cv.notify_all();
+        }
+    };
+
+    // Three-stage pipeline to read the rows of a table XML file:
+    //   (1) an inflate thread reads chunks from the input stream (e.g., inflating a zip entry),
+    //   (2) a parse thread splits the chunks into rows and parses them with tinyxml2,
+    //   (3) the caller of next_row() converts them (e.g., emitting SQL)
+    // Stages are linked by bounded ring buffers, so memory is limited to
+    // NCHUNKS chunks and NROWS parsed rows, whatever the size of the table
+    class IDA_SIARDrow_pipeline {
+        static const long CHUNK_SIZE = 64*1024;
+        static const size_t NCHUNKS = 8;
+        static const size_t NROWS = 64;
+
+        struct chunk {
+            string data;
+            long status = 0; // As returned by IDA_input_stream::read()
+        };
+
+        // Input stream of the parse stage, reading the chunks of the inflate stage
+        class chunk_input_stream : public IDA_input_stream {
+            IDA_SIARDrow_pipeline &p;
+            chunk c;
+            size_t pos = 0;
+            bool end = false;
+        public:
+            chunk_input_stream(IDA_SIARDrow_pipeline &p) : p(p) {}
+
+            long read(char *buf, long n) override
+            {
+                while (!end && pos >= c.data.size()) {
+                    if (!p.chunks.pop(c, p.cancel)) return 0; // Pipeline cancelled
+                    pos = 0;
+                    if (c.status <= 0) {
+                        end = true;
+                        return c.status;
+                    }
+                }
+                if (end) return 0;
+                long r = std::min((size_t) n, c.data.size() - pos);
+                memcpy(buf, c.data.data() + pos, r);
+                pos += r;
+                return r;
+            }
+        };
+
+        IDA_input_stream *in;
+        IDA_spsc_ring<chunk> chunks{NCHUNKS};
+        chunk_input_stream chunkin{*this};
+        IDA_SIARDrow_reader reader;
+
+        XMLDocument docs[NROWS];
+        IDA_spsc_ring<long> full_rows{NROWS};  // Parsed rows (index of docs); -1 is the end
+        IDA_spsc_ring<long> free_rows{NROWS};  // Documents ready to be reused
+        long current = -1;
+        bool end = false;
+
+        std::atomic<bool> cancel{false};
+        std::thread inflater, parser;
+        double inflate_time = 0; // Seconds of the inflate stage reading the input
+
+        void inflate_stage()
+        {
+            for (;;) {
+                chunk c;
+                c.data.resize(CHUNK_SIZE);
+                double t0 = IDA_seconds();
+                c.status = in->read(&c.data[0], CHUNK_SIZE);
+                inflate_time += IDA_seconds() - t0;
+                c.data.resize(c.status > 0 ? c.status : 0);
+                bool last = (c.status <= 0);
+                if (!chunks.push(std::move(c), cancel) || last) return;
+            }
+        }
+
+        void parse_stage()
+        {
+            for (;;) {
+                long i;
+                if (!free_rows.pop(i, cancel)) return;
+                XMLElement *row = reader.next_row(docs[i]);
+                if (!row) i = -1;
+                if (!full_rows.push(std::move(i), cancel) || i < 0) return;
+            }
+        }
+
+    public:
+        IDA_SIARDrow_pipeline(IDA_input_stream *input, unsigned long limit = 0, unsigned long every = 1) : in(input)
+        {
+            reader.open(&chunkin);
+            reader.set_sampling(limit, every);
+            for (long i = 0; i < (long) NROWS; i++) {
+                long k = i;
+                free_rows.push(std::move(k), cancel);
+            }
+            inflater = std::thread(&IDA_SIARDrow_pipeline::inflate_stage, this);
+            parser = std::thread(&IDA_SIARDrow_pipeline::parse_stage, this);
+        }
+
+        ~IDA_SIARDrow_pipeline()
+        {
+            cancel = true;
+            chunks.wake();
+            full_rows.wake();
+            free_rows.wake();
+            inflater.join();
+            parser.join();
+        }
+
+        // Same as IDA_SIARDrow_reader::next_row()
+        XMLElement* next_row()
+        {
+            if (end) return NULL;
+            if (current >= 0) {
+                free_rows.push(std::move(current), cancel);
+                current = -1;
+            }
+            long i;
+            if (!full_rows.pop(i, cancel) || i < 0) {
+                end = true;
+                return NULL;
+            }
+            current = i;
+            return docs[i].RootElement();
+        }
+
+        // Same as IDA_SIARDrow_reader::get_root_attribute_value()
+        // (valid once the first row, or the end, has been read)
+        string get_root_attribute_value(const string &name, const char *not_found_val)
+        {
+            return reader.get_root_attribute_value(name, not_found_val);
+        }
+
+        // Same as IDA_SIARDrow_reader::get_nrows() (valid at the end)
+        unsigned long get_nrows() const
+        {
+            return reader.get_nrows();
+        }
+
+        // Same as IDA_SIARDrow_reader::failed() (valid at the end)
+        bool failed() const
+        {
+            return reader.failed();
+        }
+
+        // Same as IDA_SIARDrow_reader::get_times() (valid at the end); reading is
+        // timed in the inflate stage, as the parse stage waits for its chunks
+        void get_times(double &read, double &parse) const
+        {
+            double wait;
+            reader.get_times(wait, parse);
+            read = inflate_time;
+        }
+    }; /* class IDA_SIARDrow_pipeline */
+#endif
+
+    // Main class to process  "content/schema<M>/table<N>/table<N>.xml" archive
+    // Rows are read one by one with a streaming reader (the full table is never in memory)
+    class IDA_SIARDcontent{
+        IDA_file_input_stream xmlin;
+        IDA_zip_entry_input_stream zipin;
+        IDA_SIARDrow_reader rows;
+        bool loaded = false;
+
+        // Rows are read by a three-stage pipeline if 'pipelined' (see IDA_SIARDrow_pipeline)
+        bool pipelined = false;
+
+        // Columns not converted (see set_skipped_columns())
+        vector<bool> col_skipped;
+
+        // Columns in a primary key or unique index (see set_indexed_columns())
+        vector<bool> col_indexed;
+
+        // Errors that may have lost data (see get_failures())
+        unsigned long failures = 0;
+
+        // Rows converted (see set_sampling())
+        unsigned long row_limit = 0;
+        unsigned long row_every = 1;
+
+        // Bulk-load mode (see set_bulk())
+        bool bulk = false;
+        unsigned long batch_rows = 1;   // Rows per INSERT statement
+        unsigned long commit_rows = 0;  // Rows per transaction (0: one transaction per table)
+        static const unsigned long BATCH_MAX_BYTES = 1024*1024; // Close INSERT statements longer than this
+    #ifdef IDA_THREADS
+        std::unique_ptr<IDA_SIARDrow_pipeline> pipeline;
+    #endif
+
+        // Counters and times of the conversion (see get_stats()); 'read_time' is
+        // the time spent waiting for the rows, i.e., in next_row()
+        IDA_SIARDtable_stats stats;
+        double read_time = 0;
+
+        // Read rows from the loaded table file, in the pipeline or directly
+        XMLElement* next_row()
+        {
+            double t0 = IDA_seconds();
+            XMLElement *row;
+        #ifdef IDA_THREADS
+            if (pipeline) row = pipeline->next_row();
+            else
+        #endif
+            row = rows.next_row();
+            read_time += IDA_seconds() - t0;
+            return row;
+        }
+
+        string get_root_attribute_value(const string &name, const char *not_found_val)
+        {
+        #ifdef IDA_THREADS
+            if (pipeline) return pipeline->get_root_attribute_value(name, not_found_val);
+        #endif
+            return rows.get_root_attribute_value(name, not_found_val);
+        }
+
+        unsigned long get_nrows()
+        {
+        #ifdef IDA_THREADS
+            if (pipeline) return pipeline->get_nrows();
+        #endif
+            return rows.get_nrows();
+        }
+
+        // True if the table XML could not be read to the end (valid at the end)
+        bool read_failed()
+        {
+        #ifdef IDA_THREADS
+            if (pipeline) return pipeline->failed();
+        #endif
+            return rows.failed();
+        }
+
+        void open_rows(IDA_input_stream *in)
+        {
+        #ifdef IDA_THREADS
+            if (pipelined) {
+                pipeline.reset(new IDA_SIARDrow_pipeline(in, row_limit, row_every));
+                return;
+            }
+        #endif
+            rows.open(in);
+            rows.set_sampling(row_limit, row_every);
+        }
+
+        string tablename;
+
+        string siardURI;
+        string tmpdir;
+        enum unzipmode_e unzipmode;
+
+        ostream &sqlout = cout;
+        unsigned long ncols = 0;
+        vector<string> siard_colname_v;
+        vector<IDA_SIARD_type_attribute> siard_coltype_v;
+        vector<IDA_SIARDlobfolder> siard_lobfolder_info_v;
+
+        // If not NULL, rows are inserted directly into this sqlite3 database
+        // using a prepared statement, instead of writing INSERT statements to sqlout
+        sqlite3 *db = NULL;
+
+        // Lobs of the current row bound as zeroblob(size) when loading into db; their
+        // content is streamed into the inserted row by write_pending_lobs()
+        // Only lobs larger than this are streamed; smaller ones are bound from memory
+        #define STREAMED_LOB_MIN_SIZE (1024*1024)
+        struct IDA_pending_lob {
+            int idx;                        // Parameter number, starting at 1
+            unsigned long colid;            // Column number, starting at 0
+            sqlite3_int64 size;             // Length of the lob (attribute length="...")
+            string lob_file;                // Lob URI, to read it again if size is wrong
+            string tmp_lob_file;            // File extracted to the temporary dir, if any
+            unique_ptr<IDA_input_stream> in;
+        };
+        vector<IDA_pending_lob> pending_lobs;
+
+        // The siard zip mapped in memory, to use lobs stored in it without compression
+        // straight from the mapping (see get_stored_lob()); it is mapped when the
+        // first lob is found, and 'siard_map_failed' avoids retrying if it cannot be mapped
+        IDA_mapped_file siard_map;
+        bool siard_map_failed = false;
+
+    public:
+        unsigned long current_col_id = 0;
+
+        // Number of rows read by tree_to_sql() (valid at the end)
+        unsigned long get_converted_rows()
+        {
+            return get_nrows();
+        }
+
+        // Number of errors converting the table that may have lost data, e.g. rows not
+        // inserted or lobs not read (valid at the end)
+        unsigned long get_failures() const
+        {
+            return failures;
+        }
+
+        // Counters and times of tree_to_sql() (valid at the end); the unzip and parse
+        // times come from the row reader (or the stages of the pipeline)
+        IDA_SIARDtable_stats get_stats()
+        {
+            IDA_SIARDtable_stats st = stats;
+            st.rows = get_nrows();
+        #ifdef IDA_THREADS
+            if (pipeline) pipeline->get_times(st.unzip_time, st.parse_time);
+            else
+        #endif
+            rows.get_times(st.unzip_time, st.parse_time);
+            return st;
+        }
+
+        IDA_SIARDcontent(const string& tablename,
+                         const string& siardURI, const string& tmpdir, enum unzipmode_e unzipmode,
+                         ostream &sqlout, unsigned long ncols,
+                         vector<string> siard_colname_v,
+                         vector<IDA_SIARD_type_attribute> siard_coltype_v,
+                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v,
+                         sqlite3 *db = NULL)
+                         :
+                tablename(tablename), siardURI(siardURI), tmpdir(tmpdir),
+                sqlout(sqlout), ncols(ncols),
+                siard_colname_v(siard_colname_v),
+                siard_coltype_v(siard_coltype_v), siard_lobfolder_info_v(siard_lobfolder_info_v),
+                db(db)
+        {
+            this->unzipmode = unzipmode;
+            clear();
+        }
+
+        void clear()
+        {
+        #ifdef IDA_THREADS
+            pipeline.reset(); // Stop the pipeline before closing its input
+        #endif
+            xmlin.close();
+            zipin.close();
+            loaded = false;
+            clear_pending_lobs();
+            stats = IDA_SIARDtable_stats();
+            read_time = 0;
+            failures = 0;
+        }
+
+        ~IDA_SIARDcontent()
+        {
+            clear();
+        }
+
+        // Read the rows with an inflate/parse/convert pipeline of threads
+        // (must be set before load(); ignored without threads)
+        void set_pipelined(bool p)
+        {
+            pipelined = p;
+        }
+
+        // Bulk-load mode: rows are inserted inside transactions (one per table, or one
+        // per 'commit_rows' rows) and, when generating SQL, several rows are inserted by
+        // each statement: INSERT INTO 't' VALUES (...),\n(...),\n...; ('batch_rows' rows at most)
+        void set_bulk(bool enable, unsigned long batch_rows = 1, unsigned long commit_rows = 0)
+        {
+            this->bulk = enable;
+            this->batch_rows = enable ? std::max(1UL, batch_rows) : 1;
+            this->commit_rows = enable ? commit_rows : 0;
+        }
+
+        // Columns skipped (e.g., not in the projection of the conversion): they are neither
+        // decoded nor inserted, as if the table did not have them. Empty: none skipped
+        void set_skipped_columns(const vector<bool> &skipped)
+        {
+            col_skipped = skipped;
+        }
+
+        // Columns in a primary key or unique index: their lobs are always bound with
+        // their real content, never as a zeroblob(size) placeholder written after the
+        // insert, that would collide with other lobs of the same size. Empty: none
+        void set_indexed_columns(const vector<bool> &indexed)
+        {
+            col_indexed = indexed;
+        }
+
+        // Convert only one row of every 'every' rows, and 'limit' rows at most (0: all);
+        // see IDA_SIARDrow_reader::set_sampling() (must be set before load())
+        void set_sampling(unsigned long limit, unsigned long every)
+        {
+            row_limit = limit;
+            row_every = std::max(1UL, every);
+        }
+
+        // Open the table XML file; rows are parsed later, one at a time, while converting
+        int load(const char *xmlfile)
+        {
+            clear();
+            if (xmlin.open(xmlfile)) {
+                //fprintf(stderr, "Error loading XML file '%s'\n", xmlfile); // Debug
+                return -1;
+            }
+            open_rows(&xmlin);
+            loaded = true;
+            return 0;
+        }
+
+        // Same as load(), but the table XML file is read directly from inside
+        // the siard (zip) file, with no temporary extraction
+        int load_from_zip(const string &zipfile, const string &xmlfile)
+        {
+            clear();
+            if (zipin.open(zipfile, xmlfile)) {
+                return -1;
+            }
+            open_rows(&zipin);
+            loaded = true;
+            return 0;
+        }
+
+        int load(string xmlfile)
+        {
+            return load(xmlfile.c_str());
+        }
+
+        // Method to print one xml element, to be used
+        // in IDA_xml_utils::process_tree
+        static void print_element(XMLElement *pElem, string path, long level, va_list va)
+        {
+            (void) path;
+            (void) va;
+            if (pElem) {
+                const char *elemName = pElem->Name();
+                const char *elemText = pElem->GetText();
+                if (!elemText) elemText = ""; // This element has no string
+                string indent(level, ' '); // Indent with spaces
+                cout << setw(4) << level << "> " << indent << "tagname='" << elemName << "' text='"
+                     << IDA_parsing_utils::trim(elemText) << "'" << " path=" << path << endl;
+            }
+        }
+
+        // Print raw (this consumes the rows of the loaded file)
+        void print_tree(){
+            XMLElement *row;
+            while (loaded && (row = next_row())) {
+                IDA_xml_utils::print_tree(row);
+            }
+        }
+
+        // Print using process_tree() method with print_element() function
+        // (this consumes the rows of the loaded file)
+        void print_full_tree(){
+            XMLElement *row;
+            while (loaded && (row = next_row())) {
+                IDA_xml_utils::process_tree(row, print_element, "", 0);
+            }
+        }
+
+    private:
+        // Get the path of the lob file referenced by a cell (attribute file="...") taking into
+        // account the lob folder associated to its treepath, if any
+        string get_lob_file(const string &el_file, const string &treepath)
+        {
+            // Get the full canonical lobfoler asssociated to this treepath, if any
+            string lobfolder = siard_lobfolder_info_v[current_col_id].get_real_lobfoler(treepath);
+
+            if (lobfolder.empty()) {
+                //lob_file = siard_dir + "/" + el_file;
+                return IDA_SIARDlobfolder::combine_lobfolders(siardURI, el_file);
+            } else {
+                //lob_file = lobfolder + "/" + el_file;
+                return IDA_SIARDlobfolder::combine_lobfolders(lobfolder, el_file);
+            }
+        }
+
+        // Check if a lob file is stored in the siard zip itself (not in a nested zip)
+        // If so, set 'entry' to its path inside the zip and return true
+        bool get_lob_zip_entry(const string &lob_file, string &entry)
+        {
+            string z = IDA_file_utils::get_canonical_file_name(lob_file);
+            string zipprefix = siardURI + "/";
+            if (SIARD_FILE_BY_FILE_UNZIP == unzipmode && z.size() > zipprefix.size()
+                && IDA_parsing_utils::is_prefix(zipprefix, z)
+                && IDA_file_utils::is_regular_file(siardURI)) {
+                entry = z.substr(zipprefix.size());
+                return !strcasestr(entry.c_str(), ".zip") && !strcasestr(entry.c_str(), ".siard");
+            }
+            return false;
+        }
+
+        // If the file 'entry' of the siard zip is stored without compression, return a
+        // pointer to its content in the mapped siard and set n to its length, so it needs
+        // no inflating nor copying (its CRC-32 is not checked); otherwise return NULL
+        const char *get_stored_lob(const string &entry, unsigned long long &n)
+        {
+            if (siard_map_failed) return NULL;
+            if (!siard_map.is_open() && siard_map.open(siardURI)) {
+                siard_map_failed = true;
+                return NULL;
+            }
+            unsigned long long offset;
+            int rc;
+            {
+                IDA_ZIP_LOCK;
+                rc = IDA_unzip_entry_range(siardURI.c_str(), entry.c_str(), &offset, &n);
+            }
+            return rc == 0 ? siard_map.range(offset, n) : NULL;
+        }
+
+        // Open the content of a lob file as an input stream. Lobs stored in the siard zip
+        // are read from the mapped siard if not compressed, or inflated on the fly; otherwise
+        // the file is read from the filesystem, extracting it to the temporary dir if needed
+        // (then tmp_lob_file is the file to be deleted)
+        // Return NULL if the lob cannot be opened
+        IDA_input_stream *open_lob_stream(const string &lob_file, string &tmp_lob_file)
+        {
+            tmp_lob_file.clear();
+            string entry;
+            if (get_lob_zip_entry(lob_file, entry)) {
+                unsigned long long n;
+                const char *p = get_stored_lob(entry, n);
+                if (p) return new IDA_memory_input_stream(p, n);
+                IDA_zip_entry_input_stream *zin = new IDA_zip_entry_input_stream();
+                if (zin->open(siardURI, entry) == 0) return zin;
+                delete zin;
+            }
+            tmp_lob_file = IDA_file_utils::unzipURI(lob_file, tmpdir);
+            IDA_file_input_stream *fin = new IDA_file_input_stream();
+            if (!tmp_lob_file.empty() && fin->open(tmp_lob_file) == 0) return fin;
+            delete fin;
+            return NULL;
+        }
+
+        // Append the content of a lob file to s, as a BLOB literal X'...' if 'literal' is
+        // true, or raw otherwise. Lobs stored in the siard zip are copied from the mapped
+        // siard if not compressed, or inflated in memory (no temporary file is written)
+        // through their own zip handle, so that threads inflate lobs in parallel;
+        // otherwise the file is read from the filesystem, extracting it to the temporary
+        // dir if needed. 'size' (if >= 0) is the expected length
+        // Return false if the lob cannot be read (then X'' is appended for a literal)
+        bool lob_file_append(const string &lob_file, string &s, bool literal, long long size = -1)
+        {
+            string entry;
+            if (get_lob_zip_entry(lob_file, entry)) {
+                unsigned long long nstored;
+                const char *p = get_stored_lob(entry, nstored);
+                if (p) {
+                    if (literal) {
+                        s.append("X'");
+                        IDA_siard_utils::hex_append((const uint8_t*)p, nstored, s);
+                        s.append("'");
+                    } else {
+                        s.append(p, nstored);
+                    }
+                    return true;
+                }
+                // The zip lock is only held to look up the entry when opening it
+                IDA_zip_entry_input_stream zin;
+                if (zin.open(siardURI, entry) == 0) {
+                    unsigned long pos = s.size();
+                    // The length attribute comes from the xml, so do not trust huge values
+                    if (size >= 0 && size <= (1LL << 30)) s.reserve(pos + (literal ? 2*size + 3 : size));
+                    if (literal) s.append("X'");
+                    char buf[FILE_BLOB_BUFF_SIZE];
+                    long n;
+                    while ((n = zin.read(buf, FILE_BLOB_BUFF_SIZE)) > 0) {
+                        if (literal) IDA_siard_utils::hex_append((const uint8_t*)buf, n, s);
+                        else s.append(buf, n);
+                    }
+                    if (n == 0) {
+                        if (literal) s.append("'");
+                        return true;
+                    }
+                    // A corrupted entry (e.g., wrong CRC-32) is not extracted again
+                    s.resize(pos);
+                    cerr << "Error: inflating lob '" << entry << "' (error " << n << ")" << endl;
+                    if (literal) s.append("X''");
+                    return false;
+                }
+            }
+
+            string tmp_lob_file = IDA_file_utils::unzipURI(lob_file, tmpdir);
+            bool ok;
+            if (literal) {
+                ok = IDA_siard_utils::file_to_blob_literal_append(tmp_lob_file, s);
+            } else {
+                ok = IDA_siard_utils::file_to_string_append(tmp_lob_file, s);
+            }
+        #ifndef IDA_FULL_UNZIP
+            IDA_file_utils::delete_temp_file(tmpdir, tmp_lob_file);
+        #endif
+            return ok;
+        }
+
+        void delete_pending_lob_file(IDA_pending_lob &lob)
+        {
+            lob.in.reset();
+        #ifndef IDA_FULL_UNZIP
+            if (!lob.tmp_lob_file.empty()) IDA_file_utils::delete_temp_file(tmpdir, lob.tmp_lob_file);
+        #endif
+            lob.tmp_lob_file.clear();
+        }
+
+        void clear_pending_lobs()
+        {
+            for (auto &lob: pending_lobs) delete_pending_lob_file(lob);
+            pending_lobs.clear();
+        }
+
+        // Write the content of the lobs of the last inserted row, that were bound as
+        // zeroblob(size), chunk by chunk with the sqlite3 incremental blob I/O, so that
+        // a lob is never loaded in memory. If the blob cannot be opened for writing (e.g.,
+        // it is part of an index) or its length attribute is wrong, the whole value is
+        // set with an UPDATE instead
+        void write_pending_lobs()
+        {
+            sqlite3_int64 rowid = sqlite3_last_insert_rowid(db);
+            char buf[FILE_BLOB_BUFF_SIZE];
+            for (auto &lob: pending_lobs) {
+                const string &colname = siard_colname_v[lob.colid];
+                sqlite3_blob *blob = NULL;
+                bool ok = (sqlite3_blob_open(db, "main", tablename.c_str(), colname.c_str(),
+                                             rowid, 1, &blob) == SQLITE_OK);
+                sqlite3_int64 offset = 0;
+                long n = 0;
+                // Lobs already in memory (e.g., stored in the mapped siard) are written at once
+                unsigned long ndata;
+                const char *data = lob.in->data(ndata);
+                if (ok && data) {
+                    ok = ((sqlite3_int64) ndata <= lob.size)
+                         && (sqlite3_blob_write(blob, data, ndata, 0) == SQLITE_OK);
+                    offset = ndata;
+                }
+                while (ok && !data && (n = lob.in->read(buf, FILE_BLOB_BUFF_SIZE)) > 0) {
+                    ok = (offset + n <= lob.size)
+                         && (sqlite3_blob_write(blob, buf, n, offset) == SQLITE_OK);
+                    offset += n;
+                }
+                sqlite3_blob_close(blob);
+                if (n < 0) {
+                    cerr << "Error: reading lob '" << lob.lob_file << "'" << endl;
+                    failures++;
+                } else if (!ok || offset != lob.size) {
+                    update_lob(rowid, lob);
+                }
+                delete_pending_lob_file(lob);
+            }
+            pending_lobs.clear();
+        }
+
+        // Set the value of a lob column of a row reading the lob in memory
+        void update_lob(sqlite3_int64 rowid, IDA_pending_lob &lob)
+        {
+            delete_pending_lob_file(lob);
+            lob.in.reset(open_lob_stream(lob.lob_file, lob.tmp_lob_file));
+            string content;
+            char buf[FILE_BLOB_BUFF_SIZE];
+            long n = 0;
+            while (lob.in && (n = lob.in->read(buf, FILE_BLOB_BUFF_SIZE)) > 0) {
+                content.append(buf, n);
+            }
+            if (!lob.in || n < 0) {
+                cerr << "Error: reading lob '" << lob.lob_file << "'" << endl;
+                failures++;
+                return;
+            }
+            const string &colname = siard_colname_v[lob.colid];
+            string SQL_update = "UPDATE main.'" + tablename + "' SET '" + colname + "' = ?1 WHERE rowid = ?2;";
+            sqlite3_stmt *upd = NULL;
+            if (sqlite3_prepare_v2(db, SQL_update.c_str(), -1, &upd, NULL) == SQLITE_OK) {
+                sqlite3_bind_blob(upd, 1, content.data(), content.size(), SQLITE_STATIC);
+                sqlite3_bind_int64(upd, 2, rowid);
+                if (sqlite3_step(upd) != SQLITE_DONE) {
+                    cerr << "Error writing lob '" << lob.lob_file << "' into table '" << tablename << "': "
+                         << sqlite3_errmsg(db) << endl;
+                    failures++;
+                }
+            } else {
+                failures++;
+            }
+            sqlite3_finalize(upd);
+        }
+
+        // Get the content of an element, typically a column and append it to string s
+        // If textifyblob=true, force sqlite blobs (X'00FF...') to be cast to TEXT; this feature is used when
+        // generating json of complex data types
+        //
+        // Version using the SIARD type string ("CHAR(12)", "INTEGER", "TEXT", ...)
+        void append_simple_data_type_content(string &s, XMLElement *el, const string &siard_type,
+                                             bool textifyblob= false, const string &treepath = ""){
+            enum IDA_siard_utils::SQLITE_COLTYPES simpletype = IDA_siard_utils::siard_type_to_sqlite3(siard_type);
+            append_simple_data_type_content(s, el, simpletype, textifyblob, treepath);
+            return;
+        }
+        // Version using the sqlite type enum (IDA_siard_utils::COLTYPE_INTEGER, ...)
+        // It's more efficient for simple types because the enum can be precomputed
+        void append_simple_data_type_content(string &s, XMLElement *el, enum IDA_siard_utils::SQLITE_COLTYPES simpletype,
+                                             bool textifyblob= false, const string &treepath = "")
+        {
+            if (!el) {
+                // Return empty content for void elements
+                s.append("''");
+                return;
+            }
+
+            //cerr << ANSI_COLOR_MAGENTA << "coltype=" << IDA_siard_utils::coltype_to_str(simpletype)
+            //     << " treepath='" << treepath << "'" << ANSI_COLOR_RESET << endl; // Debug
+
+            //-- string content;
+            string el_file;
+            el_file= IDA_xml_utils::get_attribute_value(el, "file", "");
+            string el_filelen;
+            el_filelen= IDA_xml_utils::get_attribute_value(el, "length", "");
+
+            // If there is a file, the value to insert is the
+            // hexadecimal sqlite blob form X'12abcdef' of
+            // the file content  (text, blob, clob, vartext, ...)
+            if (!el_file.empty()){
+                string lob_file = get_lob_file(el_file, treepath);
+                string lob_literal;
+
+                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
+                    // If the affinity of this column is TEXT, cast the hex blob
+                    // form to text type
+                    //-- content = "CAST(";
+                    s.append("CAST(");
+                }
+
+                // Lobs inside the siard zip are inflated straight into the literal
+                char *endp = NULL;
+                long long lob_size = el_filelen.empty() ? -1 : strtoll(el_filelen.c_str(), &endp, 10);
+                if (!endp || *endp) lob_size = -1;
+                size_t n0 = s.size();
+                if (!lob_file_append(lob_file, s, true, lob_size)) failures++;
+                stats.lobs++;
+                stats.lob_bytes += (s.size() - n0 - 3) / 2; // X'...'
+
+
+                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
+                    // If the affinity of this column is TEXT, cast the hex blob
+                    // form to text type
+                    //-- content.append(" AS TEXT)");
+                    s.append(" AS TEXT)");
+                }
+            } else {
+                const char *t = el->GetText();
+                if (!t) t = "";
+                stats.text_bytes += strlen(t);
+                if (simpletype == IDA_siard_utils::COLTYPE_INTEGER
+                    || simpletype == IDA_siard_utils::COLTYPE_REAL
+                    || simpletype == IDA_siard_utils::COLTYPE_NUMERIC) {
+                    // Integer, float
+                    //-- content = col_text;
+                    s.append(t);
+                } else {
+                    // Text -> if the text has no special siard chars (\u00...) simply quote it;
+                    // otherwise, decode the siard-encoding string and express down as hex
+                    IDA_siard_utils::siard_text_to_sql_literal_append(t, strlen(t), s);
+                }
+            }
+            //return content;
+            return;
+        }
+
+        // Get the content of an element, typically a column, containing a complex data type
+        // and append it to string s, running the decoding plan of its type from the node inode
+        // (see IDA_SIARDdatatype_table::compile_plan())
+        void append_complex_data_type_content(string &s, XMLElement *el, const IDA_SIARDtype_plan &plan,
+                                              unsigned long inode = 0)
+        {
+            if (!el) {
+                // Elements missing in table.xml represented as empty
+                s.append("''");
+                return;
+            }
+            const IDA_SIARDtype_plan_node &node = plan[inode];
+            switch (node.kind) {
+                case IDA_SIARDtype_plan_node::SIMPLE:
+                    // Force textify blobs to be json compliant
+                    append_simple_data_type_content(s, el, node.simpletype, true, node.treepath);
+                    break;
+                case IDA_SIARDtype_plan_node::DISTINCT:
+                    append_complex_data_type_content(s, el, plan, node.children[0]);
+                    break;
+                case IDA_SIARDtype_plan_node::ARRAY:
+                case IDA_SIARDtype_plan_node::UDT: {
+                    // Elements <a1>, <a2>, ... or <u1>, <u2>, ...
+                    vector<XMLElement*> elems(node.children.size());
+                    IDA_xml_utils::get_numbered_children(el, node.tag_prefix, elems);
+                    s.append((node.kind == IDA_SIARDtype_plan_node::ARRAY) ? "json_array(\n" : "json_object(\n");
+                    for (unsigned long i = 0; i < elems.size(); i++) {
+                        s.append(node.prefixes[i]);
+                        if (elems[i]) {
+                            append_complex_data_type_content(s, elems[i], plan, node.children[i]);
+                        } else {
+                            // Tag not found: use empty content for this element
+                            s.append("''");
+                        }
+                        if (i + 1 < elems.size()) s.append(",\n"); // Not add separator at the end
+                    }
+                    s.append(")");
+                    if (node.depth > 0) s.append("\n");
+                    break;
+                }
+                case IDA_SIARDtype_plan_node::INTERPRETED:
+                    append_complex_data_type_content(s, el, node.type_schema, node.type_name,
+                                                     node.depth, node.treepath);
+                    break;
+                default:
+                    break;
+            }
+        }
+
+        // Get the content of an element, typically a column, containing a complex data type
+        // and append it to string s, looking up its type in the Data Type Table
+        // (used for types nested too deep to be compiled in a plan)
+        void append_complex_data_type_content(string &s, XMLElement *el,
+                                              const string &siard_typeSchema, const string &siard_typeName,
+                                              long depth= 0, const string &treepath = "")
+        {
+            //-- string content;
+            string indent = string(1+depth, ' ');
+            if (0 || el) {
+                // Found the complex data type in the Data Type Table
+                static const IDA_SIARDtypenode notfound;
+                const IDA_SIARDtypenode *ptnode = DataType_Table.find_typenode(siard_typeSchema, siard_typeName);
+                const IDA_SIARDtypenode &tnode = ptnode ? *ptnode : notfound;
+
+                // If the type is not found in the Data Type Table, it must be a simple type
+                if (tnode.empty()){
+                    // It SHOULD be a simple basic type
+                    // Get the content as it is a simple basic type
+                    // Force textify blobs to be json compliant
+                    //-- string cell_content = append_simple_data_type_content(el, siard_typeName, true, treepath);
+                    //-- //-- cell_content = cell_content.substr(0,63) + ((cell_content.size()>64)?"...":""); // debug get only the first part
+                    //-- content = cell_content;
+                    append_simple_data_type_content(s, el, siard_typeName, true, treepath);
+                }
+                if (!tnode.empty()) {
+                    if (tnode.getCategory() == "array"){
+                        // Arrays must have one unique attribute with is type (simple or complex) and the cardinality
+                        string arr_cat; // Extended category of the type of the array elements
+                        string arr_schema, arr_type; // Type of the element; for complex types arr_schema=typeSchmea, arr_type=typeName;
+                                                     // for simple types only 'arr_type=type' makes sense
+                        unsigned long arr_card;
+                        for (const auto& att: tnode.getAttributeList()) {
+                            arr_cat = att.get_extended_category();
+                            arr_card = att.getCardinality();
+                            arr_schema = att.getTypeSchema();
+                            arr_type= att.getType().empty()?att.getTypeName():att.getType();
+                            break;
+                        }
+
+                        //-- string json_str="json_array(\n";
+                        s.append("json_array(\n");
+                        for (unsigned long i=1; i <= arr_card ; i++){ // Note index starts at 1: <a1></a1>, <a2></a2>...
+                            string atag = "a" + to_string(i);
+                            XMLElement *a = IDA_xml_utils::find_element_by_tag(el, atag, IDA_xml_utils::BF);
+                            if (0 || a) {
+                                //-- string cell_content = append_complex_data_type_content(a, arr_schema,
+                                //--                                                     arr_type, depth + 1,
+                                //--                                                     treepath + "/" + atag);
+                                //-- json_str.append(indent + cell_content);
+                                //-- if (i < arr_card) json_str.append(",\n");
+
+                                s.append(indent);
+                                append_complex_data_type_content(s, a, arr_schema, arr_type, depth + 1,
+                                                                 treepath + "/" + atag);
+                                if (i < arr_card) s.append(",\n");
+                            } else {
+                                // <aN> tag not found for N: use empty content for this element
+                                s.append(indent + "''");
+                                if (i < arr_card) s.append(",\n");
+                            }
+                        }
+                        s.append(")");
+                        if (depth>0) s.append("\n");
+                        //-- content = json_str;
+                    }
+                    else if (tnode.getCategory() == "distinct"){
+                        // 'Distinct' types must have one unique attribute with is base type
+                        string dis_base;
+                        for (const auto& att: tnode.getAttributeList()) {
+                            dis_base = att.getBase();
+                            break;
+                        }
+                        // We assume that the base of a 'distinct' data type is always a simple type
+                        string dis_schema = "";
+                        //-- content = append_complex_data_type_content(el, dis_schema, dis_base, depth + 1, treepath);
+                        append_complex_data_type_content(s, el, dis_schema, dis_base, depth + 1, treepath);
+                    }
+                    else if (tnode.getCategory() == "udt"){
+                        //-- string json_str="json_object(\n";
+                        s.append("json_object(\n");
+                        // Get recursively the content of each UDT attribute
+                        unsigned long att_no = 1;
+                        for (const auto& att: tnode.getAttributeList()) {
+                            string utag = "u" + to_string(att_no++);
+                            XMLElement *u = IDA_xml_utils::find_element_by_tag(el, utag, IDA_xml_utils::BF);
+                            const string& att_name = att.getName();
+                            s.append(indent + "'" + att_name + "', ");
+                            if (0 || u) {
+                                string u_schema, u_type; // Type of the element; for complex types arr_schema=typeSchmea, arr_type=typeName;
+                                                         // for simple types only 'arr_type=type' makes sense
+                                u_schema = att.getTypeSchema();
+                                u_type= att.getType().empty()?att.getTypeName():att.getType();
+                                //-- string att_content = append_complex_data_type_content(u, u_schema,
+                                //--                                                    u_type, depth + 1,
+                                //--                                                    treepath + "/" + att_name);
+                                //-- json_str.append(att_content);
+                                append_complex_data_type_content(s, u, u_schema, u_type, depth + 1,
+                                                                 treepath + "/" + att_name);
+                            } else {
+                                // <uN> tag not found for N: use empty content for this element
+                                //json_str.append(indent + "'" + att_name + "', ");
+                                s.append("''");
+                            }
+                            if (att_no <= tnode.getAttributeList().size()) s.append(",\n"); // Not add separator at the end
+                        }
+                        s.append(")");
+                        if (depth>0) s.append("\n");
+                        //-- content = json_str;
+                    }
+                }
+            }
+            else {
+                // Elements missing in table.xml represented as empty
+                //-- content = "''";
+                s.append("''");
+            }
+            //-- return content;
+            return;
+        }
+
+        // Bind the content of an element, typically a column, to the parameter 'idx' of
+        // a prepared INSERT statement; this is the counterpart of append_simple_data_type_content()
+        // when loading directly into a sqlite3 database, so values are the same that
+        // the generated SQL literals would produce, but no SQL text is formatted nor parsed
+        void bind_simple_data_type_content(sqlite3_stmt *stmt, int idx, XMLElement *el,
+                                           enum IDA_siard_utils::SQLITE_COLTYPES simpletype,
+                                           const string &treepath = "")
+        {
+            if (!el) {
+                // Empty content for void elements
+                sqlite3_bind_text(stmt, idx, "", 0, SQLITE_STATIC);
+                return;
+            }
+
+            string el_file;
+            el_file= IDA_xml_utils::get_attribute_value(el, "file", "");
+
+            if (!el_file.empty()){
+                // Lob in a file: bind its raw content as text if the affinity
+                // of the column is TEXT (like "CAST(X'...' AS TEXT)"), or as blob otherwise
+                string lob_file = get_lob_file(el_file, treepath);
+
+                // Large blobs with a known length are inserted as zeroblob(length) and
+                // streamed into the row once inserted (see write_pending_lobs()); small
+                // ones are inflated in memory and bound directly
+                string el_filelen = IDA_xml_utils::get_attribute_value(el, "length", "");
+                char *endp = NULL;
+                long long lob_size = el_filelen.empty() ? -1 : strtoll(el_filelen.c_str(), &endp, 10);
+                bool indexed = current_col_id < col_indexed.size() && col_indexed[current_col_id];
+                if (simpletype != IDA_siard_utils::COLTYPE_TEXT && !indexed
+                    && lob_size > STREAMED_LOB_MIN_SIZE && endp && !*endp) {
+                    IDA_pending_lob lob;
+                    lob.idx = idx;
+                    lob.colid = current_col_id;
+                    lob.size = lob_size;
+                    lob.lob_file = lob_file;
+                    lob.in.reset(open_lob_stream(lob_file, lob.tmp_lob_file));
+                    if (!lob.in) {
+                        cerr << "Error: opening '" << lob_file << "' (notice: perhaps external file)" << endl;
+                        failures++;
+                        delete_pending_lob_file(lob);
+                        sqlite3_bind_blob(stmt, idx, "", 0, SQLITE_STATIC);
+                        return;
+                    }
+                    sqlite3_bind_zeroblob64(stmt, idx, lob_size);
+                    pending_lobs.push_back(std::move(lob));
+                    stats.lobs++;
+                    stats.lob_bytes += lob_size;
+                    return;
+                }
+
+                // Lobs stored without compression are bound straight from the mapped siard
+                string entry;
+                unsigned long long nstored;
+                const char *p = get_lob_zip_entry(lob_file, entry) ? get_stored_lob(entry, nstored) : NULL;
+                if (p) {
+                    if (simpletype == IDA_siard_utils::COLTYPE_TEXT) {
+                        sqlite3_bind_text64(stmt, idx, p, nstored, SQLITE_STATIC, SQLITE_UTF8);
+                    } else {
+                        sqlite3_bind_blob64(stmt, idx, p, nstored, SQLITE_STATIC);
+                    }
+                    stats.lobs++;
+                    stats.lob_bytes += nstored;
+                    return;
+                }
+
+                string lob;
+                if (!lob_file_append(lob_file, lob, false, (endp && !*endp) ? lob_size : -1)) failures++;
+                stats.lobs++;
+                stats.lob_bytes += lob.size();
+                if (simpletype == IDA_siard_utils::COLTYPE_TEXT) {
+                    sqlite3_bind_text(stmt, idx, lob.data(), lob.size(), SQLITE_TRANSIENT);
+                } else {
+                    sqlite3_bind_blob(stmt, idx, lob.data(), lob.size(), SQLITE_TRANSIENT);
+                }
+                return;
+            }
+
+            const char *t = el->GetText();
+            if (!t) t = "";
+            unsigned long n = strlen(t);
+            stats.text_bytes += n;
+            if (simpletype == IDA_siard_utils::COLTYPE_INTEGER
+                || simpletype == IDA_siard_utils::COLTYPE_REAL
+                || simpletype == IDA_siard_utils::COLTYPE_NUMERIC) {
+                // Numbers are bound as text and converted by the column affinity,
+                // except booleans that are SQL keywords when written as literals
+                if (!strcasecmp(t, "true")) {
+                    sqlite3_bind_int(stmt, idx, 1);
+                } else if (!strcasecmp(t, "false")) {
+                    sqlite3_bind_int(stmt, idx, 0);
+                } else {
+                    sqlite3_bind_text(stmt, idx, t, -1, SQLITE_STATIC);
+                }
+            } else {
+                if (!IDA_siard_utils::find_siard_special(t, n)) {
+                    // The text is kept by tinyxml2 until the row is inserted
+                    sqlite3_bind_text(stmt, idx, t, n, SQLITE_STATIC);
+                } else {
+                    long size = 0;
+                    bool has_specials = false;
+                    uint8_t *col_text_decoded = IDA_siard_utils::siard_decode(t, n, size, has_specials);
+                    if (!col_text_decoded) {
+                        cerr << "Error: malloc failed\n";
+                        throw bad_alloc();
+                    }
+                    // Bind the decoded bytes as text, as there can be char(0) once decoded
+                    sqlite3_bind_text(stmt, idx, (const char*)col_text_decoded, size, free);
+                }
+            }
+        }
+
+        // Bind the value of an SQL expression (e.g. the json_array(...) or json_object(...)
+        // generated for a complex data type) to the parameter 'idx' of a prepared statement
+        void bind_sql_expression(sqlite3_stmt *stmt, int idx, const string &expr)
+        {
+            sqlite3_stmt *sel = NULL;
+            string SQL_select = "SELECT " + expr;
+            int rc = sqlite3_prepare_v2(db, SQL_select.c_str(), -1, &sel, NULL);
+            if (rc == SQLITE_OK && sqlite3_step(sel) == SQLITE_ROW) {
+                sqlite3_bind_value(stmt, idx, sqlite3_column_value(sel, 0));
+            } else {
+                cerr << "Error evaluating complex data type in table '" << tablename << "': "
+                     << sqlite3_errmsg(db) << endl;
+                failures++;
+                sqlite3_bind_text(stmt, idx, "", 0, SQLITE_STATIC);
+            }
+            sqlite3_finalize(sel);
+        }
+
+        // Append to s the SQL expression of a complex data type written by
+        // append_complex_data_type_content(), but with a parameter '?' for each simple
+        // value, so that it can be prepared once per column and bound for each cell
+        // (see bind_complex_data_type_content()). Return false if the plan has types
+        // interpreted for each cell, which cannot be written as a template
+        static bool complex_data_type_template_append(string &s, const IDA_SIARDtype_plan &plan,
+                                                      unsigned long inode = 0)
+        {
+            const IDA_SIARDtype_plan_node &node = plan[inode];
+            switch (node.kind) {
+                case IDA_SIARDtype_plan_node::SIMPLE:
+                    s.append("?");
+                    return true;
+                case IDA_SIARDtype_plan_node::DISTINCT:
+                    return complex_data_type_template_append(s, plan, node.children[0]);
+                case IDA_SIARDtype_plan_node::ARRAY:
+                case IDA_SIARDtype_plan_node::UDT:
+                    s.append((node.kind == IDA_SIARDtype_plan_node::ARRAY) ? "json_array(\n" : "json_object(\n");
+                    for (unsigned long i = 0; i < node.children.size(); i++) {
+                        s.append(node.prefixes[i]);
+                        if (!complex_data_type_template_append(s, plan, node.children[i])) return false;
+                        if (i + 1 < node.children.size()) s.append(",\n");
+                    }
+                    s.append(")");
+                    if (node.depth > 0) s.append("\n");
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Bind a number as the value of its SQL literal, which is an integer or a real
+        // (json_array(1) is [1], while json_array('1') is ["1"]); booleans are keywords
+        // Return false if the text is not a plain number (e.g., "0x1F", "" or "1-2")
+        static bool bind_sql_number(sqlite3_stmt *stmt, int idx, const char *t)
+        {
+            if (!strcasecmp(t, "true") || !strcasecmp(t, "false")) {
+                sqlite3_bind_int(stmt, idx, tolower(t[0]) == 't');
+                return true;
+            }
+            const char *p = t + (*t == '-' || *t == '+');
+            if (!isdigit((unsigned char)*p) && !(*p == '.' && isdigit((unsigned char)p[1]))) return false;
+            if (t[strspn(t, "0123456789.eE+-")]) return false;
+            char *end;
+            errno = 0;
+            long long i = strtoll(t, &end, 10);
+            if (!*end && errno != ERANGE) {
+                sqlite3_bind_int64(stmt, idx, i);
+                return true;
+            }
+            double d = strtod(t, &end);
+            if (*end) return false;
+            sqlite3_bind_double(stmt, idx, d);
+            return true;
+        }
+
+        // Bind the simple values of a cell with a complex data type to the parameters of
+        // the template of its column (see complex_data_type_template_append()), numbered
+        // after 'iparam'. Values are the same that the literals of the SQL expression would
+        // produce. Return false if the cell does not fit the template: an array or udt is
+        // missing (it is '' instead of json_array(...)), or a number is not plain
+        bool bind_complex_data_type_values(sqlite3_stmt *sel, int &iparam, XMLElement *el,
+                                           const IDA_SIARDtype_plan &plan, unsigned long inode = 0)
+        {
+            const IDA_SIARDtype_plan_node &node = plan[inode];
+            switch (node.kind) {
+                case IDA_SIARDtype_plan_node::SIMPLE:
+                    iparam++;
+                    if (el && (node.simpletype == IDA_siard_utils::COLTYPE_INTEGER
+                               || node.simpletype == IDA_siard_utils::COLTYPE_REAL
+                               || node.simpletype == IDA_siard_utils::COLTYPE_NUMERIC)
+                        && !el->Attribute("file")) {
+                        const char *t = el->GetText();
+                        if (!t) t = "";
+                        stats.text_bytes += strlen(t);
+                        return bind_sql_number(sel, iparam, t);
+                    }
+                    // Texts and lobs in files are text (like "CAST(X'...' AS TEXT)"); missing elements are ''
+                    bind_simple_data_type_content(sel, iparam, el, IDA_siard_utils::COLTYPE_TEXT, node.treepath);
+                    return true;
+                case IDA_SIARDtype_plan_node::DISTINCT:
+                    return bind_complex_data_type_values(sel, iparam, el, plan, node.children[0]);
+                case IDA_SIARDtype_plan_node::ARRAY:
+                case IDA_SIARDtype_plan_node::UDT: {
+                    if (!el) return false;
+                    vector<XMLElement*> elems(node.children.size());
+                    IDA_xml_utils::get_numbered_children(el, node.tag_prefix, elems);
+                    for (unsigned long i = 0; i < elems.size(); i++) {
+                        if (!bind_complex_data_type_values(sel, iparam, elems[i], plan, node.children[i])) return false;
+                    }
+                    return true;
+                }
+                default:
+                    return false;
+            }
+        }
+
+        // Bind the value of a cell with a complex data type to the parameter 'idx' of a
+        // prepared statement, evaluating 'sel', the template of its column prepared once
+        // for the whole table (see complex_data_type_template_append()). Without template,
+        // or if the cell does not fit it, its SQL expression is evaluated instead
+        void bind_complex_data_type_content(sqlite3_stmt *stmt, int idx, XMLElement *el,
+                                            const IDA_SIARDtype_plan &plan, sqlite3_stmt *sel)
+        {
+            if (!el) {
+                // Elements missing in table.xml represented as empty
+                sqlite3_bind_text(stmt, idx, "", 0, SQLITE_STATIC);
+                return;
+            }
+            if (sel) {
+                // Counters restored if the cell is converted again from its SQL expression
+                unsigned long long text_bytes = stats.text_bytes, lobs = stats.lobs, lob_bytes = stats.lob_bytes;
+                unsigned long nfailed = failures;
+                int iparam = 0;
+                bool fits = bind_complex_data_type_values(sel, iparam, el, plan);
+                if (fits) {
+                    if (sqlite3_step(sel) == SQLITE_ROW) {
+                        sqlite3_bind_value(stmt, idx, sqlite3_column_value(sel, 0));
+                    } else {
+                        cerr << "Error evaluating complex data type in table '" << tablename << "': "
+                             << sqlite3_errmsg(db) << endl;
+                        failures++;
+                        sqlite3_bind_text(stmt, idx, "", 0, SQLITE_STATIC);
+                    }
+                }
+                sqlite3_reset(sel);
+                sqlite3_clear_bindings(sel);
+                if (fits) return;
+                stats.text_bytes = text_bytes;
+                stats.lobs = lobs;
+                stats.lob_bytes = lob_bytes;
+                failures = nfailed;
             }
+            string expr;
+            append_complex_data_type_content(expr, el, plan);
+            bind_sql_expression(stmt, idx, expr);
+        }
+
+    public:
+
+        // Out a string with the SQL statements to insert all data in columns
+        // Extra info can be inserted as sql comments controled by verbose:
+        //   verbose=0 (no info), 1 (table info), 2 (extra table info), 3 (per column info)
+        void tree_to_sql(int verbose = 0)
+        {
+            if (loaded) {
+                double t_start = IDA_seconds(), read_start = read_time;
+                sqlite3_int64 db_start = db ? db_bytes() : 0;
+
+                // Rows are streamed: get the first one before looking at the <table> attributes
+                XMLElement *row = next_row();
+
+                string version;
+                version = get_root_attribute_value("version", "unknown");
+                (verbose > 0) && sqlout << "-- table name=" << tablename << " version=" << version << endl;
+
+                // Expression for column tags: <c1>...</c1> <c2>...</c2>
+                // const regex col_tag_re("c[0-9].*");
+
+                // Precompute column invariants
+                vector<string> col_cplx_typeSchema(ncols), col_cplx_type(ncols);
+                vector<enum IDA_siard_utils::SQLITE_COLTYPES> col_simple_type(ncols);
+                for (unsigned long colid = 0; colid < ncols; colid++){
+                    col_cplx_typeSchema[colid] = siard_coltype_v[colid].getTypeSchema();
+                    col_cplx_type[colid] = siard_coltype_v[colid].getTypeOrTypeName();
+                    col_simple_type[colid] = IDA_siard_utils::siard_type_to_sqlite3(col_cplx_type[colid]);
+                }
+
+                // Parameter of each column converted in the INSERT statement (0 if skipped),
+                // and the last column converted
+                vector<bool> skipped(ncols, false);
+                vector<int> col_param(ncols, 0);
+                unsigned long lastcol = 0;
+                for (unsigned long colid = 0, nparam = 0; colid < ncols; colid++){
+                    skipped[colid] = colid < col_skipped.size() && col_skipped[colid];
+                    if (!skipped[colid]) {
+                        col_param[colid] = ++nparam;
+                        lastcol = colid;
+                    }
+                }
+
+                //-- string colcontent;
+                string SQL_insert_into_start = "INSERT INTO '" + tablename + "' VALUES (";
+
+                // When loading directly into a sqlite3 database, prepare the INSERT once
+                // and bind the values of each row: INSERT INTO 't' VALUES (?1, ?2, ...)
+                sqlite3_stmt *stmt = NULL;
+                if (db) {
+                    string SQL_insert_into_stmt = SQL_insert_into_start;
+                    for (unsigned long colid = 0; colid < ncols; colid++) {
+                        if (skipped[colid]) continue;
+                        SQL_insert_into_stmt += "?" + to_string(col_param[colid]);
+                        if (colid < lastcol) SQL_insert_into_stmt += ",";
+                    }
+                    SQL_insert_into_stmt += ");";
+                    if (sqlite3_prepare_v2(db, SQL_insert_into_stmt.c_str(), -1, &stmt, NULL) != SQLITE_OK) {
+                        cerr << "Error preparing INSERT for table '" << tablename << "': " << sqlite3_errmsg(db) << endl;
+                        failures++;
+                        sqlite3_finalize(stmt);
+                        return;
+                    }
+                    sqlite3_exec(db, "BEGIN;", NULL, NULL, NULL);
+                } else if (bulk) {
+                    sqlout << "BEGIN;\n";
+                }
+
+                // The initial treepath of each column is something like "/columnname"
+                vector<string> col_treepath0(ncols);
+                for (unsigned long colid = 0; colid < ncols; colid++){
+                    col_treepath0[colid] = "/" + siard_colname_v[colid];
+                }
+
+                // Compile the decoding plans of the columns with complex data types
+                vector<IDA_SIARDtype_plan> col_plan(ncols);
+                for (unsigned long colid = 0; colid < ncols; colid++){
+                    if (!col_cplx_typeSchema[colid].empty()) {
+                        DataType_Table.compile_plan(col_plan[colid], col_cplx_typeSchema[colid], col_cplx_type[colid],
+                                                    0, col_treepath0[colid]);
+                    }
+                }
+
+                // When loading into a sqlite3 database, the SQL expression of each column
+                // with a complex data type is prepared once, with the values as parameters
+                vector<sqlite3_stmt*> col_select(ncols, NULL);
+                for (unsigned long colid = 0; db && colid < ncols; colid++){
+                    string SQL_select = "SELECT ";
+                    if (!col_cplx_typeSchema[colid].empty()
+                        && complex_data_type_template_append(SQL_select, col_plan[colid])
+                        && sqlite3_prepare_v2(db, SQL_select.c_str(), -1, &col_select[colid], NULL) != SQLITE_OK) {
+                        sqlite3_finalize(col_select[colid]);
+                        col_select[colid] = NULL;
+                    }
+                }
+
+                // Columns of the current row, indexed by colid
+                vector<XMLElement*> row_cols(ncols);
+
+                unsigned long batch_count = 0, batch_bytes = 0, txn_count = 0;
+                for (unsigned long ir = 0; row; ir++, row = next_row()) {
+                    if (verbose > 1) {
+                        string row_name = "r" + to_string(ir);
+                        sqlout << "--  bogus rowname='" << row_name << "'" << endl;
+                        sqlout << "--  no. of columns in table='" << ncols << "'" << endl;
+                    }
+
+                    // Traverse columns of the row and write its corresponding INSERT statement
+                    string SQL_insert_into;
+                    if (!stmt) SQL_insert_into = (batch_count == 0) ? SQL_insert_into_start : ",\n(";
+
+                    // Tags of the columns are <c1></c1> <c2></c2>...
+                    // Column number is the integer after the 'c': c1, c2, ...
+                    // Notice the first column is numbered with 1: c1 !!
+                    IDA_xml_utils::get_row_columns(row, row_cols);
+
+                    // Iterate over the columns of this row
+                    for (unsigned long colid = 0; colid < ncols; colid++){
+                        if (skipped[colid]) continue;
+                        XMLElement *col = row_cols[colid];
+                        if (col) stats.cells++;
+
+                        // This is a little dirty trick, using a member for the col id as global
+                        current_col_id = colid;
+
+                        (verbose > 2) && sqlout << "--  bogus columnname='c" << colid + 1 << "'" << endl;
+
+                        // Let's generate the column content depending on it is simple or complex data type
+                        string &col_siard_typeSchema = col_cplx_typeSchema[colid];
+                        const string &treepath0 = col_treepath0[colid];
+                        // Simple types has no typeSchema, so generate complex content (json) only for complex data types
+                        if (col_siard_typeSchema.empty()) {
+                            // Simple: INTEGER, REAL, NUMERIC, BLOB, TEXT
+                            if (stmt) {
+                                bind_simple_data_type_content(stmt, col_param[colid], col, col_simple_type[colid], treepath0);
+                            } else {
+                                //-- colcontent = append_simple_data_type_content(col, col_simple_type[colid], false, treepath0); // It's fast using sqlite types
+                                append_simple_data_type_content(SQL_insert_into, col, col_simple_type[colid], false,
+                                                                treepath0); // It's fast using sqlite types
+                            }
+                        } else {
+                            // Complex: distinct, udt, array
+                            if (stmt) {
+                                bind_complex_data_type_content(stmt, col_param[colid], col, col_plan[colid],
+                                                               col_select[colid]);
+                            } else {
+                                //-- colcontent = append_complex_data_type_content(col, col_siard_typeSchema, col_siard_type, 0, treepath0);
+                                append_complex_data_type_content(SQL_insert_into, col, col_plan[colid]);
+                            }
+                        }
+
+
+                        //-- SQL_insert_into += colcontent;
+                        if (!stmt && colid < lastcol) SQL_insert_into += ",\n";
+
+                        #if 0
+                        {
+                            // Debug complex types
+                            string col_siard_typeSchema = siard_coltype_v[colid].getTypeSchema();
+                            string col_siard_type = siard_coltype_v[colid].getTypeOrTypeName();
+                            string col_cplx_content = append_complex_data_type_content(siard_dir, col,
+                                                                                    col_siard_typeSchema,
+                                                                                    col_siard_type);
+                            // For debugging purpose remove large hex sequences
+                            static regex re_largehex("(X'[0-9a-fA-F]{1,31})", std::regex::optimize);
+                            col_cplx_content = regex_replace(col_cplx_content, re_largehex, "$1...");
+                            static regex re_largehex2("[0-9a-fA-F]{32,1000}", std::regex::optimize);
+                            col_cplx_content = regex_replace(col_cplx_content, re_largehex2, "");
+
+                            cerr << "\033[1;33m---complex data start column=" << tablename << ":" << siard_colname_v
+                                 << " (" << col_siard_typeSchema << "," << col_siard_type << ")" << endl
+                                 << "\033[1;31m"
+                                 << col_cplx_content
+                                 << endl << "\033[1;32m---complex data end\033[m" << endl;
+                        }
+                        #endif
+                    }
+
+                    if (stmt) {
+                        if (sqlite3_step(stmt) != SQLITE_DONE) {
+                            cerr << "Error inserting row " << ir << " into table '" << tablename << "': "
+                                 << sqlite3_errmsg(db) << endl;
+                            failures++;
+                            clear_pending_lobs();
+                        } else if (!pending_lobs.empty()) {
+                            write_pending_lobs();
+                        }
+                        sqlite3_reset(stmt);
+                        sqlite3_clear_bindings(stmt);
+                    } else {
+                        // Close the statement if the batch is full
+                        SQL_insert_into += ")";
+                        batch_bytes += SQL_insert_into.size();
+                        if (++batch_count >= batch_rows || batch_bytes >= BATCH_MAX_BYTES) {
+                            SQL_insert_into += ";\n";
+                            batch_count = batch_bytes = 0;
+                        }
+                        sqlout << SQL_insert_into;
+                        stats.out_bytes += SQL_insert_into.size();
+                    }
+
+                    // Split the load in several transactions
+                    if (commit_rows && ++txn_count >= commit_rows) {
+                        txn_count = 0;
+                        if (stmt) {
+                            sqlite3_exec(db, "COMMIT; BEGIN;", NULL, NULL, NULL);
+                        } else {
+                            if (batch_count) sqlout << ";\n";
+                            batch_count = batch_bytes = 0;
+                            sqlout << "COMMIT;\nBEGIN;\n";
+                        }
+                    }
+                }
+                if (batch_count) sqlout << ";\n";
+                if (read_failed()) {
+                    cerr << "Error: table XML of '" << tablename << "' not read to the end, rows may be missing" << endl;
+                    failures++;
+                }
+
+                (verbose > 1)  && sqlout << "-- no. of rows=" << get_nrows() << endl;
+
+                if (stmt) {
+                    sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+                    sqlite3_finalize(stmt);
+                    for (auto sel: col_select) sqlite3_finalize(sel);
+                    stats.out_bytes = std::max(db_bytes() - db_start, (sqlite3_int64) 0);
+                } else if (bulk) {
+                    sqlout << "COMMIT;\n";
+                }
+                stats.emit_time = (IDA_seconds() - t_start) - (read_time - read_start);
+            } /* if (loaded) */
         }
 
     private:
-        // Get the content of an element, typically a column and append it to string s
-        // If textifyblob=true, force sqlite blobs (X'00FF...') to be cast to TEXT; this feature is used when
-        // generating json of complex data types
-        //
-        // Version using the SIARD type string ("CHAR(12)", "INTEGER", "TEXT", ...)
-        void append_simple_data_type_content(string &s, XMLElement *el, const string &siard_type,
-                                             bool textifyblob= false, const string &treepath = ""){
-            enum IDA_siard_utils::SQLITE_COLTYPES simpletype = IDA_siard_utils::siard_type_to_sqlite3(siard_type);
-            append_simple_data_type_content(s, el, simpletype, textifyblob, treepath);
-            return;
+        // Size of the main database of db (pages in use), to measure what a table adds
+        sqlite3_int64 db_bytes()
+        {
+            sqlite3_stmt *st = NULL;
+            sqlite3_int64 bytes = 0;
+            if (sqlite3_prepare_v2(db, "SELECT (P.page_count - F.freelist_count) * S.page_size"
+                                       " FROM pragma_page_count() AS P, pragma_freelist_count() AS F,"
+                                       " pragma_page_size() AS S;", -1, &st, NULL) == SQLITE_OK
+                && sqlite3_step(st) == SQLITE_ROW) {
+                bytes = sqlite3_column_int64(st, 0);
+            }
+            sqlite3_finalize(st);
+            return bytes;
         }
-        // Version using the sqlite type enum (IDA_siard_utils::COLTYPE_INTEGER, ...)
-        // It's more efficient for simple types because the enum can be precomputed
-        void append_simple_data_type_content(string &s, XMLElement *el, enum IDA_siard_utils::SQLITE_COLTYPES simpletype,
-                                             bool textifyblob= false, const string &treepath = "")
+
+    }; /* class IDA_SIARDcontent */
+
+    // Conversion of the content of one table, as done by IDA_SIARDmetadata::tree_to_sql()
+    // All the information is copied, so that the job can be run by another thread
+    class IDA_SIARDtable_job {
+        string table_name;
+        string siardURI;
+        string tmpdir;
+        enum unzipmode_e unzipmode;
+        unsigned long ncols;
+        vector<string> siard_colname_v;
+        vector<IDA_SIARD_type_attribute> siard_coltype_v;
+        vector<IDA_SIARDlobfolder> siard_lobfolder_info_v;
+
+    public:
+        string table_file;         // Path of the table<N>.xml file ...
+        string table_entry;        // ... or name of the entry inside the siard zip
+        bool table_file_in_zip = false;
+        bool table_file_ok = false;
+        string SQL_create_table;   // Needed to create the table in a private database
+        bool pipelined = false;    // See IDA_SIARDcontent::set_pipelined()
+        bool bulk = false;         // See IDA_SIARDcontent::set_bulk()
+        unsigned long batch_rows = 1;
+        unsigned long commit_rows = 0;
+        int verbose = 0;
+        vector<bool> col_skipped;  // See IDA_SIARDcontent::set_skipped_columns()
+        vector<bool> col_indexed;  // See IDA_SIARDcontent::set_indexed_columns()
+        unsigned long row_limit = 0;  // See IDA_SIARDcontent::set_sampling()
+        unsigned long row_every = 1;
+        IDA_SIARDtable_stats *stats = NULL; // If not NULL, counters and times are added to it
+
+        // Results when run in parallel (see IDA_SIARDtable_pool)
+        ostringstream sqlout;
+        unsigned char *sqlite_image = NULL;  // Serialized private database
+        sqlite3_int64 sqlite_image_size = 0;
+        bool done = false;
+        unsigned long nrows = 0;   // Number of rows converted
+        unsigned long nfailed = 0; // See IDA_SIARDcontent::get_failures()
+
+        IDA_SIARDtable_job(const string &table_name,
+                           const string &siardURI, const string &tmpdir, enum unzipmode_e unzipmode,
+                           unsigned long ncols,
+                           const vector<string> &siard_colname_v,
+                           const vector<IDA_SIARD_type_attribute> &siard_coltype_v,
+                           const vector<IDA_SIARDlobfolder> &siard_lobfolder_info_v)
+                           :
+                table_name(table_name), siardURI(siardURI), tmpdir(tmpdir), unzipmode(unzipmode),
+                ncols(ncols), siard_colname_v(siard_colname_v),
+                siard_coltype_v(siard_coltype_v), siard_lobfolder_info_v(siard_lobfolder_info_v)
+        {}
+
+        ~IDA_SIARDtable_job()
         {
-            if (!el) {
-                // Return empty content for void elements
-                s.append("''");
+            sqlite3_free(sqlite_image);
+        }
+
+        const string &get_table_name() const
+        {
+            return table_name;
+        }
+
+        // Convert the table, writing the SQL to out, or inserting rows into db if not NULL
+        void run(ostream &out, sqlite3 *db = NULL)
+        {
+            // Read the table file to generate SQL for data insertion
+            if (table_file_ok) {
+                // Parse and print the table xml file
+                IDA_SIARDcontent C(table_name,
+                                   siardURI, tmpdir, unzipmode,
+                                   out,
+                                   ncols,
+                                   siard_colname_v,
+                                   siard_coltype_v, siard_lobfolder_info_v,
+                                   db);
+                C.set_pipelined(pipelined);
+                C.set_bulk(bulk, batch_rows, commit_rows);
+                C.set_skipped_columns(col_skipped);
+                C.set_indexed_columns(col_indexed);
+                C.set_sampling(row_limit, row_every);
+                int errl = table_file_in_zip ? C.load_from_zip(siardURI, table_entry)
+                                             : C.load(table_file);
+                (verbose > 2) && table_file_in_zip && out << "->" << (!errl?" XML file OK":" XML file not found") << endl;
+                //C.print_tree();              //debug
+                //cerr << ">>>---<<<" << endl; // debug
+                //C.print_full_tree();         // debug
+                //cerr << ">>>---<<<" << endl; // debug
+                if (!errl) {
+                    C.tree_to_sql(std::max(0, verbose - 3));
+                    nrows = C.get_converted_rows();
+                    nfailed = C.get_failures();
+                    if (stats) {
+                        IDA_SIARDtable_stats st = C.get_stats();
+                        st.schema = stats->schema;
+                        st.table = stats->table;
+                        st.unzip_time += stats->unzip_time; // Extraction of the table file
+                        *stats = st;
+                    }
+                    cerr << "OK converting '" << table_file << "' to sql" << endl; // Debug
+                } else {
+                    cerr << "Error loading file '" << table_file << "'" << endl;
+                    nfailed++;
+                }
+            }
+
+        #ifndef IDA_FULL_UNZIP
+            if (!table_file_in_zip) IDA_file_utils::delete_temp_file(tmpdir, table_file);
+        #endif
+        }
+
+        // Convert the table into private results (sqlout, and sqlite_image if to_sqlite)
+        // When converting to sqlite3, rows are inserted into a private in-memory
+        // database, which is serialized to be merged later
+        void run_private(bool to_sqlite)
+        {
+            if (!to_sqlite) {
+                run(sqlout);
+                return;
+            }
+            sqlite3 *pdb = NULL;
+            if (sqlite3_open(":memory:", &pdb) != SQLITE_OK) {
+                cerr << "Error opening private database for table '" << table_name << "'" << endl;
+                nfailed++;
+                sqlite3_close(pdb);
                 return;
             }
+            char *errmsg = NULL;
+            if (sqlite3_exec(pdb, SQL_create_table.c_str(), NULL, NULL, &errmsg) == SQLITE_OK) {
+                run(sqlout, pdb);
+                sqlite_image = sqlite3_serialize(pdb, "main", &sqlite_image_size, 0);
+            } else {
+                cerr << "Error creating table '" << table_name << "' in private database: " << (errmsg ? errmsg : "") << endl;
+                nfailed++;
+            }
+            sqlite3_free(errmsg);
+            sqlite3_close(pdb);
+        }
 
-            //cerr << ANSI_COLOR_MAGENTA << "coltype=" << IDA_siard_utils::coltype_to_str(simpletype)
-            //     << " treepath='" << treepath << "'" << ANSI_COLOR_RESET << endl; // Debug
+        // Copy the rows of the private database (see run_private()) into db
+        int merge_into(sqlite3 *db)
+        {
+            if (!sqlite_image) return -1;
+            char *errmsg = NULL;
+            int rc = sqlite3_exec(db, "ATTACH ':memory:' AS ida_table_job;", NULL, NULL, &errmsg);
+            if (rc == SQLITE_OK) {
+                // The image is freed by sqlite3 when detached
+                rc = sqlite3_deserialize(db, "ida_table_job", sqlite_image, sqlite_image_size, sqlite_image_size,
+                                         SQLITE_DESERIALIZE_FREEONCLOSE);
+                sqlite_image = NULL;
+                if (rc == SQLITE_OK) {
+                    string sql = "INSERT INTO main.'" + table_name + "' SELECT * FROM ida_table_job.'" + table_name + "';";
+                    rc = sqlite3_exec(db, sql.c_str(), NULL, NULL, &errmsg);
+                }
+                sqlite3_exec(db, "DETACH ida_table_job;", NULL, NULL, NULL);
+            }
+            if (rc != SQLITE_OK) {
+                cerr << "Error merging table '" << table_name << "' into sqlite3 database: "
+                     << (errmsg ? errmsg : sqlite3_errmsg(db)) << endl;
+            }
+            sqlite3_free(errmsg);
+            return (rc == SQLITE_OK) ? 0 : -1;
+        }
+    }; /* class IDA_SIARDtable_job */
 
-            //-- string content;
-            string el_file;
-            el_file= IDA_xml_utils::get_attribute_value(el, "file", "");
-            string el_filelen;
-            el_filelen= IDA_xml_utils::get_attribute_value(el, "length", "");
+#ifdef IDA_THREADS
+    // Pool of threads converting tables in parallel, with an ordered merge of the results
+    //
+    // The SQL written by the main loop (create table, indexes, ...) is read from 'pending'
+    // each time a table job is submitted, so that the output is a sequence of steps
+    // (text, job, text, job, ...). Steps are written to 'out' (or executed in 'db'
+    // if not NULL) in the same order, thus the result is the same as the serial conversion
+    class IDA_SIARDtable_pool {
+        struct step {
+            string text;
+            IDA_SIARDtable_job *job;
+            // Called once the text is output, with the rows of the last job (see after())
+            std::function<void(unsigned long)> fn;
+        };
 
-            // If there is a file, the value to insert is the
-            // hexadecimal sqlite blob form X'12abcdef' of
-            // the file content  (text, blob, clob, vartext, ...)
-            if (!el_file.empty()){
-                string lob_file;
-                string lob_literal;
-                // Get the full canonical lobfoler asssociated to this treepath, if any
-                string lobfolder = siard_lobfolder_info_v[current_col_id].get_real_lobfoler(treepath);
+        unsigned long njobs;
+        ostream &out;
+        sqlite3 *db;
+        ostringstream &pending;
+
+        std::deque<step> steps;                 // Accessed only by the main thread
+        std::deque<IDA_SIARDtable_job*> queue;  // Jobs waiting for a worker
+        vector<std::thread> workers;
+        std::mutex m;
+        std::condition_variable cv_work, cv_done;
+        bool stop = false;
+        unsigned long njob_steps = 0;           // Steps with a job
+        unsigned long last_nrows = 0;           // Rows of the last job output (see after())
+        unsigned long failures = 0;             // See get_failures()
+
+        void worker()
+        {
+            for (;;) {
+                IDA_SIARDtable_job *job;
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_work.wait(lk, [this]{ return stop || !queue.empty(); });
+                    if (stop) return;
+                    job = queue.front();
+                    queue.pop_front();
+                }
+                try {
+                    job->run_private(db != NULL);
+                } catch (const std::exception &e) {
+                    cerr << "*EXCEPTION converting table '" << job->get_table_name() << "'; what: '" << e.what() << "'" << endl;
+                    job->nfailed++;
+                } catch (...) {
+                    cerr << "*Unknown EXCEPTION converting table '" << job->get_table_name() << "'" << endl;
+                    job->nfailed++;
+                }
+                {
+                    std::lock_guard<std::mutex> lk(m);
+                    job->done = true;
+                }
+                cv_done.notify_all();
+            }
+        }
 
-                if (lobfolder.empty()) {
-                    //lob_file = siard_dir + "/" + el_file;
-                    lob_file = IDA_SIARDlobfolder::combine_lobfolders(siardURI, el_file);
-                } else {
-                    //lob_file = lobfolder + "/" + el_file;
-                    lob_file = IDA_SIARDlobfolder::combine_lobfolders(lobfolder, el_file);
+        // Output the text of a step, in order
+        void output(const string &text)
+        {
+            if (text.empty()) return;
+            if (db) {
+                char *errmsg = NULL;
+                if (sqlite3_exec(db, text.c_str(), NULL, NULL, &errmsg) != SQLITE_OK) {
+                    cerr << "Error executing SQL in sqlite3 database: " << (errmsg ? errmsg : "") << endl;
+                    failures++;
                 }
+                sqlite3_free(errmsg);
+            } else {
+                out << text;
+            }
+        }
 
-                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
-                    // If the affinity of this column is TEXT, cast the hex blob
-                    // form to text type
-                    //-- content = "CAST(";
-                    s.append("CAST(");
+        // Output the steps already finished, in order
+        // If wait is true, wait for all of them
+        void drain(bool wait)
+        {
+            while (!steps.empty()) {
+                step &st = steps.front();
+                if (st.job) {
+                    std::unique_lock<std::mutex> lk(m);
+                    if (!st.job->done && !wait) break;
+                    cv_done.wait(lk, [&st]{ return st.job->done; });
+                }
+                output(st.text);
+                if (st.fn) st.fn(last_nrows);
+                if (st.job) {
+                    output(st.job->sqlout.str());
+                    if (db && st.job->merge_into(db)) failures++;
+                    failures += st.job->nfailed;
+                    last_nrows = st.job->nrows;
+                    delete st.job;
+                    njob_steps--;
+                }
+                steps.pop_front();
+            }
+        }
+
+    public:
+        IDA_SIARDtable_pool(unsigned long njobs, ostream &out, sqlite3 *db, ostringstream &pending)
+            : njobs(njobs), out(out), db(db), pending(pending)
+        {
+            for (unsigned long i = 0; i < njobs; i++) {
+                workers.push_back(std::thread(&IDA_SIARDtable_pool::worker, this));
+            }
+        }
+
+        ~IDA_SIARDtable_pool()
+        {
+            {
+                std::lock_guard<std::mutex> lk(m);
+                stop = true;
+            }
+            cv_work.notify_all();
+            for (auto &w: workers) w.join();
+            for (auto &st: steps) delete st.job;
+        }
+
+        // Queue the conversion of a table (the pool takes ownership of the job)
+        void submit(IDA_SIARDtable_job *job)
+        {
+            steps.push_back({pending.str(), job, nullptr});
+            pending.str("");
+            njob_steps++;
+            {
+                std::lock_guard<std::mutex> lk(m);
+                queue.push_back(job);
+            }
+            cv_work.notify_one();
+            drain(false);
+            // Limit the number of results kept in memory
+            while (njob_steps > 2 * njobs) {
+                step &st = steps.front();
+                {
+                    std::unique_lock<std::mutex> lk(m);
+                    cv_done.wait(lk, [&st]{ return st.job->done; });
+                }
+                drain(false);
+            }
+        }
+
+        // Call fn(rows of the last submitted job) once that job and the text written
+        // to 'pending' after it have been output (e.g., to record a checkpoint)
+        void after(std::function<void(unsigned long)> fn)
+        {
+            steps.push_back({pending.str(), NULL, fn});
+            pending.str("");
+            drain(false);
+        }
+
+        // Output everything, waiting for the pending jobs
+        void finish()
+        {
+            steps.push_back({pending.str(), NULL, nullptr});
+            pending.str("");
+            drain(true);
+        }
+
+        // Errors of the jobs output so far (see IDA_SIARDcontent::get_failures()),
+        // plus the SQL statements and merges that failed
+        unsigned long get_failures() const
+        {
+            return failures;
+        }
+    }; /* class IDA_SIARDtable_pool */
+#endif
+
+    // Summary of the schemas of a SIARD archive (names, folders, columns, types,
+    // keys and number of rows of each table), built in one pass over header/metadata.xml
+    //
+    // It can be saved to a compact binary file (the catalog cache) so that listing
+    // the schemas of an archive later does not need to unzip and parse metadata.xml
+    // again. The cache is only valid for the same archive: its size, modification time
+    // and the CRC-32 of header/metadata.xml (taken from the zip central directory)
+    // are stored in the file and checked when loading it, that is made with mmap().
+    //
+    // File layout (native byte order, as the cache is local to one machine):
+    //   header (IDA_SIARDcatalog_header), followed by the payload, where strings are
+    //   a uint32 length plus their bytes, counts are uint32 and rows int64:
+    //     version nschemas { name folder ntables { name folder rows
+    //         ncolumns { name type typeOriginal lobFolder nullable(uint8) }
+    //         npk { column } nfk { name referencedSchema referencedTable
+    //         nrefs { column referenced } } } }
+    struct IDA_SIARDcatalog_column {
+        string name, type, type_original, lob_folder;
+        bool nullable = true;
+    };
+
+    struct IDA_SIARDcatalog_foreign_key {
+        string name, referenced_schema, referenced_table;
+        vector<string> columns, referenced;
+    };
+
+    struct IDA_SIARDcatalog_table {
+        string name, folder;
+        long rows = 0;
+        vector<IDA_SIARDcatalog_column> columns;
+        vector<string> primary_key;
+        vector<IDA_SIARDcatalog_foreign_key> foreign_keys;
+    };
+
+    struct IDA_SIARDcatalog_schema {
+        string name, folder;
+        vector<IDA_SIARDcatalog_table> tables;
+    };
+
+    struct IDA_SIARDcatalog_header {
+        char magic[8];                   // IDA_SIARDcatalog::magic
+        uint32_t format;                 // IDA_SIARDcatalog::format
+        uint32_t metadata_crc;           // CRC-32 of header/metadata.xml
+        uint64_t metadata_size;          // Uncompressed size of header/metadata.xml
+        uint64_t archive_size;           // Size of the archive
+        int64_t archive_mtime;           // Modification time of the archive (s)
+        int64_t archive_mtime_ns;        // and its nanoseconds
+        uint64_t payload_size;           // Bytes following this header
+    };
+
+    class IDA_SIARDcatalog {
+    public:
+        static constexpr const char *magic = "S2SCATLG";
+        static const uint32_t format = 1;
+
+        string version;
+        vector<IDA_SIARDcatalog_schema> schemas;
+
+        // Key of the archive this catalog was built from (see set_key())
+        IDA_SIARDcatalog_header key = {};
+
+        void clear()
+        {
+            version.clear();
+            schemas.clear();
+            key = {};
+        }
+
+        bool empty() const { return schemas.empty() && version.empty(); }
+
+        // Fill the catalog from the root element <siardArchive> of metadata.xml
+        void build(XMLElement *root)
+        {
+            version.clear();
+            schemas.clear();
+            if (!root) return;
+
+            version = IDA_xml_utils::get_attribute_value(root, "version", "unknown");
+
+            vector<XMLElement*> xschemas;
+            IDA_xml_utils::find_elements_by_tag(root, "schema", xschemas, 2);
+            schemas.resize(xschemas.size());
+            for (unsigned long is = 0; is < xschemas.size(); is++) {
+                XMLElement *sch = xschemas[is];
+                IDA_SIARDcatalog_schema &S = schemas[is];
+                S.name = IDA_xml_utils::find_elementText_by_tag(sch, "name");
+                S.folder = IDA_xml_utils::find_first_child_elementText_by_tag(sch, "folder");
+
+                vector<XMLElement*> tables; // <tables> <table> ...</table> ... </tables>
+                XMLElement *schema_tables = IDA_xml_utils::find_element_by_tag(sch, "tables");
+                IDA_xml_utils::find_elements_by_tag(schema_tables, "table", tables, 1);
+                S.tables.resize(tables.size());
+                for (unsigned long it = 0; it < tables.size(); it++) {
+                    build_table(tables[it], S.tables[it]);
+                }
+            }
+        }
+
+        // Set the key identifying the archive (see the header above)
+        // Return -1 if the archive or its header/metadata.xml are not found
+        int set_key(const string &archive)
+        {
+            struct stat st;
+            if (stat(archive.c_str(), &st) || !S_ISREG(st.st_mode)) return -1;
+
+            unsigned long crc = 0;
+            unsigned long long size = 0;
+            if (IDA_unzip_entry_info(archive.c_str(), "header/metadata.xml", &crc, &size)) return -1;
+
+            key = {};
+            memcpy(key.magic, magic, sizeof(key.magic));
+            key.format = format;
+            key.metadata_crc = crc;
+            key.metadata_size = size;
+            key.archive_size = st.st_size;
+            key.archive_mtime = st.st_mtime;
+        #ifndef __ivm64__
+            key.archive_mtime_ns = st.st_mtim.tv_nsec;
+        #endif
+            return 0;
+        }
+
+        // File where the catalog of an archive is cached: "<archive>.catalog" next to
+        // the archive, or "<basename>.<hash of its full path>.catalog" in 'cachedir'
+        static string cache_file(const string &archive, const string &cachedir)
+        {
+            if (cachedir.empty()) return archive + ".catalog";
+
+            // FNV-1a hash of the path, so that archives with the same name do not collide
+            uint64_t h = 14695981039346656037ULL;
+            for (unsigned char c: archive) {
+                h = (h ^ c) * 1099511628211ULL;
+            }
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) h);
+            return cachedir + "/" + IDA_file_utils::get_basename(archive) + "." + hex + ".catalog";
+        }
+
+        // Write the catalog to a file; it is written to a temporary file which is
+        // renamed, so readers never see a partial catalog
+        // Return 0 if ok, -1 if error
+        int save(const string &file) const
+        {
+            string payload;
+            put(payload, version);
+            put(payload, (uint32_t) schemas.size());
+            for (auto &S: schemas) {
+                put(payload, S.name);
+                put(payload, S.folder);
+                put(payload, (uint32_t) S.tables.size());
+                for (auto &T: S.tables) {
+                    put(payload, T.name);
+                    put(payload, T.folder);
+                    put(payload, (int64_t) T.rows);
+                    put(payload, (uint32_t) T.columns.size());
+                    for (auto &C: T.columns) {
+                        put(payload, C.name);
+                        put(payload, C.type);
+                        put(payload, C.type_original);
+                        put(payload, C.lob_folder);
+                        put(payload, (uint8_t) C.nullable);
+                    }
+                    put(payload, T.primary_key);
+                    put(payload, (uint32_t) T.foreign_keys.size());
+                    for (auto &F: T.foreign_keys) {
+                        put(payload, F.name);
+                        put(payload, F.referenced_schema);
+                        put(payload, F.referenced_table);
+                        put(payload, F.columns);
+                        put(payload, F.referenced);
+                    }
                 }
+            }
+
+            IDA_SIARDcatalog_header h = key;
+            h.payload_size = payload.size();
+
+            string tmpfile = file + ".tmpXXXXXX";
+            vector<char> tmpname(tmpfile.begin(), tmpfile.end());
+            tmpname.push_back('\0');
+            int fd = mkstemp(tmpname.data());
+            if (fd < 0) return -1;
+            bool ok = write_all(fd, (const char*) &h, sizeof(h)) && write_all(fd, payload.data(), payload.size());
+            ok = !close(fd) && ok;
+            if (ok) ok = !rename(tmpname.data(), file.c_str());
+            if (!ok) unlink(tmpname.data());
+            return ok ? 0 : -1;
+        }
+
+        // Load the catalog cached in 'file' if it was built from an archive with
+        // the key set by set_key()
+        // Return 0 if ok, -1 if the file does not exist, is stale or damaged
+        int load(const string &file)
+        {
+            int fd = open(file.c_str(), O_RDONLY);
+            if (fd < 0) return -1;
+            struct stat st;
+            if (fstat(fd, &st) || (unsigned long) st.st_size < sizeof(IDA_SIARDcatalog_header)) {
+                close(fd);
+                return -1;
+            }
+            unsigned long size = st.st_size;
+
+        #ifdef IDA_HAVE_MMAP
+            void *m = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            close(fd);
+            if (m == MAP_FAILED) return -1;
+            int rc = parse((const char*) m, size);
+            munmap(m, size);
+        #else
+            // No mmap() available (e.g., ivm64): read the whole file
+            vector<char> buf(size);
+            bool readok = IDA_file_utils::read_all(fd, buf.data(), size);
+            close(fd);
+            int rc = readok ? parse(buf.data(), size) : -1;
+        #endif
+            return rc;
+        }
+
+        // Count the tables, rows and cells (rows*columns) of one schema
+        static void get_schema_stats(const IDA_SIARDcatalog_schema &S, long &ntables, long &nrows, long &ncells)
+        {
+            ntables = S.tables.size();
+            nrows = 0;
+            ncells = 0;
+            for (auto &T: S.tables) {
+                nrows += T.rows;
+                ncells += T.rows * (long) T.columns.size();
+            }
+        }
+
+        // Print the summary of the schemas matching the regex 'schema_filter'
+        void print_schemas(const char* schema_filter = ".") const
+        {
+            if (schema_filter == NULL) schema_filter = "";
+            regex schema_re(schema_filter, std::regex_constants::icase);
+            vector<const IDA_SIARDcatalog_schema*> schema_list; // List of schemas matching regex filter
+            for (auto &S: schemas) {
+                if (regex_search(S.name, schema_re)) schema_list.push_back(&S);
+            }
+
+            cout << "SIARD version " << version << endl;
+            if (*schema_filter)
+                cout << "Found " << schema_list.size() << " schemas (out of " << schemas.size() << ") matching regexp '" << schema_filter << "':" << endl;
+            else
+                cout << "Found " << schema_list.size() << " schemas:" << endl;
+            for (auto S: schema_list){
+                long ntables=0, nrows=0, ncells=0;
+                get_schema_stats(*S, ntables, nrows, ncells);
+                cout << "  " << S->name << ": " << ntables << " tables, " << nrows << " rows, " << ncells << " cells" << endl;
+            }
+        }
 
-                // If we assume that the lob_file is not a ".zip"-addressed URI, we can optimize this reading
-                // the file directly, without calling unzipURI(); nevertheless whe are going to be conservative
-                // and not to assume that
-                static bool optimize_lob_reading = false;
-                if (optimize_lob_reading && SIARD_FULL_UNZIP == unzipmode) {
-                    // The SIARD file has been already unzipped
-                    //lob_literal = IDA_siard_utils::file_to_blob_literal_append(lob_file);
-                    IDA_siard_utils::file_to_blob_literal_append(lob_file, s);
-                #ifndef IDA_FULL_UNZIP
-                    IDA_file_utils::delete_temp_file(tmpdir, lob_file);
-                #endif
-                } else {
-                    string tmp_lob_file = IDA_file_utils::unzipURI(lob_file, tmpdir);
-                    //lob_literal = IDA_siard_utils::file_to_blob_literal_append(tmp_lob_file);
-                    IDA_siard_utils::file_to_blob_literal_append(tmp_lob_file, s);
-                #ifndef IDA_FULL_UNZIP
-                    IDA_file_utils::delete_temp_file(tmpdir, tmp_lob_file);
-                #endif
+    private:
+        static void build_table(XMLElement *tab, IDA_SIARDcatalog_table &T)
+        {
+            T.name = IDA_xml_utils::find_first_child_elementText_by_tag(tab, "name");
+            T.folder = IDA_xml_utils::find_first_child_elementText_by_tag(tab, "folder");
+            T.rows = strtol(IDA_xml_utils::find_elementText_by_tag(tab, "rows").c_str(), NULL, 10);
+
+            vector<XMLElement*> columns;  // <columns> <column>...</column> ... </columns>
+            XMLElement *table_columns = IDA_xml_utils::find_element_by_tag(tab, "columns");
+            IDA_xml_utils::find_elements_by_tag(table_columns, "column", columns, 1);
+            T.columns.resize(columns.size());
+            for (unsigned long ic = 0; ic < columns.size(); ic++) {
+                XMLElement *col = columns[ic];
+                IDA_SIARDcatalog_column &C = T.columns[ic];
+                C.name = IDA_xml_utils::find_first_child_elementText_by_tag(col, "name");
+                C.type = IDA_xml_utils::find_first_child_elementText_by_tag(col, "type");
+                if (C.type.empty()) {
+                    // Complex type: <typeSchema> and <typeName>
+                    string type_name = IDA_xml_utils::find_first_child_elementText_by_tag(col, "typeName");
+                    if (!type_name.empty())
+                        C.type = IDA_xml_utils::find_first_child_elementText_by_tag(col, "typeSchema") + "." + type_name;
                 }
+                C.type_original = IDA_xml_utils::find_first_child_elementText_by_tag(col, "typeOriginal");
+                C.lob_folder = IDA_xml_utils::find_first_child_elementText_by_tag(col, "lobFolder");
+                C.nullable = IDA_xml_utils::find_first_child_elementText_by_tag(col, "nullable") != "false";
+            }
 
-
-                if (simpletype == IDA_siard_utils::COLTYPE_TEXT || textifyblob) {
-                    // If the affinity of this column is TEXT, cast the hex blob
-                    // form to text type
-                    //-- content.append(" AS TEXT)");
-                    s.append(" AS TEXT)");
+            XMLElement *pk = IDA_xml_utils::find_first_child_element_by_tag(tab, "primaryKey");
+            if (pk) {
+                for (XMLElement *e = pk->FirstChildElement("column"); e; e = e->NextSiblingElement("column")) {
+                    T.primary_key.push_back(e->GetText() ? e->GetText() : "");
                 }
-            } else {
-                const char *t = el?el->GetText():NULL;
-                string col_text = t?t:"";
-                if (el && el->GetText()) col_text = (string)(el->GetText());
-                if (simpletype == IDA_siard_utils::COLTYPE_INTEGER
-                    || simpletype == IDA_siard_utils::COLTYPE_REAL
-                    || simpletype == IDA_siard_utils::COLTYPE_NUMERIC) {
-                    // Integer, float
-                    //-- content = col_text;
-                    s.append(col_text);
-                } else {
-                    // Text -> if the text has no special siard chars (\u00...) simply quote it;
-                    // otherwise, decode the siard-encoding string and express down as hex
-                    if (!IDA_siard_utils::has_siard_special_chars(col_text)){
-                        //content = IDA_siard_utils::enclose_sqlite_single_quote(col_text);
-                        s.append(IDA_siard_utils::enclose_sqlite_single_quote(col_text));
-                    } else {
-                        uint8_t *col_text_decoded = NULL;
-                        long size = 0;
-                        bool has_specials = false;
-                        col_text_decoded = IDA_siard_utils::siard_decode(col_text, size, has_specials);
-                        assert(has_specials); // Here has_specials needs to be true
-                        if (col_text_decoded) {
-                            // Write as a blob cast to text, as there can be char(0) once decoded
-                            //-- string lob_literal = IDA_siard_utils::char_array_to_blob_literal(col_text_decoded, size);
-                            //-- //-- content = "CAST(" + lob_literal + " AS TEXT)";
-                            //-- s.append("CAST(" + lob_literal + " AS TEXT)");
-                            s.append("CAST(");
-                            IDA_siard_utils::char_array_to_blob_literal_append(col_text_decoded, size, s);
-                            s.append(" AS TEXT)");
-                            free(col_text_decoded);
-                        }
-                        else {
-                            cerr << "Error: malloc failed\n";
-                            throw bad_alloc();
-                        }
+            }
+
+            XMLElement *fks = IDA_xml_utils::find_first_child_element_by_tag(tab, "foreignKeys");
+            if (fks) {
+                for (XMLElement *fk = fks->FirstChildElement("foreignKey"); fk; fk = fk->NextSiblingElement("foreignKey")) {
+                    IDA_SIARDcatalog_foreign_key F;
+                    F.name = IDA_xml_utils::find_first_child_elementText_by_tag(fk, "name");
+                    F.referenced_schema = IDA_xml_utils::find_first_child_elementText_by_tag(fk, "referencedSchema");
+                    F.referenced_table = IDA_xml_utils::find_first_child_elementText_by_tag(fk, "referencedTable");
+                    for (XMLElement *r = fk->FirstChildElement("reference"); r; r = r->NextSiblingElement("reference")) {
+                        F.columns.push_back(IDA_xml_utils::find_first_child_elementText_by_tag(r, "column"));
+                        F.referenced.push_back(IDA_xml_utils::find_first_child_elementText_by_tag(r, "referenced"));
                     }
+                    T.foreign_keys.push_back(F);
                 }
             }
-            //return content;
-            return;
         }
 
-        // Get the content of an element, typically a column, containing a complex data type
-        // and append it to string s
-        void append_complex_data_type_content(string &s, XMLElement *el,
-                                              const string &siard_typeSchema, const string &siard_typeName,
-                                              long depth= 0, const string &treepath = "")
+        template <typename N>
+        static void put(string &b, N n)
         {
-            //-- string content;
-            string indent = string(1+depth, ' ');
-            if (0 || el) {
-                // Found the complex data type in the Data Type Table
-                IDA_SIARDtypenode tnode = DataType_Table.get_typenode(siard_typeSchema, siard_typeName);
+            b.append((const char*) &n, sizeof(n));
+        }
 
-                // If the type is not found in the Data Type Table, it must be a simple type
-                if (tnode.empty()){
-                    // It SHOULD be a simple basic type
-                    // Get the content as it is a simple basic type
-                    // Force textify blobs to be json compliant
-                    //-- string cell_content = append_simple_data_type_content(el, siard_typeName, true, treepath);
-                    //-- //-- cell_content = cell_content.substr(0,63) + ((cell_content.size()>64)?"...":""); // debug get only the first part
-                    //-- content = cell_content;
-                    append_simple_data_type_content(s, el, siard_typeName, true, treepath);
-                }
-                if (!tnode.empty()) {
-                    if (tnode.getCategory() == "array"){
-                        // Arrays must have one unique attribute with is type (simple or complex) and the cardinality
-                        string arr_cat; // Extended category of the type of the array elements
-                        string arr_schema, arr_type; // Type of the element; for complex types arr_schema=typeSchmea, arr_type=typeName;
-                                                     // for simple types only 'arr_type=type' makes sense
-                        unsigned long arr_card;
-                        for (const auto& att: tnode.getAttributeList()) {
-                            arr_cat = att.get_extended_category();
-                            arr_card = att.getCardinality();
-                            arr_schema = att.getTypeSchema();
-                            arr_type= att.getType().empty()?att.getTypeName():att.getType();
-                            break;
-                        }
+        static void put(string &b, const string &s)
+        {
+            put(b, (uint32_t) s.size());
+            b.append(s);
+        }
 
-                        //-- string json_str="json_array(\n";
-                        s.append("json_array(\n");
-                        for (unsigned long i=1; i <= arr_card ; i++){ // Note index starts at 1: <a1></a1>, <a2></a2>...
-                            string atag = "a" + to_string(i);
-                            XMLElement *a = IDA_xml_utils::find_element_by_tag(el, atag, IDA_xml_utils::BF);
-                            if (0 || a) {
-                                //-- string cell_content = append_complex_data_type_content(a, arr_schema,
-                                //--                                                     arr_type, depth + 1,
-                                //--                                                     treepath + "/" + atag);
-                                //-- json_str.append(indent + cell_content);
-                                //-- if (i < arr_card) json_str.append(",\n");
+        static void put(string &b, const vector<string> &v)
+        {
+            put(b, (uint32_t) v.size());
+            for (auto &s: v) put(b, s);
+        }
 
-                                s.append(indent);
-                                append_complex_data_type_content(s, a, arr_schema, arr_type, depth + 1,
-                                                                 treepath + "/" + atag);
-                                if (i < arr_card) s.append(",\n");
-                            } else {
-                                // <aN> tag not found for N: use empty content for this element
-                                s.append(indent + "''");
-                                if (i < arr_card) s.append(",\n");
-                            }
-                        }
-                        s.append(")");
-                        if (depth>0) s.append("\n");
-                        //-- content = json_str;
-                    }
-                    else if (tnode.getCategory() == "distinct"){
-                        // 'Distinct' types must have one unique attribute with is base type
-                        string dis_base;
-                        for (const auto& att: tnode.getAttributeList()) {
-                            dis_base = att.getBase();
-                            break;
-                        }
-                        // We assume that the base of a 'distinct' data type is always a simple type
-                        string dis_schema = "";
-                        //-- content = append_complex_data_type_content(el, dis_schema, dis_base, depth + 1, treepath);
-                        append_complex_data_type_content(s, el, dis_schema, dis_base, depth + 1, treepath);
+        // Bounds-checked reader of the payload; 'ok' is cleared when going past the end
+        struct reader {
+            const char *p, *end;
+            bool ok = true;
+
+            template <typename N>
+            N get()
+            {
+                N n = 0;
+                if ((unsigned long)(end - p) < sizeof(n)) { ok = false; p = end; return n; }
+                memcpy(&n, p, sizeof(n));
+                p += sizeof(n);
+                return n;
+            }
+
+            // A count of items, each one taking at least 'minsize' bytes
+            uint32_t count(unsigned long minsize)
+            {
+                uint32_t n = get<uint32_t>();
+                if ((unsigned long)(end - p) / minsize < n) { ok = false; p = end; return 0; }
+                return n;
+            }
+
+            string str()
+            {
+                uint32_t n = count(1);
+                string s(p, n);
+                p += n;
+                return s;
+            }
+
+            void strs(vector<string> &v)
+            {
+                v.resize(count(sizeof(uint32_t)));
+                for (auto &s: v) s = str();
+            }
+        };
+
+        int parse(const char *m, unsigned long size)
+        {
+            IDA_SIARDcatalog_header h;
+            memcpy(&h, m, sizeof(h));
+            if (memcmp(h.magic, magic, sizeof(h.magic)) || h.format != format
+                || h.metadata_crc != key.metadata_crc || h.metadata_size != key.metadata_size
+                || h.archive_size != key.archive_size
+                || h.archive_mtime != key.archive_mtime || h.archive_mtime_ns != key.archive_mtime_ns
+                || h.payload_size != size - sizeof(h)) {
+                return -1;
+            }
+
+            reader r = {m + sizeof(h), m + size};
+            version = r.str();
+            schemas.resize(r.count(3*sizeof(uint32_t)));
+            for (auto &S: schemas) {
+                S.name = r.str();
+                S.folder = r.str();
+                S.tables.resize(r.count(3*sizeof(uint32_t)));
+                for (auto &T: S.tables) {
+                    T.name = r.str();
+                    T.folder = r.str();
+                    T.rows = r.get<int64_t>();
+                    T.columns.resize(r.count(4*sizeof(uint32_t)));
+                    for (auto &C: T.columns) {
+                        C.name = r.str();
+                        C.type = r.str();
+                        C.type_original = r.str();
+                        C.lob_folder = r.str();
+                        C.nullable = r.get<uint8_t>();
                     }
-                    else if (tnode.getCategory() == "udt"){
-                        //-- string json_str="json_object(\n";
-                        s.append("json_object(\n");
-                        // Get recursively the content of each UDT attribute
-                        unsigned long att_no = 1;
-                        for (const auto& att: tnode.getAttributeList()) {
-                            string utag = "u" + to_string(att_no++);
-                            XMLElement *u = IDA_xml_utils::find_element_by_tag(el, utag, IDA_xml_utils::BF);
-                            const string& att_name = att.getName();
-                            s.append(indent + "'" + att_name + "', ");
-                            if (0 || u) {
-                                string u_schema, u_type; // Type of the element; for complex types arr_schema=typeSchmea, arr_type=typeName;
-                                                         // for simple types only 'arr_type=type' makes sense
-                                u_schema = att.getTypeSchema();
-                                u_type= att.getType().empty()?att.getTypeName():att.getType();
-                                //-- string att_content = append_complex_data_type_content(u, u_schema,
-                                //--                                                    u_type, depth + 1,
-                                //--                                                    treepath + "/" + att_name);
-                                //-- json_str.append(att_content);
-                                append_complex_data_type_content(s, u, u_schema, u_type, depth + 1,
-                                                                 treepath + "/" + att_name);
-                            } else {
-                                // <uN> tag not found for N: use empty content for this element
-                                //json_str.append(indent + "'" + att_name + "', ");
-                                s.append("''");
-                            }
-                            if (att_no <= tnode.getAttributeList().size()) s.append(",\n"); // Not add separator at the end
-                        }
-                        s.append(")");
-                        if (depth>0) s.append("\n");
-                        //-- content = json_str;
+                    r.strs(T.primary_key);
+                    T.foreign_keys.resize(r.count(5*sizeof(uint32_t)));
+                    for (auto &F: T.foreign_keys) {
+                        F.name = r.str();
+                        F.referenced_schema = r.str();
+                        F.referenced_table = r.str();
+                        r.strs(F.columns);
+                        r.strs(F.referenced);
                     }
                 }
             }
-            else {
-                // Elements missing in table.xml represented as empty
-                //-- content = "''";
-                s.append("''");
+            if (!r.ok || r.p != r.end) {
+                schemas.clear();
+                version.clear();
+                return -1;
             }
-            //-- return content;
-            return;
+            return 0;
         }
 
-    public:
+        static bool write_all(int fd, const char *p, unsigned long n)
+        {
+            while (n > 0) {
+                long w = write(fd, p, n);
+                if (w <= 0) return false;
+                p += w; n -= w;
+            }
+            return true;
+        }
+    }; /* class IDA_SIARDcatalog */
 
-        // Out a string with the SQL statements to insert all data in columns
-        // Extra info can be inserted as sql comments controled by verbose:
-        //   verbose=0 (no info), 1 (table info), 2 (extra table info), 3 (per column info)
-        void tree_to_sql(int verbose = 0)
+    // Projection of a conversion (see IDA_SIARDmetadata::set_projection()): the tables and
+    // columns to convert. Columns not in it are skipped before their content is decoded, so
+    // that large lobs that are never queried are not even extracted from the archive.
+    //
+    // It is set either from a list "table.column, table.*, table2, ..." (a table with '*',
+    // or alone, has all its columns), or from SQL queries (e.g., the bodies of a ROAE file):
+    // then a table is converted if its name appears in a statement, with all its columns
+    // if that statement selects '*' (or 't.*'), or else with the columns whose names appear
+    // in any statement. Names are case insensitive, like SQL identifiers
+    class IDA_SIARDprojection {
+        map<string, set<string>> tables;   // Table -> columns ("*": all), if set from a list
+        bool from_sql = false;
+        vector<set<string>> statements;    // Identifiers of each statement ("*": selects all)
+        set<string> identifiers;           // Identifiers of all the statements
+        string key;                        // Identifies the projection (empty: none)
+
+        static string hash(const string &s)
         {
-            if (pRootElem) {
-                XMLElement *table = pRootElem;
-                // TODO: check the tag of table is <table>
+            uint64_t h = 14695981039346656037ULL;
+            for (unsigned char c: s) {
+                h = (h ^ c) * 1099511628211ULL;
+            }
+            char hex[17];
+            snprintf(hex, sizeof(hex), "%016llx", (unsigned long long) h);
+            return hex;
+        }
 
-                string version;
-                version = IDA_xml_utils::get_attribute_value(table, "version", "unknown");
-                (verbose > 0) && sqlout << "-- table name=" << tablename << " version=" << version << endl;
+    public:
+        void clear()
+        {
+            tables.clear();
+            from_sql = false;
+            statements.clear();
+            identifiers.clear();
+            key.clear();
+        }
 
-                vector<XMLElement*> rows;
-                IDA_xml_utils::find_elements_by_tag(pRootElem, "row", rows, 1);
+        bool empty() const { return key.empty(); }
 
-                (verbose > 1)  && sqlout << "-- no. of rows=" << rows.size() << endl;
+        // A short text identifying the projection (e.g., for the key of a checkpoint)
+        const string &get_key() const { return key; }
 
-                // Expression for column tags: <c1>...</c1> <c2>...</c2>
-                // const regex col_tag_re("c[0-9].*");
+        // Set from a list "table.column, table.*, table2, ..."
+        // Return 0 if ok, -1 if the list is wrong (then the projection is empty)
+        int set_list(const string &spec)
+        {
+            clear();
+            istringstream in(spec);
+            string item;
+            while (getline(in, item, ',')) {
+                item = IDA_parsing_utils::trim(item);
+                if (item.empty()) continue;
+                size_t dot = item.rfind('.');
+                string table = IDA_parsing_utils::trim(item.substr(0, dot));
+                string column = (dot == string::npos) ? "*" : IDA_parsing_utils::trim(item.substr(dot + 1));
+                if (table.empty() || column.empty()) {
+                    clear();
+                    return -1;
+                }
+                tables[IDA_parsing_utils::to_lower(table)].insert(IDA_parsing_utils::to_lower(column));
+            }
+            if (!tables.empty()) key = "list#" + hash(spec);
+            return 0;
+        }
 
-                // Precompute column invariants
-                vector<string> col_cplx_typeSchema(ncols), col_cplx_type(ncols);
-                vector<enum IDA_siard_utils::SQLITE_COLTYPES> col_simple_type(ncols);
-                for (unsigned long colid = 0; colid < ncols; colid++){
-                    col_cplx_typeSchema[colid] = siard_coltype_v[colid].getTypeSchema();
-                    col_cplx_type[colid] = siard_coltype_v[colid].getTypeOrTypeName();
-                    col_simple_type[colid] = IDA_siard_utils::siard_type_to_sqlite3(col_cplx_type[colid]);
+        // Set from the identifiers of SQL statements (separated by ';')
+        void set_sql(const string &sql)
+        {
+            clear();
+            from_sql = true;
+            statements.emplace_back();
+            string prev; // Previous token
+            for (size_t k = 0; k < sql.size(); ) {
+                char c = sql[k];
+                string token;
+                if (isspace((unsigned char) c)) {
+                    k++;
+                    continue;
+                } else if (sql.compare(k, 2, "--") == 0) {
+                    k = sql.find('\n', k);
+                    continue;
+                } else if (sql.compare(k, 2, "/*") == 0) {
+                    k = sql.find("*/", k + 2);
+                    if (k != string::npos) k += 2;
+                    continue;
+                } else if (c == '\'' || c == '"' || c == '`' || c == '[') {
+                    // Literal, or quoted identifier: "name", `name` or [name]
+                    char close = (c == '[') ? ']' : c;
+                    for (k++; k < sql.size(); k++) {
+                        if (sql[k] == close) {
+                            if (k + 1 < sql.size() && sql[k+1] == close && close != ']') k++;
+                            else break;
+                        }
+                        token += sql[k];
+                    }
+                    k++;
+                    if (c == '\'') {
+                        prev = "'";
+                        continue;
+                    }
+                } else if (isalnum((unsigned char) c) || c == '_' || (unsigned char) c >= 0x80) {
+                    for (; k < sql.size() && (isalnum((unsigned char) sql[k]) || sql[k] == '_' || sql[k] == '$'
+                                              || (unsigned char) sql[k] >= 0x80); k++) {
+                        token += sql[k];
+                    }
+                } else {
+                    k++;
+                    if (c == ';') {
+                        if (!statements.back().empty()) statements.emplace_back();
+                    } else if (c == '*' && (prev == "select" || prev == "," || prev == "." || prev == "distinct" || prev == "all")) {
+                        statements.back().insert("*");
+                    }
+                    prev = string(1, c);
+                    continue;
                 }
+                token = IDA_parsing_utils::to_lower(token);
+                statements.back().insert(token);
+                identifiers.insert(token);
+                prev = token;
+            }
+            if (!identifiers.empty()) key = "sql#" + hash(sql);
+        }
 
-                //-- string colcontent;
-                string SQL_insert_into_start = "INSERT INTO '" + tablename + "' VALUES (";
+        // Whether the table is converted
+        bool has_table(const string &table) const
+        {
+            if (empty()) return true;
+            string t = IDA_parsing_utils::to_lower(table);
+            return from_sql ? identifiers.count(t) > 0 : tables.count(t) > 0;
+        }
 
-                for (unsigned long ir = 0; ir < rows.size(); ir++) {
-                    XMLElement *row = rows[ir];
-                    if (verbose > 1) {
-                        string row_name = "r" + to_string(ir);
-                        sqlout << "--  bogus rowname='" << row_name << "'" << endl;
-                        sqlout << "--  no. of columns in table='" << ncols << "'" << endl;
-                    }
+        // Whether the column of the table is converted
+        bool has_column(const string &table, const string &column) const
+        {
+            if (empty()) return true;
+            string t = IDA_parsing_utils::to_lower(table), c = IDA_parsing_utils::to_lower(column);
+            if (from_sql) {
+                if (identifiers.count(c)) return true;
+                for (auto &S: statements) {
+                    if (S.count("*") && S.count(t)) return true;
+                }
+                return false;
+            }
+            auto it = tables.find(t);
+            return it != tables.end() && (it->second.count("*") || it->second.count(c));
+        }
+    }; /* class IDA_SIARDprojection */
 
-                    // Traverse columns of the row and write its corresponding INSERT statement
-                    string SQL_insert_into = SQL_insert_into_start;
+    // Checkpoint journal of a conversion (IDA_SIARDmetadata::tree_to_sql()), recording the
+    // tables fully converted, so that an interrupted conversion can be resumed later
+    // skipping them (see IDA_siard2sql_set_resume())
+    //
+    // When writing SQL to a file, the journal is a text file (usually '<sql file>.ckpt'):
+    //   IDA_CHECKPOINT_MAGIC <tab> key
+    //   schema <tab> table <tab> rows <tab> offset     (one line per converted table)
+    // where offset is the size of the SQL file once the table (and its indexes) was written;
+    // when resuming, the SQL file is truncated to the offset of the last table.
+    // When loading into a sqlite3 database, the journal is the table IDA_CHECKPOINT_TABLE
+    // of the same database, and a table not completed is dropped before converting it again.
+    // The key identifies the conversion (siard file, size, modification time, filter, ...):
+    // a journal with another key is discarded. The journal is deleted when the conversion ends
+    #define IDA_CHECKPOINT_MAGIC "siard2sql-checkpoint-1"
+    #define IDA_CHECKPOINT_TABLE "_ida_siard2sql_checkpoint"
+    class IDA_SIARDcheckpoint {
+        string key;
+        string file;              // Journal file, if writing SQL to a file
+        FILE *f = NULL;
+        sqlite3 *db = NULL;       // Database with the journal table, if loading into sqlite3
+        set<pair<string, string>> done;   // (schema, table) already converted
+        unsigned long long offset = 0;     // SQL file offset after the last converted table
+        bool resumed = false;
 
-                    // Iterate over the columns of this row
-                    for (unsigned long colid = 0; colid < ncols; colid++){
-                        XMLElement *col;
+    public:
+        IDA_SIARDcheckpoint() {}
+        IDA_SIARDcheckpoint(const IDA_SIARDcheckpoint&) = delete;
+        IDA_SIARDcheckpoint &operator=(const IDA_SIARDcheckpoint&) = delete;
 
-                        // Tags of the columns are <c1></c1> <c2></c2>...
-                        // Column number is the integer after the 'c': c1, c2, ...
-                        // Notice the first column is numbered with 1: c1 !!
-                        string colname = "c" + to_string(colid + 1);
-                        col = IDA_xml_utils::find_element_by_tag(row, colname);
+        ~IDA_SIARDcheckpoint()
+        {
+            if (f) fclose(f);
+        }
 
-                        // This is a little dirty trick, using a member for the col id as global
-                        current_col_id = colid;
+        // Use the journal file 'file'. If 'resume' is true and it has the same key,
+        // keep its converted tables; otherwise start a new journal
+        // Return 0 if OK, -1 if the journal cannot be written
+        int open(const string &file, const string &key, bool resume)
+        {
+            this->file = file;
+            this->key = key;
+            if (resume) load_file();
+            if (!resumed) return reset();
+            f = fopen(file.c_str(), "a");
+            return f ? 0 : -1;
+        }
 
-                        (verbose > 2) && sqlout << "--  bogus columnname='" << colname << "'" << endl;
+        // Use the journal table of the sqlite3 database 'db', like open(file, ...)
+        int open(sqlite3 *db, const string &key, bool resume)
+        {
+            this->db = db;
+            this->key = key;
+            if (sqlite3_exec(db, "CREATE TABLE IF NOT EXISTS " IDA_CHECKPOINT_TABLE
+                                 " (key TEXT, schema_name TEXT, table_name TEXT, nrows INTEGER);",
+                             NULL, NULL, NULL) != SQLITE_OK) {
+                this->db = NULL;
+                return -1;
+            }
+            if (resume) load_db();
+            return resumed ? 0 : reset();
+        }
 
-                        // Let's generate the column content depending on it is simple or complex data type
-                        string &col_siard_typeSchema = col_cplx_typeSchema[colid];
-                        // The initial treepath is something like "/columnname"
-                        string treepath0 = "/" + siard_colname_v[colid];
-                        // Simple types has no typeSchema, so generate complex content (json) only for complex data types
-                        if (col_siard_typeSchema.empty()) {
-                            // Simple: INTEGER, REAL, NUMERIC, BLOB, TEXT
-                            //-- colcontent = append_simple_data_type_content(col, col_simple_type[colid], false, treepath0); // It's fast using sqlite types
-                            append_simple_data_type_content(SQL_insert_into, col, col_simple_type[colid], false,
-                                                            treepath0); // It's fast using sqlite types
-                        } else {
-                            // Complex: distinct, udt, array
-                            string &col_siard_type = col_cplx_type[colid];
-                            //-- colcontent = append_complex_data_type_content(col, col_siard_typeSchema, col_siard_type, 0, treepath0);
-                            append_complex_data_type_content(SQL_insert_into, col, col_siard_typeSchema, col_siard_type,
-                                                             0, treepath0);
-                        }
+        // Forget the converted tables and start a new journal
+        int reset()
+        {
+            done.clear();
+            offset = 0;
+            resumed = false;
+            if (db) {
+                sqlite3_exec(db, "DELETE FROM " IDA_CHECKPOINT_TABLE ";", NULL, NULL, NULL);
+                return exec_insert(key.c_str(), NULL, NULL, 0);
+            }
+            if (f) fclose(f);
+            f = fopen(file.c_str(), "w");
+            if (!f) return -1;
+            fprintf(f, "%s\t%s\n", IDA_CHECKPOINT_MAGIC, key.c_str());
+            fflush(f);
+            return 0;
+        }
 
+        // Whether a previous journal of the same conversion was found
+        bool is_resumed() const { return resumed; }
 
-                        //-- SQL_insert_into += colcontent;
-                        if (colid < ncols - 1) SQL_insert_into += ",\n";
+        // Number of tables already converted
+        unsigned long get_ndone() const { return done.size(); }
+
+        bool is_done(const string &schema, const string &table) const
+        {
+            return done.count(make_pair(schema, table)) > 0;
+        }
+
+        // Offset of the SQL file after the last converted table (0 if none)
+        unsigned long long get_offset() const { return offset; }
+
+        // Record that a table has been fully converted (and its SQL file offset)
+        void record(const string &schema, const string &table, unsigned long rows, unsigned long long offset)
+        {
+            done.insert(make_pair(schema, table));
+            this->offset = offset;
+            if (db) {
+                if (exec_insert(NULL, schema.c_str(), table.c_str(), rows)) {
+                    cerr << "Error writing checkpoint of table '" << table << "': " << sqlite3_errmsg(db) << endl;
+                }
+            } else if (f) {
+                fprintf(f, "%s\t%s\t%lu\t%llu\n", schema.c_str(), table.c_str(), rows, offset);
+                fflush(f);
+            }
+        }
 
-                        #if 0
-                        {
-                            // Debug complex types
-                            string col_siard_typeSchema = siard_coltype_v[colid].getTypeSchema();
-                            string col_siard_type = siard_coltype_v[colid].getTypeOrTypeName();
-                            string col_cplx_content = append_complex_data_type_content(siard_dir, col,
-                                                                                    col_siard_typeSchema,
-                                                                                    col_siard_type);
-                            // For debugging purpose remove large hex sequences
-                            static regex re_largehex("(X'[0-9a-fA-F]{1,31})", std::regex::optimize);
-                            col_cplx_content = regex_replace(col_cplx_content, re_largehex, "$1...");
-                            static regex re_largehex2("[0-9a-fA-F]{32,1000}", std::regex::optimize);
-                            col_cplx_content = regex_replace(col_cplx_content, re_largehex2, "");
+        // The conversion is over: delete the journal
+        void finish()
+        {
+            if (db) {
+                sqlite3_exec(db, "DROP TABLE IF EXISTS " IDA_CHECKPOINT_TABLE ";", NULL, NULL, NULL);
+                db = NULL;
+            }
+            if (f) {
+                fclose(f);
+                f = NULL;
+                unlink(file.c_str());
+            }
+        }
 
-                            cerr << "\033[1;33m---complex data start column=" << tablename << ":" << siard_colname_v
-                                 << " (" << col_siard_typeSchema << "," << col_siard_type << ")" << endl
-                                 << "\033[1;31m"
-                                 << col_cplx_content
-                                 << endl << "\033[1;32m---complex data end\033[m" << endl;
-                        }
-                        #endif
-                    }
+    private:
+        void load_file()
+        {
+            ifstream in(file);
+            string line;
+            if (!getline(in, line) || line != string(IDA_CHECKPOINT_MAGIC) + "\t" + key) return;
+            resumed = true;
+            // A line without '\n' at the end was not completely written
+            while (getline(in, line) && !in.eof()) {
+                vector<string> v;
+                size_t p = 0, q;
+                while ((q = line.find('\t', p)) != string::npos) {
+                    v.push_back(line.substr(p, q - p));
+                    p = q + 1;
+                }
+                v.push_back(line.substr(p));
+                if (v.size() != 4) break;
+                done.insert(make_pair(v[0], v[1]));
+                offset = strtoull(v[3].c_str(), NULL, 10);
+            }
+        }
 
-                    SQL_insert_into += ");\n";
-                    sqlout << SQL_insert_into;
+        void load_db()
+        {
+            sqlite3_stmt *stmt = NULL;
+            if (sqlite3_prepare_v2(db, "SELECT key, schema_name, table_name FROM " IDA_CHECKPOINT_TABLE
+                                       " ORDER BY rowid;", -1, &stmt, NULL) != SQLITE_OK) {
+                sqlite3_finalize(stmt);
+                return;
+            }
+            while (sqlite3_step(stmt) == SQLITE_ROW) {
+                const char *k = (const char*) sqlite3_column_text(stmt, 0);
+                const char *schema = (const char*) sqlite3_column_text(stmt, 1);
+                const char *table = (const char*) sqlite3_column_text(stmt, 2);
+                if (k) {
+                    resumed = (key == k);
+                    if (!resumed) break;
+                } else if (resumed && schema && table) {
+                    done.insert(make_pair(string(schema), string(table)));
                 }
-            } /* if (pRootElem) */
+            }
+            sqlite3_finalize(stmt);
+            if (!resumed) done.clear();
         }
 
-    }; /* class IDA_SIARDcontent */
+        int exec_insert(const char *k, const char *schema, const char *table, unsigned long rows)
+        {
+            sqlite3_stmt *stmt = NULL;
+            int rc = sqlite3_prepare_v2(db, "INSERT INTO " IDA_CHECKPOINT_TABLE " VALUES (?1, ?2, ?3, ?4);",
+                                        -1, &stmt, NULL);
+            if (rc == SQLITE_OK) {
+                sqlite3_bind_text(stmt, 1, k, -1, SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 2, schema, -1, SQLITE_STATIC);
+                sqlite3_bind_text(stmt, 3, table, -1, SQLITE_STATIC);
+                sqlite3_bind_int64(stmt, 4, rows);
+                rc = sqlite3_step(stmt);
+            }
+            sqlite3_finalize(stmt);
+            return (rc == SQLITE_DONE) ? 0 : -1;
+        }
+    }; /* class IDA_SIARDcheckpoint */
 
     // Main class to process the "header/metadata.xml" archive
     class IDA_SIARDmetadata {
 
         XMLDocument doc;
         XMLElement *pRootElem = NULL;
+        // Summary of the schemas in doc (see IDA_SIARDcatalog)
+        IDA_SIARDcatalog catalog;
         //string siard_dir = ""; // Directory where "header/metadata.xml" is placed (after unzipping .siard)
         //string siard_file = ""; // Directory where .siard (zip) file is (must be set explicitly)
 
@@ -2190,6 +5114,46 @@ namespace IDA {
 
         enum unzipmode_e unzipmode = SIARD_FULL_UNZIP;
 
+        // Target database when converting directly into sqlite3 (see tree_to_sqlite());
+        // SQL statements other than row insertions are written to sqlbuf and
+        // executed in db by exec_pending_sql()
+        sqlite3 *db = NULL;
+        ostringstream *sqlbuf = NULL;
+
+        // Number of tables converted in parallel (see set_jobs())
+        unsigned long njobs = 1;
+        // Read the rows of each table with a pipeline of threads (see set_pipelined())
+        bool pipelined = false;
+        // Bulk-load mode (see set_bulk())
+        bool bulk = false;
+        unsigned long batch_rows = 1;
+        unsigned long commit_rows = 0;
+    #ifdef IDA_THREADS
+        IDA_SIARDtable_pool *pool = NULL;
+    #endif
+        // Errors converting the tables that may have lost data (see get_failures())
+        unsigned long failures = 0;
+        // Journal of the converted tables, to resume an interrupted conversion (see set_checkpoint())
+        IDA_SIARDcheckpoint *checkpoint = NULL;
+        ostream *checkpoint_out = NULL;  // SQL file whose offsets are recorded
+
+        // Only this table is converted, if set (see set_table())
+        string only_schema, only_table;
+
+        // Tables and columns converted, if not NULL (see set_projection())
+        const IDA_SIARDprojection *projection = NULL;
+
+        // Regex of the names of the tables converted, if not empty (see set_table_filter())
+        string table_filter;
+
+        // Rows converted of each table (see set_sampling())
+        unsigned long row_limit = 0;
+        unsigned long row_every = 1;
+
+        // If not NULL, the counters and times of each table converted are added (see set_stats())
+        std::deque<IDA_SIARDtable_stats> *table_stats = NULL;
+        double stats_time = 0; // Seconds of the whole conversion
+
         const string tmpdir_template = "_s2s_tmp";
         const string tmpdir_templateX = tmpdir_template + "XXXXXX";
 
@@ -2234,6 +5198,7 @@ namespace IDA {
         {
             doc.Clear();
             pRootElem = NULL;
+            catalog.clear();
             siardURI.clear();
             tmpdir.clear();
         }
@@ -2242,6 +5207,7 @@ namespace IDA {
         int load()
         {
             pRootElem = NULL; // If load fails, pRootElem is NULL
+            catalog.clear();
 
             // The metadata.xml file
             string metadatafile = siardURI + "/header/metadata.xml";
@@ -2255,6 +5221,7 @@ namespace IDA {
             if (result == XML_SUCCESS){
                 cerr << "OK loading metadata xml file '" << metadatafile << "'" << endl; // Debug
                 pRootElem = doc.RootElement();
+                catalog.build(pRootElem);
                 return 0;
             }
             cerr << "ERROR loading metadata xml file '" << metadatafile << "': " << result << endl; // Debug
@@ -2282,7 +5249,7 @@ namespace IDA {
             if (onlyheader) {
                 ziperr = IDA_unzip_siard_metadata(siardURI.c_str()); // Remember we are using its realpath
             } else {
-                ziperr = IDA_unzip_siard_full(siardURI.c_str()); // Remember we are using its realpath
+                ziperr = IDA_unzip_parallel(siardURI.c_str(), njobs); // Remember we are using its realpath
             }
 
             if (ziperr) {
@@ -2421,100 +5388,52 @@ namespace IDA {
             }
         }
 
-        // Build a list of strings with the name of those schemas in the siard file
-        // matching the regex 'schema_filter'.
-        // Set 'nschemas' the total number of schemas in the file.
-        vector<string> get_schemas(const char* schema_filter, unsigned long &nschemas)
+        // Summary of the schemas in the siard file, built by load()
+        const IDA_SIARDcatalog &get_catalog() const
         {
-            // This vector is a list with the name of schemas matching the regex filter
-            vector<string> schema_list;
-
-            nschemas = 0;
-            if (pRootElem) {
-                if (schema_filter == NULL) schema_filter = "";
-
-                vector<XMLElement*> schemas;
-                IDA_xml_utils::find_elements_by_tag(pRootElem, "schema", schemas, 2);
-
-                regex schema_re(schema_filter, std::regex_constants::icase);
-                nschemas = schemas.size();
-                for (unsigned long is = 0; is < schemas.size(); is++){
-                    XMLElement *sch = schemas[is];
-
-                    string schema_name = IDA_xml_utils::find_elementText_by_tag(sch, "name");
-                    if (!regex_search(schema_name, schema_re)) {
-                        // Skip this schema if not matching the filter
-                        continue;
-                    }
-                    schema_list.push_back(schema_name);
-                }
-            }
-
-            return schema_list;
+            return catalog;
         }
 
-        // Count the number of tables, rows and cells in a schema with name 'schema_name'
-        // Return the number total of schemas in the siard file
-        void get_schema_stats(const string &schema_name, long &ntables, long &nrows, long &ncells)
+        void print_schemas(const char* schema_filter = ".")
         {
-            ntables = 0;    // tables of this schema
-            nrows = 0;      // total rows of this schema
-            ncells = 0;     // total cells of this schema
-            if (pRootElem) {
-
-                vector<XMLElement*> schemas;
-                IDA_xml_utils::find_elements_by_tag(pRootElem, "schema", schemas, 2);
-
-                XMLElement *schema_found = NULL;
-                for (unsigned long is = 0; is < schemas.size(); is++) {
-                    XMLElement *sch = schemas[is];
-                    string this_schema_name = IDA_xml_utils::find_elementText_by_tag(sch, "name");
-                    if (!this_schema_name.compare(schema_name)) {
-                        // A schema with this name found
-                        schema_found = sch;
-                        break;
-                    }
-                }
-
-                if (!schema_found) return; // No schema with this name
-
-                XMLElement *schema_tables;
-                vector<XMLElement*> tables; // <tables> <table> ...</table> ... </tables>
-                schema_tables = IDA_xml_utils::find_element_by_tag(schema_found, "tables");
-                IDA_xml_utils::find_elements_by_tag(schema_tables, "table", tables, 1);
-
-                // Figures for this schema
-                ntables = tables.size(); // tables of this schema
-                long ntablerows = 0;     // rows of this table
-                for (unsigned long it = 0; it < tables.size(); it++){
-                    XMLElement *tab = tables[it];
-                    string table_rows = IDA_xml_utils::find_elementText_by_tag(tab, "rows");
-                    ntablerows =  stol(table_rows);
-                    nrows +=  ntablerows;
-
-                    XMLElement *table_columns;
-                    vector<XMLElement*> columns;  // <columns> <column>...</column> ... </columns>
-                    table_columns = IDA_xml_utils::find_element_by_tag(tab, "columns");
-                    IDA_xml_utils::find_elements_by_tag(table_columns, "column", columns, 1);
-                    ncells += ntablerows * columns.size();
-                }
-            }
+            catalog.print_schemas(schema_filter);
+            if (table_stats && !table_stats->empty()) print_stats();
         }
 
-        void print_schemas(const char* schema_filter = ".")
+        // Print a summary of the statistics of the last conversion (see set_stats()):
+        // totals, time of each phase (summed over the tables) and the slowest tables
+        void print_stats() const
         {
-            unsigned long nschemas;  // Total schemas in siard file
-            vector<string> schema_list = get_schemas(schema_filter, nschemas); // List of schemas matching regex filter
-            cout << "SIARD version " << get_version_from_metadata_xml() << endl;
-            if (schema_filter && *schema_filter)
-                cout << "Found " << schema_list.size() << " schemas (out of " << nschemas << ") matching regexp '" << schema_filter << "':" << endl;
-            else
-                cout << "Found " << schema_list.size() << " schemas:" << endl;
-            for (auto s: schema_list){
-                long ntables=0, nrows=0, ncells=0;
-                get_schema_stats(s, ntables, nrows, ncells);
-                cout << "  " << s << ": " << ntables << " tables, " << nrows << " rows, " << ncells << " cells" << endl;
+            IDA_SIARDtable_stats S;
+            vector<const IDA_SIARDtable_stats*> slowest;
+            for (auto &T: *table_stats) {
+                S.rows += T.rows;
+                S.cells += T.cells;
+                S.text_bytes += T.text_bytes;
+                S.lobs += T.lobs;
+                S.lob_bytes += T.lob_bytes;
+                S.out_bytes += T.out_bytes;
+                S.unzip_time += T.unzip_time;
+                S.parse_time += T.parse_time;
+                S.emit_time += T.emit_time;
+                slowest.push_back(&T);
+            }
+            auto total = [](const IDA_SIARDtable_stats *T) { return T->unzip_time + T->parse_time + T->emit_time; };
+            std::sort(slowest.begin(), slowest.end(), [&](const IDA_SIARDtable_stats *a, const IDA_SIARDtable_stats *b) {
+                return total(a) > total(b);
+            });
+            double in = S.text_bytes + S.lob_bytes;
+            cout << "Converted " << table_stats->size() << " tables in " << fixed << setprecision(2) << stats_time << " s: "
+                 << S.rows << " rows (" << setprecision(0) << (stats_time > 0 ? S.rows / stats_time : 0) << " rows/s), "
+                 << S.cells << " cells, " << setprecision(2) << HUMANSIZE(in) << HUMANPREFIX(in) << "B of data ("
+                 << S.lobs << " lobs, " << HUMANSIZE(S.lob_bytes) << HUMANPREFIX(S.lob_bytes) << "B), "
+                 << HUMANSIZE(S.out_bytes) << HUMANPREFIX(S.out_bytes) << "B written" << endl;
+            cout << "  unzip " << S.unzip_time << " s, parse " << S.parse_time << " s, emit " << S.emit_time << " s" << endl;
+            cout << "  slowest tables:";
+            for (unsigned long k = 0; k < slowest.size() && k < 5; k++) {
+                cout << (k ? ", " : " ") << slowest[k]->schema << "." << slowest[k]->table << " (" << total(slowest[k]) << " s)";
             }
+            cout << defaultfloat << setprecision(6) << endl;
         }
 
         string get_version_from_metadata_xml(){
@@ -2543,9 +5462,19 @@ namespace IDA {
         //      ofstream sqlout(file);
         //      if (sqlout.good()) parsed_tree_to_sqlite3(sqlout)
         //
-        void tree_to_sql(ostream &sqlout = cout, const char *schema_filter = "", int verbose= 2){
+        void tree_to_sql(ostream &out = cout, const char *schema_filter = "", int verbose= 2){
             // A header.xml needs to have been loaded
             if (pRootElem) {
+                // SQL is written to 'out' through 'sqlout', whose buffer is switched to 'discarded'
+                // for the tables already converted when resuming (see set_checkpoint()); when
+                // resuming SQL to a file, everything up to the last converted table is discarded,
+                // as the file already has it
+                ostream sqlout(out.rdbuf());
+                sqlout.exceptions(out.exceptions());
+                ostringstream discarded;
+                unsigned long nresumed = checkpoint ? checkpoint->get_ndone() : 0;
+                if (nresumed && !db) sqlout.rdbuf(discarded.rdbuf());
+
                 string SQL_create_table = "";
 
                 unsigned long iuk = 0; // candidate key (=unique index) global counter
@@ -2567,6 +5496,13 @@ namespace IDA {
                 IDA_xml_utils::find_elements_by_tag(pRootElem, "schema", schemas, 2);
                 sqlout << "-- no. of schemas=" << schemas.size() << endl;
 
+                if (bulk) {
+                    sqlout << "PRAGMA journal_mode=OFF;\n";
+                    sqlout << "PRAGMA synchronous=OFF;\n";
+                }
+
+                regex table_re(table_filter, std::regex_constants::icase);
+
                 set<string> seen_tables; // To skip replicated tables
                 set<pair<string, string>> rep_tables;
                 map<string,string> table_first_schema;
@@ -2608,6 +5544,11 @@ namespace IDA {
                         string table_rows = IDA_xml_utils::find_elementText_by_tag(tab, "rows");
                         string table_folder = IDA_xml_utils::find_elementText_by_tag(tab, "folder");
 
+                        // Converting a single table (see set_table())
+                        if (!only_table.empty() && (table_name != only_table || schema_name != only_schema)) {
+                            continue;
+                        }
+
                         // Skip replicated table names (tables with the same name appearing in different schemas)
                         // Only the first occurrence is left
                         if (seen_tables.count(table_name)){
@@ -2619,16 +5560,18 @@ namespace IDA {
                            table_first_schema[table_name] = schema_name;
                         }
 
-                        (verbose > 1) && sqlout << "--  table='" << table_name << "'"<< endl;
-                        (verbose > 1) && sqlout << "--  rows='"  << table_rows << "'"<< endl;
-
-                        SQL_create_table = "CREATE TABLE '" + table_name + "' (\n";
+                        // Skip the tables not in the projection, or not matching the table filter
+                        if (projection && !projection->has_table(table_name)) {
+                            continue;
+                        }
+                        if (!table_filter.empty() && !regex_search(table_name, table_re)) {
+                            continue;
+                        }
 
                         XMLElement *table_columns;
                         vector<XMLElement*> columns;  // <columns> <column>...</column> ... </columns>
                         table_columns = IDA_xml_utils::find_element_by_tag(tab, "columns");
                         IDA_xml_utils::find_elements_by_tag(table_columns, "column", columns, 1);
-                        (verbose > 1) && sqlout << "--  no. of columns=" << columns.size() << endl;
 
                         // This array has the name of columns
                         vector<string> siard_colname_v(columns.size());
@@ -2636,7 +5579,65 @@ namespace IDA {
                         vector<IDA_SIARD_type_attribute> siard_coltype_v(columns.size());
                         // This array has the lob folder information for each column
                         vector<IDA_SIARDlobfolder> siard_lobfolder_info_v(columns.size());
+                        // The sqlite3 type of each column by name
+                        map<string, string> sqlite3_coltype_by_name;
+
+                        XMLElement *table_primarykey;
+                        vector<XMLElement*> primarykey_columns;  // <table> <primaryKey> <name> <column> <column> ...
+                        table_primarykey = IDA_xml_utils::find_element_by_tag(tab, "primaryKey");
+                        IDA_xml_utils::find_elements_by_tag(table_primarykey, "column", primarykey_columns);
+
+                        // Columns skipped by the projection; the columns of the primary key are always converted
+                        vector<bool> siard_colskipped_v(columns.size(), false);
+                        set<string> skipped_columns;
+                        unsigned long nloaded = columns.size();
+                        if (projection) {
+                            set<string> pk;
+                            for (auto s: primarykey_columns) pk.insert(s->GetText() ? s->GetText() : "");
+                            for (unsigned long ic = 0; ic < columns.size(); ic++) {
+                                string column_name = IDA_xml_utils::find_elementText_by_tag(columns[ic], "name");
+                                if (!pk.count(column_name) && !projection->has_column(table_name, column_name)) {
+                                    siard_colskipped_v[ic] = true;
+                                    skipped_columns.insert(column_name);
+                                    nloaded--;
+                                }
+                            }
+                            if (!nloaded) {
+                                cerr << "Warning: no column of table '" << schema_name << ":" << table_name << "' in the projection; table skipped" << endl;
+                                continue;
+                            }
+                        }
+
+                        // Columns in the primary key or in a candidate key (i.e., in a unique index)
+                        set<string> indexed_columns;
+                        for (auto s: primarykey_columns) indexed_columns.insert(s->GetText() ? s->GetText() : "");
+                        vector<XMLElement*> candidatekey_all_columns;
+                        IDA_xml_utils::find_elements_by_tag(IDA_xml_utils::find_element_by_tag(tab, "candidateKeys"),
+                                                            "column", candidatekey_all_columns);
+                        for (auto s: candidatekey_all_columns) indexed_columns.insert(s->GetText() ? s->GetText() : "");
+                        vector<bool> siard_colindexed_v(columns.size(), false);
+                        for (unsigned long ic = 0; ic < columns.size(); ic++) {
+                            string column_name = IDA_xml_utils::find_elementText_by_tag(columns[ic], "name");
+                            siard_colindexed_v[ic] = indexed_columns.count(column_name) > 0;
+                        }
+
+                        // Tables already converted are processed as the others, so that names and
+                        // counters are the same, but their SQL is discarded and their rows are not
+                        // converted. A table not completed may be partially loaded in the database
+                        bool resumed = nresumed && checkpoint->is_done(schema_name, table_name);
+                        if (resumed) {
+                            sqlout.rdbuf(discarded.rdbuf());
+                        } else if (checkpoint && checkpoint->is_resumed() && db) {
+                            sqlout << "DROP TABLE IF EXISTS '" << table_name << "';\n";
+                        }
+
+                        (verbose > 1) && sqlout << "--  table='" << table_name << "'"<< endl;
+                        (verbose > 1) && sqlout << "--  rows='"  << table_rows << "'"<< endl;
 
+                        SQL_create_table = "CREATE TABLE '" + table_name + "' (\n";
+                        (verbose > 1) && sqlout << "--  no. of columns=" << columns.size() << endl;
+
+                        unsigned long ncreated = 0; // Columns in the CREATE TABLE statement
                         for (unsigned long ic = 0; ic < columns.size(); ic++) {
                             XMLElement *col = columns[ic];
 
@@ -2685,11 +5686,15 @@ namespace IDA {
                             enum IDA_siard_utils::SQLITE_COLTYPES sqlite3_coltype;
                             sqlite3_coltype = IDA_siard_utils::siard_type_to_sqlite3(siard_column_type);
                             string sqlite3_type = IDA_siard_utils::coltype_to_str(sqlite3_coltype);
-                            (verbose > 1) && sqlout << "--   column='" << column_name << "' (" << siard_column_type << " -> " << sqlite3_type << ")" << endl;
+                            sqlite3_coltype_by_name[column_name] = IDA_parsing_utils::trim(sqlite3_type);
+                            if (siard_colskipped_v[ic]) {
+                                (verbose > 1) && sqlout << "--   column='" << column_name << "' skipped (not in the projection)" << endl;
+                            } else {
+                                (verbose > 1) && sqlout << "--   column='" << column_name << "' (" << siard_column_type << " -> " << sqlite3_type << ")" << endl;
 
-                            SQL_create_table += "'" + column_name + "' " + sqlite3_type;
-                            if (ic < columns.size()-1 )
-                                SQL_create_table += ",\n";
+                                if (ncreated++) SQL_create_table += ",\n";
+                                SQL_create_table += "'" + column_name + "' " + sqlite3_type;
+                            }
 
                             // External files (lobFolder information for this column)
                             siard_lobfolder_info_v[ic].init(siardURI, column_name, col, siard_lobfolder);
@@ -2700,11 +5705,6 @@ namespace IDA {
                             #endif
                         }
 
-                        XMLElement *table_primarykey;
-                        vector<XMLElement*> primarykey_columns;  // <table> <primaryKey> <name> <column> <column> ...
-                        table_primarykey = IDA_xml_utils::find_element_by_tag(tab, "primaryKey");
-                        IDA_xml_utils::find_elements_by_tag(table_primarykey, "column", primarykey_columns);
-
                         // Add primary key when creating the table
                         // CREATE TABLE table_name(c1, c2, ..., PRIMARY KEY (c1, c2))
                         string SQL_primary_key = ",\n   PRIMARY KEY (";
@@ -2716,6 +5716,23 @@ namespace IDA {
                         }
                         SQL_primary_key[SQL_primary_key.size()-1] = ')'; // Last ',' -> ')'
                         SQL_primary_key += "\n";
+
+                        // In bulk-load mode, the uniqueness of the primary key is enforced by an
+                        // index created after inserting the rows, unless it is an alias of the rowid
+                        // (a single INTEGER column), which requires no index
+                        string SQL_deferred_primary_key;
+                        if (bulk && cpk && !(cpk == 1 && sqlite3_coltype_by_name[primarykey_columns[0]->GetText()] == "INTEGER")) {
+                            SQL_deferred_primary_key = "CREATE UNIQUE INDEX 'primary_key_idx_" + table_name + "'"
+                                                       + " ON '" + table_name + "' (";
+                            for (auto s: primarykey_columns) {
+                                string pk_column_name = s->GetText();
+                                SQL_deferred_primary_key += "\n  " + pk_column_name + ",";
+                            }
+                            SQL_deferred_primary_key[SQL_deferred_primary_key.size()-1] = ')'; // Last ',' -> ')'
+                            SQL_deferred_primary_key += ";\n";
+                            cpk = 0;
+                        }
+
                         if (cpk++) {
                             // Add P.K. to the statement to create the table
                             SQL_create_table += SQL_primary_key;
@@ -2725,6 +5742,7 @@ namespace IDA {
 
                         // Print SQL "create table ..."
                         sqlout << SQL_create_table;
+                        exec_pending_sql();
 
                         // Locating path of the file "table<N>.xml" with the content of the table
                         string table_path;
@@ -2735,44 +5753,73 @@ namespace IDA {
                         table_file = table_path + '/' + IDA_file_utils::get_basename(table_folder) + ".xml";
                         (verbose > 2) && sqlout << "--  path='" << table_path << endl;
                         (verbose > 2) && sqlout << "--  table file='" << table_file;
-                        if (SIARD_FILE_BY_FILE_UNZIP == unzipmode) {
+                        // If the siard is a zip file in the filesystem, the table file is read
+                        // from the zip as a stream; otherwise it is extracted to the temporary dir.
+                        bool table_file_in_zip = (SIARD_FILE_BY_FILE_UNZIP == unzipmode)
+                                                 && IDA_file_utils::is_regular_file(siardURI);
+                        double unzip_time = IDA_seconds();
+                        if (SIARD_FILE_BY_FILE_UNZIP == unzipmode && !table_file_in_zip) {
                             table_file = IDA_file_utils::unzipURI(table_file, tmpdir);
                         }
-                        ifstream tf(table_file.c_str());
-                        table_file_ok = tf.good();
-                        (verbose > 2) && sqlout << "->" << (table_file_ok?" XML file OK":" XML file not found") << endl;
-
-
-                        // Read the table file to generate SQL for data insertion
-                        if (table_file_ok) {
-                            // Parse and print the table xml file
-                            IDA_SIARDcontent C(table_name,
-                                               siardURI, tmpdir, unzipmode,
-                                               sqlout,
-                                               columns.size(),
-                                               siard_colname_v,
-                                               siard_coltype_v, siard_lobfolder_info_v);
-                            int errl = C.load(table_file);
-                            //C.print_tree();              //debug
-                            //cerr << ">>>---<<<" << endl; // debug
-                            //C.print_full_tree();         // debug
-                            //cerr << ">>>---<<<" << endl; // debug
-                            if (!errl) {
-                                C.tree_to_sql(std::max(0, verbose - 3));
-                                cerr << "OK converting '" << table_file << "' to sql" << endl; // Debug
-                            } else {
-                                cerr << "Error loading file '" << table_file << "'" << endl;
-                            }
-                            tf.close();
+                        unzip_time = IDA_seconds() - unzip_time;
+                        string table_entry = "content/" + schema_folder + '/' + table_folder + '/'
+                                             + IDA_file_utils::get_basename(table_folder) + ".xml";
+                        ifstream tf;
+                        if (!table_file_in_zip) {
+                            tf.open(table_file.c_str());
+                            table_file_ok = tf.good();
+                            (verbose > 2) && sqlout << "->" << (table_file_ok?" XML file OK":" XML file not found") << endl;
+                        } else {
+                            table_file_ok = true; // Checked when loading
+                        }
+                        tf.close();
+
+                        // Convert the table content, here or in the pool of threads
+                        IDA_SIARDtable_job *job = new IDA_SIARDtable_job(table_name,
+                                                                         siardURI, tmpdir, unzipmode,
+                                                                         columns.size(),
+                                                                         siard_colname_v,
+                                                                         siard_coltype_v, siard_lobfolder_info_v);
+                        job->table_file = table_file;
+                        job->table_entry = table_entry;
+                        job->table_file_in_zip = table_file_in_zip;
+                        job->table_file_ok = table_file_ok;
+                        job->SQL_create_table = SQL_create_table;
+                        job->pipelined = pipelined;
+                        job->bulk = bulk;
+                        job->batch_rows = batch_rows;
+                        job->commit_rows = commit_rows;
+                        job->verbose = verbose;
+                        if (nloaded < columns.size()) job->col_skipped = siard_colskipped_v;
+                        if (!indexed_columns.empty()) job->col_indexed = siard_colindexed_v;
+                        job->row_limit = row_limit;
+                        job->row_every = row_every;
+                        if (table_stats && !resumed) {
+                            table_stats->push_back(IDA_SIARDtable_stats());
+                            job->stats = &table_stats->back();
+                            job->stats->schema = schema_name;
+                            job->stats->table = table_name;
+                            job->stats->unzip_time = unzip_time;
+                        }
+                        unsigned long nrows = 0;
+                        if (resumed) {
+                            delete job;
+                        }
+                    #ifdef IDA_THREADS
+                        else if (pool) {
+                            pool->submit(job);
                         }
-
-                    #ifndef IDA_FULL_UNZIP
-                        IDA_file_utils::delete_temp_file(tmpdir, table_file);
                     #endif
+                        else {
+                            job->run(sqlout, db);
+                            nrows = job->nrows;
+                            failures += job->nfailed;
+                            delete job;
+                        }
 
                         // Add unique indexes (siard candidate keys)
                         // <table> <candidateKeys> <candidateKey> <name> <column> <column> ... </candidateKey> .... <candidateKeys> </table>
-                        string SQL_unique_index;
+                        string SQL_unique_index = SQL_deferred_primary_key;
                         XMLElement *table_candidate_keys = IDA_xml_utils::find_element_by_tag(tab, "candidateKeys");
                         vector<XMLElement*> candidate_keys;
                         IDA_xml_utils::find_elements_by_tag(table_candidate_keys, "candidateKey", candidate_keys, 2);
@@ -2781,6 +5828,15 @@ namespace IDA {
                             string candidatekey_name = IDA_xml_utils::find_elementText_by_tag(ck, "name");
                             vector<XMLElement*> candidatekey_columns;
                             IDA_xml_utils::find_elements_by_tag(ck, "column", candidatekey_columns, 2);
+                            // No index for a candidate key with columns skipped by the projection
+                            bool ck_skipped = false;
+                            for (auto s: candidatekey_columns) {
+                                if (skipped_columns.count(s->GetText() ? s->GetText() : "")) ck_skipped = true;
+                            }
+                            if (ck_skipped) {
+                                iuk++;
+                                continue;
+                            }
                             //CREATE UNIQUE INDEX name_idx ON table (column1, column2);
                             SQL_unique_index += "CREATE UNIQUE INDEX unique_idx" + to_string(iuk) + "_" + candidatekey_name;
                             SQL_unique_index += " ON " + table_name + " (";
@@ -2793,9 +5849,23 @@ namespace IDA {
                             iuk++;
                         }
                         sqlout <<  SQL_unique_index;
+                        exec_pending_sql();
+
+                        if (resumed) {
+                            discarded.str("");
+                            if (--nresumed == 0 || db) sqlout.rdbuf(out.rdbuf());
+                        } else if (checkpoint) {
+                            checkpoint_table(schema_name, table_name, nrows);
+                        }
                     }
                 }
 
+                if (bulk) {
+                    // Restore the default settings of sqlite3
+                    sqlout << "PRAGMA synchronous=FULL;\n";
+                    sqlout << "PRAGMA journal_mode=DELETE;\n";
+                }
+
                 if (!rep_tables.empty()) {
                     (verbose > 0) && cerr << endl;
                     (verbose > 0) && cerr << "Warning: found table names repeated in different schemas:" << endl;
@@ -2830,26 +5900,415 @@ namespace IDA {
             }
         }
 
+        // Set the number of tables converted in parallel by tree_to_sql()/tree_to_sqlite()
+        // (only when compiled with threads; otherwise tables are always converted one by one)
+        void set_jobs(unsigned long n)
+        {
+            njobs = std::max(1UL, n);
+        }
+
+        // Number of errors converting the contents of the tables (rows not inserted,
+        // lobs not read, ...; see IDA_SIARDcontent::get_failures()) in the last
+        // tree_to_sql() or tree_to_sqlite(), which are not aborted by them
+        unsigned long get_failures() const
+        {
+            return failures;
+        }
+
+        // Inflate, parse and convert the rows of each table in three threads
+        // linked by ring buffers (see IDA_SIARDrow_pipeline); ignored without threads
+        void set_pipelined(bool p)
+        {
+            pipelined = p;
+        }
+
+        // Bulk-load mode: journal and synchronous writes are disabled during the load,
+        // rows are inserted in transactions (one per table or per 'commit_rows' rows)
+        // with multi-row INSERT statements ('batch_rows' rows), and primary keys
+        // are created as unique indexes after inserting the rows of each table
+        void set_bulk(bool enable, unsigned long batch_rows = 100, unsigned long commit_rows = 0)
+        {
+            this->bulk = enable;
+            this->batch_rows = batch_rows;
+            this->commit_rows = commit_rows;
+        }
+
+        // Record the tables converted by tree_to_sql()/tree_to_sqlite() in the journal
+        // 'c', and skip those already recorded in it if resuming (NULL to not use it)
+        void set_checkpoint(IDA_SIARDcheckpoint *c)
+        {
+            checkpoint = c;
+        }
+
+        // Convert only the table 'table' of schema 'schema' with tree_to_sql()/tree_to_sqlite(),
+        // even if its name is repeated in a previous schema ("" to convert all tables)
+        void set_table(const string &schema, const string &table)
+        {
+            only_schema = schema;
+            only_table = table;
+        }
+
+        // Convert only the tables whose names match the c++ regular expression 'filter' (case
+        // insensitive, like the schema filter); "" for all
+        void set_table_filter(const string &filter)
+        {
+            table_filter = filter;
+        }
+
+        // Convert only one row of every 'every' rows of each table, and 'limit' rows at most
+        // (0: all), e.g., to preview an archive; rows not converted are not even parsed
+        void set_sampling(unsigned long limit, unsigned long every)
+        {
+            row_limit = limit;
+            row_every = std::max(1UL, every);
+        }
+
+        // Add the counters and times of the conversion of each table to 'stats' (NULL to
+        // not collect them); they are printed by print_schemas() and saved by write_stats()
+        void set_stats(std::deque<IDA_SIARDtable_stats> *stats)
+        {
+            table_stats = stats;
+            stats_time = 0;
+        }
+
+        // Write the statistics of the last conversion (see set_stats()) as a JSON file:
+        //   {"seconds": ..., "tables": [{"schema": ..., "table": ..., "rows": ..., ...}, ...]}
+        // Return 0 if OK, -1 if error
+        int write_stats(const string &file) const
+        {
+            if (!table_stats) return -1;
+            ofstream out(file);
+            if (!out.good()) {
+                cerr << "Error opening statistics file '" << file << "'" << endl;
+                return -1;
+            }
+            auto json_string = [](const string &s) {
+                string r = "\"";
+                for (unsigned char c: s) {
+                    if (c == '"' || c == '\\') {
+                        r += '\\';
+                        r += c;
+                    } else if (c < 0x20) {
+                        char u[8];
+                        snprintf(u, sizeof(u), "\\u%04x", c);
+                        r += u;
+                    } else {
+                        r += c;
+                    }
+                }
+                return r + "\"";
+            };
+            out << fixed << setprecision(6);
+            out << "{\n  \"siard\": " << json_string(siardURI) << ",\n  \"seconds\": " << stats_time
+                << ",\n  \"tables\": [";
+            for (unsigned long k = 0; k < table_stats->size(); k++) {
+                const IDA_SIARDtable_stats &T = (*table_stats)[k];
+                double t = T.unzip_time + T.parse_time + T.emit_time;
+                out << (k ? ",\n" : "\n")
+                    << "    {\"schema\": " << json_string(T.schema) << ", \"table\": " << json_string(T.table)
+                    << ", \"rows\": " << T.rows << ", \"cells\": " << T.cells
+                    << ", \"text_bytes\": " << T.text_bytes << ", \"lobs\": " << T.lobs
+                    << ", \"lob_bytes\": " << T.lob_bytes << ", \"out_bytes\": " << T.out_bytes
+                    << ", \"unzip_seconds\": " << T.unzip_time << ", \"parse_seconds\": " << T.parse_time
+                    << ", \"emit_seconds\": " << T.emit_time
+                    << ", \"rows_per_second\": " << (t > 0 ? T.rows / t : 0)
+                    << ", \"bytes_per_second\": " << (t > 0 ? (T.text_bytes + T.lob_bytes) / t : 0) << "}";
+            }
+            out << "\n  ]\n}\n";
+            out.close();
+            if (!out.good()) {
+                cerr << "Error writing statistics file '" << file << "'" << endl;
+                return -1;
+            }
+            return 0;
+        }
+
+        // Convert only the tables and columns of the projection 'p' (NULL for all); the
+        // columns of primary keys are always converted, and the unique indexes of candidate
+        // keys with columns not converted are not created
+        void set_projection(const IDA_SIARDprojection *p)
+        {
+            projection = (p && !p->empty()) ? p : NULL;
+        }
+
         // This version of this method use a filename
-        void tree_to_sql(string outfilename, const char *schema_filter = ".", int verbose= 2)
+        // Return 0 if OK, -1 if the conversion failed
+        int tree_to_sql(string outfilename, const char *schema_filter = ".", int verbose= 2)
         {
-            ofstream sqloutfile(outfilename);
+            double t0 = IDA_seconds();
+            failures = 0;
+            ofstream sqloutfile;
+            unsigned long long offset = checkpoint ? checkpoint->get_offset() : 0;
+            if (offset > 0) {
+                // Resuming: keep the SQL of the tables already converted
+                struct stat st;
+                if (!stat(outfilename.c_str(), &st) && (unsigned long long) st.st_size >= offset
+                    && !truncate(outfilename.c_str(), offset)) {
+                    sqloutfile.open(outfilename, ios::in | ios::out);
+                    sqloutfile.seekp(0, ios::end);
+                } else {
+                    cerr << "SQL file '" << outfilename << "' does not match the checkpoint; converting all tables" << endl;
+                    checkpoint->reset();
+                }
+            }
+            if (!sqloutfile.is_open()) sqloutfile.open(outfilename);
             if (!sqloutfile.good()){
                 cerr << "Error opening output sqlite file '" << outfilename << "'" << endl;
-                return;
+                return -1;
             }
             // Raise exception if the file has any bad bit (ofstream::badbit, ofstream::eofbit, ofstream::failbit)
             sqloutfile.exceptions(~std::ofstream::goodbit);
+            checkpoint_out = &sqloutfile;
+            int rc = -1;
             try {
+            #ifdef IDA_THREADS
+                if (njobs > 1) {
+                    ostringstream ss;
+                    IDA_SIARDtable_pool P(njobs, sqloutfile, NULL, ss);
+                    pool = &P;
+                    try {
+                        tree_to_sql(ss, schema_filter, verbose);
+                        P.finish();
+                        failures += P.get_failures();
+                    } catch (...) {
+                        pool = NULL;
+                        throw;
+                    }
+                    pool = NULL;
+                } else
+            #endif
                 tree_to_sql(sqloutfile, schema_filter, verbose);
+                sqloutfile.flush();
+                rc = 0;
             } catch (const std::exception &e) {
                 // catch anything thrown within try block that derives from std::exception
                 cerr << "*EXCEPTION converting to SQL; " << "  what: '" << e.what() << "'" << endl;
             } catch (...){
                 cerr << "*Unknown EXCEPTION converting to SQL; " << endl;
             }
+            checkpoint_out = NULL;
+            stats_time = IDA_seconds() - t0;
+            return rc;
+        }
+
+        // This version of this method inserts the siard content directly into an open
+        // sqlite3 database, without generating an intermediate SQL file
+        // Return 0 if OK, -1 if the conversion failed
+        int tree_to_sqlite(sqlite3 *sqlitedb, const char *schema_filter = ".", int verbose= 2)
+        {
+            double t0 = IDA_seconds();
+            failures = 0;
+            ostringstream ss;
+            db = sqlitedb;
+            sqlbuf = &ss;
+            int rc = -1;
+            try {
+            #ifdef IDA_THREADS
+                if (njobs > 1) {
+                    IDA_SIARDtable_pool P(njobs, cout, db, ss);
+                    pool = &P;
+                    try {
+                        tree_to_sql(ss, schema_filter, verbose);
+                        P.finish();
+                        failures += P.get_failures();
+                    } catch (...) {
+                        pool = NULL;
+                        throw;
+                    }
+                    pool = NULL;
+                }
+                else
+            #endif
+                tree_to_sql(ss, schema_filter, verbose);
+                exec_pending_sql();
+                rc = 0;
+            } catch (const std::exception &e) {
+                cerr << "*EXCEPTION converting to sqlite3; " << "  what: '" << e.what() << "'" << endl;
+            } catch (...){
+                cerr << "*Unknown EXCEPTION converting to sqlite3; " << endl;
+            }
+            db = NULL;
+            sqlbuf = NULL;
+            stats_time = IDA_seconds() - t0;
+            return rc;
+        }
+
+    private:
+        // Record in the checkpoint journal that a table has been converted, once its
+        // rows and indexes are output (with a pool of threads, when its turn comes)
+        void checkpoint_table(const string &schema, const string &table, unsigned long nrows)
+        {
+        #ifdef IDA_THREADS
+            if (pool) {
+                pool->after([this, schema, table](unsigned long n) { record_checkpoint(schema, table, n); });
+                return;
+            }
+        #endif
+            record_checkpoint(schema, table, nrows);
+        }
+
+        void record_checkpoint(const string &schema, const string &table, unsigned long nrows)
+        {
+            unsigned long long offset = 0;
+            if (checkpoint_out) {
+                checkpoint_out->flush();
+                offset = checkpoint_out->tellp();
+            }
+            checkpoint->record(schema, table, nrows, offset);
+        }
+
+        // When converting directly into sqlite3, execute the SQL statements
+        // written so far (create table, indexes, ...) and empty the buffer
+        void exec_pending_sql()
+        {
+            if (!db || !sqlbuf) return;
+        #ifdef IDA_THREADS
+            if (pool) return; // The pool executes it in order with the table contents
+        #endif
+            string sql = sqlbuf->str();
+            sqlbuf->str("");
+            char *errmsg = NULL;
+            if (sqlite3_exec(db, sql.c_str(), NULL, NULL, &errmsg) != SQLITE_OK) {
+                cerr << "Error executing SQL in sqlite3 database: " << (errmsg ? errmsg : "") << endl;
+                failures++;
+            }
+            sqlite3_free(errmsg);
+        }
+    }; /* class IDA_SIARDmetadata */
+
+    // Tables of SIARD files queried through the virtual table module "siard" (see
+    // IDA_siard_vtab_init()). The first scan of a table converts only that table, parsing
+    // its table<N>.xml from the archive, into a private in-memory sqlite3 database that
+    // serves the next scans. The databases are kept up to a limit of bytes; beyond it, the
+    // least recently used ones not being scanned are closed
+    class IDA_SIARDvtab_cache {
+        struct entry {
+            sqlite3 *db = NULL;
+            unsigned long long bytes = 0;  // Size of the database
+            unsigned long refs = 0;        // Scans using it
+            list<string>::iterator lru;    // Position in the list of recently used
+        };
+
+        map<string, entry> entries;
+        list<string> lru;                  // Keys of the entries, most recently used first
+        unsigned long long total = 0;      // Bytes of all the databases
+        unsigned long long limit = 256ULL << 20;
+    #ifdef IDA_THREADS
+        std::mutex mtx;
+    #endif
+
+    public:
+        ~IDA_SIARDvtab_cache()
+        {
+            for (auto &e: entries) sqlite3_close(e.second.db);
+        }
+
+        // The cache shared by all the virtual tables
+        static IDA_SIARDvtab_cache &instance()
+        {
+            static IDA_SIARDvtab_cache cache;
+            return cache;
+        }
+
+        // Return a database with the table 'table' of the schema 'schema' of the siard file
+        // 'siard' (a real path), converting the table if not in the cache, or NULL if it
+        // cannot be converted. The database is kept until release(key) is called
+        sqlite3 *acquire(const string &siard, const string &schema, const string &table, string &key)
+        {
+            struct stat st;
+            if (stat(siard.c_str(), &st)) return NULL;
+            key = siard + '\n' + to_string(st.st_size) + ' ' + to_string(st.st_mtime) + '\n' + schema + '\n' + table;
+
+        #ifdef IDA_THREADS
+            std::lock_guard<std::mutex> lock(mtx);
+        #endif
+            auto it = entries.find(key);
+            if (it == entries.end()) {
+                sqlite3 *db = convert(siard, schema, table);
+                if (!db) return NULL;
+                it = entries.emplace(key, entry()).first;
+                it->second.db = db;
+                it->second.bytes = database_size(db);
+                total += it->second.bytes;
+                lru.push_front(key);
+                it->second.lru = lru.begin();
+            } else {
+                lru.splice(lru.begin(), lru, it->second.lru);
+            }
+            it->second.refs++;
+            evict();
+            return it->second.db;
+        }
+
+        // The scan of a database returned by acquire() ended
+        void release(const string &key)
+        {
+        #ifdef IDA_THREADS
+            std::lock_guard<std::mutex> lock(mtx);
+        #endif
+            auto it = entries.find(key);
+            if (it != entries.end() && it->second.refs > 0) it->second.refs--;
+            evict();
+        }
+
+        // Set the maximum bytes of the databases kept (0 to keep only those being scanned)
+        void set_limit(unsigned long long bytes)
+        {
+        #ifdef IDA_THREADS
+            std::lock_guard<std::mutex> lock(mtx);
+        #endif
+            limit = bytes;
+            evict();
+        }
+
+    private:
+        // Close the least recently used databases not being scanned, until the limit is met
+        void evict()
+        {
+            for (auto r = lru.end(); total > limit && r != lru.begin(); ) {
+                --r;
+                auto it = entries.find(*r);
+                if (it->second.refs) continue;
+                sqlite3_close(it->second.db);
+                total -= it->second.bytes;
+                entries.erase(it);
+                r = lru.erase(r);
+            }
+        }
+
+        static unsigned long long database_size(sqlite3 *db)
+        {
+            unsigned long long bytes = 0;
+            sqlite3_stmt *stmt = NULL;
+            if (sqlite3_prepare_v2(db, "SELECT P.page_count*S.page_size FROM pragma_page_count() AS P, pragma_page_size() AS S;",
+                                   -1, &stmt, NULL) == SQLITE_OK && sqlite3_step(stmt) == SQLITE_ROW) {
+                bytes = sqlite3_column_int64(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+            return bytes;
+        }
+
+        // Convert one table into a new in-memory database (NULL if error)
+        static sqlite3 *convert(const string &siard, const string &schema, const string &table)
+        {
+            sqlite3 *db = NULL;
+            if (sqlite3_open(":memory:", &db) != SQLITE_OK) {
+                sqlite3_close(db);
+                return NULL;
+            }
+            IDA_SIARDmetadata M(siard);
+            M.set_bulk(true, 100, 0);
+            M.set_table(schema, table);
+        #ifdef IDA_FULL_UNZIP
+            M.unzip();
+        #endif
+            if (M.load() == -1 || M.tree_to_sqlite(db, "", 0)) {
+                sqlite3_close(db);
+                return NULL;
+            }
+            return db;
         }
-    }; /* class IDA_SIARDmetadata */
+    }; /* class IDA_SIARDvtab_cache */
 } /* namespace IDA */
 
 /* C public API */
@@ -2872,6 +6331,253 @@ extern "C" {
         #endif
     }
 
+    // Number of tables converted in parallel by IDA_siard2sql() and IDA_siard2sqlite_db()
+    static int IDA_siard2sql_njobs = 1;
+    // Whether rows are read with a pipeline of threads
+    static int IDA_siard2sql_pipelined = 0;
+    // Bulk-load mode settings
+    static int IDA_siard2sql_bulk = 0;
+    static long IDA_siard2sql_batch_rows = 100;
+    static long IDA_siard2sql_commit_rows = 0;
+    // Catalog cache used when listing schemas (disabled by default)
+    static int IDA_siard2sql_catalog = 0;
+    static string IDA_siard2sql_catalog_dir;
+    // Resume interrupted conversions from their checkpoint journal
+    static int IDA_siard2sql_resume = 0;
+    // Cache of databases loaded by IDA_siard2sqlite_db() (empty if disabled)
+    static string IDA_siard2sql_db_cache_dir;
+    // Tables and columns converted (empty: all)
+    static IDA_SIARDprojection IDA_siard2sql_projection;
+    // Regex of the names of the tables converted (empty: all)
+    static string IDA_siard2sql_table_filter;
+    // Rows converted of each table (0: all) and sampling (1 of every 'every' rows)
+    static unsigned long IDA_siard2sql_row_limit = 0;
+    static unsigned long IDA_siard2sql_row_every = 1;
+    // JSON file with the statistics of each table converted (empty: not collected)
+    static string IDA_siard2sql_stats_file;
+
+    // Set the number of tables converted in parallel (1 by default)
+    // Output is the same as when converting tables one by one
+    // Ignored if the library was built without threads (e.g., for ivm64)
+    void IDA_siard2sql_set_jobs(int njobs)
+    {
+        IDA_siard2sql_njobs = (njobs > 1) ? njobs : 1;
+    }
+
+    // Read the rows of each table with a pipeline of three threads (inflate,
+    // parse and convert), which speeds up the conversion of large tables
+    // Ignored if the library was built without threads (e.g., for ivm64)
+    void IDA_siard2sql_set_pipeline(int pipelined)
+    {
+        IDA_siard2sql_pipelined = pipelined;
+    }
+
+    // Enable (or disable) the bulk-load mode:
+    //   - journal_mode=OFF and synchronous=OFF during the load
+    //   - rows inserted in transactions, one per table or one each 'commit_rows' rows (if > 0)
+    //   - multi-row INSERT statements with 'batch_rows' rows at most (only SQL output)
+    //   - primary keys created as unique indexes after inserting the rows of the table
+    // Use batch_rows <= 0 for the default (100 rows)
+    void IDA_siard2sql_set_bulk(int enable, long batch_rows, long commit_rows)
+    {
+        IDA_siard2sql_bulk = enable;
+        IDA_siard2sql_batch_rows = (batch_rows > 0) ? batch_rows : 100;
+        IDA_siard2sql_commit_rows = (commit_rows > 0) ? commit_rows : 0;
+    }
+
+    // Enable (or disable) the catalog cache used by IDA_siard2sql() when only listing
+    // the schemas (sqlfileout == NULL): the summary of header/metadata.xml is saved
+    // in a binary file, and loaded instead of parsing metadata.xml the next time the
+    // same archive (same size, modification time and metadata CRC) is listed
+    // The catalog is saved in 'cachedir' if not NULL nor empty, or else next to the
+    // archive (<archive>.catalog). It is disabled by default
+    void IDA_siard2sql_set_catalog(int enable, const char *cachedir)
+    {
+        IDA_siard2sql_catalog = enable;
+        IDA_siard2sql_catalog_dir = cachedir ? cachedir : "";
+    }
+
+    // Resume (or not) the conversion of IDA_siard2sql() and IDA_siard2sqlite_db()
+    // from the checkpoint journal of a previous one that was interrupted, skipping
+    // the tables it already converted. The journal is always written while converting
+    // ('<sqlfileout>.ckpt' or table '_ida_siard2sql_checkpoint' of the database), and
+    // deleted when the conversion ends; it is only used for the same siard file
+    // (size and modification time), schema filter and bulk-load settings
+    void IDA_siard2sql_set_resume(int resume)
+    {
+        IDA_siard2sql_resume = resume;
+    }
+
+    // Convert only the tables and columns given by 'spec', a list "table.column, table.*,
+    // table2, ..." (see IDA_SIARDprojection), in IDA_siard2sql() and IDA_siard2sqlite_db();
+    // other columns are skipped before their contents (e.g., lobs) are decoded or extracted
+    // NULL or "" to convert all of them (the default)
+    // Return 0 if OK, -1 if the list is wrong (then all are converted)
+    int IDA_siard2sql_set_projection(const char *spec)
+    {
+        return IDA_siard2sql_projection.set_list(spec ? spec : "");
+    }
+
+    // Same as IDA_siard2sql_set_projection(), but the projection is derived from the SQL
+    // queries that will be run on the converted database (e.g., the bodies of the commands
+    // of a ROAE file, separated by ';'): only the tables and columns named in them are
+    // converted (all the columns of a table if a query selects '*')
+    void IDA_siard2sql_set_projection_sql(const char *sql)
+    {
+        IDA_siard2sql_projection.set_sql(sql ? sql : "");
+    }
+
+    // Convert only the tables whose names match the c++ regular expression 'filter'
+    // (case insensitive, like the schema filter) in IDA_siard2sql() and IDA_siard2sqlite_db()
+    // NULL or "" to convert all of them (the default)
+    // Return 0 if OK, -1 if the regex is not valid (then all are converted)
+    int IDA_siard2sql_set_table_filter(const char *filter)
+    {
+        IDA_siard2sql_table_filter = "";
+        if (!filter || !*filter) return 0;
+        if (!IDA_parsing_utils::is_valid_regex(filter)) {
+            fprintf(stderr, "Invalid table filter regex: '%s'\n", filter);
+            return -1;
+        }
+        IDA_siard2sql_table_filter = filter;
+        return 0;
+    }
+
+    // Convert at most 'limit' rows of each table (0: all), and only one row of every
+    // 'every' rows (1: all; e.g., 100 to sample 1% of the rows), in IDA_siard2sql() and
+    // IDA_siard2sqlite_db(); the rows not converted are skipped in the row XML stream
+    // without being parsed, and the rest of the table is not even read after the last
+    // row converted, so that a preview of a large archive takes little time
+    void IDA_siard2sql_set_rows(long limit, long every)
+    {
+        IDA_siard2sql_row_limit = (limit > 0) ? limit : 0;
+        IDA_siard2sql_row_every = (every > 1) ? every : 1;
+    }
+
+    // Collect the counters (rows, cells, text and lob bytes, bytes written) and times
+    // (unzip, parse, emit) of each table converted by IDA_siard2sql() and
+    // IDA_siard2sqlite_db(), print a summary after the schemas, and write them to
+    // 'jsonfile' (NULL or "" to not collect them, the default)
+    void IDA_siard2sql_set_stats(const char *jsonfile)
+    {
+        IDA_siard2sql_stats_file = jsonfile ? jsonfile : "";
+    }
+
+    // Settings changing the converted database, other than the schema filter and bulk mode
+    // (part of the checkpoint key and of the name of the database cache files)
+    static string IDA_siard2sql_selection_key()
+    {
+        string key;
+        if (!IDA_siard2sql_projection.empty()) key += " projection=" + IDA_siard2sql_projection.get_key();
+        if (!IDA_siard2sql_table_filter.empty()) key += " tables=" + IDA_siard2sql_table_filter;
+        if (IDA_siard2sql_row_limit || IDA_siard2sql_row_every > 1) {
+            key += " rows=" + to_string(IDA_siard2sql_row_limit) + "/" + to_string(IDA_siard2sql_row_every);
+        }
+        return key;
+    }
+
+    // Key of the checkpoint journal of a conversion (see IDA_SIARDcheckpoint)
+    static string IDA_siard2sql_checkpoint_key(const string &realsiard, const char *schema_filter)
+    {
+        struct stat st;
+        if (stat(realsiard.c_str(), &st)) return "";
+        ostringstream key;
+        key << realsiard << " size=" << st.st_size << " mtime=" << st.st_mtime
+            << " filter=" << schema_filter << " bulk=" << IDA_siard2sql_bulk;
+        if (IDA_siard2sql_bulk) key << "," << IDA_siard2sql_batch_rows << "," << IDA_siard2sql_commit_rows;
+        key << IDA_siard2sql_selection_key();
+        return key.str();
+    }
+
+    // Save the main database of 'db' (e.g., the in-memory database of the shell) to 'file',
+    // a regular sqlite3 database file; it is written to a temporary file which is renamed
+    // Return 0 if OK, -1 if error
+    int IDA_sqlite_snapshot_save(sqlite3 *db, const char *file)
+    {
+        string tmp = string(file) + ".tmp";
+        unlink(tmp.c_str());
+        char *sql = sqlite3_mprintf("VACUUM main INTO %Q;", tmp.c_str());
+        char *errmsg = NULL;
+        int rc = sqlite3_exec(db, sql, NULL, NULL, &errmsg);
+        sqlite3_free(sql);
+        if (rc != SQLITE_OK || rename(tmp.c_str(), file)) {
+            cerr << "Error saving database to '" << file << "': " << (errmsg ? errmsg : strerror(errno)) << endl;
+            sqlite3_free(errmsg);
+            unlink(tmp.c_str());
+            return -1;
+        }
+        return 0;
+    }
+
+    // Replace the main database of 'db' with a copy in memory of the database 'file'
+    // (saved by IDA_sqlite_snapshot_save(), or any sqlite3 database file), which is
+    // read at once and deserialized, so it is writable and the file is not used later
+    // Return 0 if OK, -1 if error (then the main database is not changed)
+    int IDA_sqlite_snapshot_restore(sqlite3 *db, const char *file)
+    {
+        int fd = open(file, O_RDONLY);
+        if (fd < 0) return -1;
+        struct stat st;
+        // A sqlite3 database has at least one page of 512 bytes, starting with this header
+        static const char magic[] = "SQLite format 3";
+        unsigned char *image = NULL;
+        bool ok = !fstat(fd, &st) && st.st_size >= 512
+                  && (image = (unsigned char*) sqlite3_malloc64(st.st_size))
+                  && IDA_file_utils::read_all(fd, (char*) image, st.st_size)
+                  && !memcmp(image, magic, sizeof(magic));
+        close(fd);
+        if (!ok) {
+            sqlite3_free(image);
+            return -1;
+        }
+        // The image is freed by sqlite3 when the database is closed (or on error)
+        if (sqlite3_deserialize(db, "main", image, st.st_size, st.st_size,
+                                SQLITE_DESERIALIZE_FREEONCLOSE | SQLITE_DESERIALIZE_RESIZEABLE) != SQLITE_OK
+            || sqlite3_exec(db, "SELECT count(*) FROM main.sqlite_schema;", NULL, NULL, NULL) != SQLITE_OK) {
+            cerr << "Error restoring database from '" << file << "': " << sqlite3_errmsg(db) << endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Enable the cache of databases loaded by IDA_siard2sqlite_db() in the directory
+    // 'cachedir' (NULL or "" to disable it, the default). When loading a siard zip into
+    // an empty database, the result is saved to the cache with IDA_sqlite_snapshot_save(),
+    // named after a digest of the zip content (see IDA_unzip_digest()), the schema filter
+    // and the bulk-load setting; next loads of the same content restore it from there
+    void IDA_siard2sql_set_db_cache(const char *cachedir)
+    {
+        IDA_siard2sql_db_cache_dir = cachedir ? cachedir : "";
+    }
+
+    // Name of the file of the cache of databases for a siard zip (empty if not available)
+    static string IDA_siard2sql_db_cache_file(const string &realsiard, const char *schema_filter)
+    {
+        char digest[64];
+        if (IDA_siard2sql_db_cache_dir.empty() || !IDA_file_utils::is_regular_file(realsiard)
+            || IDA_unzip_digest(realsiard.c_str(), digest, sizeof(digest))) {
+            return "";
+        }
+        // The settings changing the database are part of the name
+        string settings = string("filter=") + schema_filter + " bulk=" + to_string(IDA_siard2sql_bulk);
+        settings += IDA_siard2sql_selection_key();
+        uint64_t h = 14695981039346656037ULL;
+        for (unsigned char c: settings) h = (h ^ c) * 1099511628211ULL;
+        char name[128];
+        snprintf(name, sizeof(name), "/%s-%016llx.sqlite3", digest, (unsigned long long) h);
+        return IDA_siard2sql_db_cache_dir + name;
+    }
+
+    // Whether the main database of 'db' has no tables, indexes, ...
+    static bool IDA_sqlite_is_empty(sqlite3 *db)
+    {
+        sqlite3_stmt *stmt = NULL;
+        bool empty = (sqlite3_prepare_v2(db, "SELECT count(*) FROM main.sqlite_schema;", -1, &stmt, NULL) == SQLITE_OK)
+                     && (sqlite3_step(stmt) == SQLITE_ROW) && (sqlite3_column_int64(stmt, 0) == 0);
+        sqlite3_finalize(stmt);
+        return empty;
+    }
+
     // This is the main C function in charge of converting SIARD to
     // sqlite3-compliant SQL
     //
@@ -2908,7 +6614,29 @@ extern "C" {
             schema_filter = "";
         }
 
+        // When only listing schemas of a siard file, use its cached catalog if still valid
+        IDA_SIARDcatalog C;
+        string catalog_file;
+        if (!sqlfileout && IDA_siard2sql_catalog && !IDA_file_utils::is_directory(realsiard)
+            && !C.set_key(realsiard)) {
+            catalog_file = IDA_SIARDcatalog::cache_file(realsiard, IDA_siard2sql_catalog_dir);
+            if (!C.load(catalog_file)) {
+                cerr << "Catalog '" << catalog_file << "' loaded" << endl; // Debug
+                puts("");
+                C.print_schemas(schema_filter);
+                puts("");
+                return 0;
+            }
+        }
+
         IDA_SIARDmetadata M(siardfilein);
+        M.set_jobs(IDA_siard2sql_njobs);
+        M.set_pipelined(IDA_siard2sql_pipelined);
+        M.set_bulk(IDA_siard2sql_bulk, IDA_siard2sql_batch_rows, IDA_siard2sql_commit_rows);
+        M.set_projection(&IDA_siard2sql_projection);
+        M.set_table_filter(IDA_siard2sql_table_filter);
+        M.set_sampling(IDA_siard2sql_row_limit, IDA_siard2sql_row_every);
+        std::deque<IDA_SIARDtable_stats> stats;
 #ifdef IDA_FULL_UNZIP
         M.unzip(!sqlfileout);
 #endif
@@ -2918,10 +6646,39 @@ extern "C" {
             return -1;
         }
 
+        if (!catalog_file.empty()) {
+            IDA_SIARDcatalog_header key = C.key;
+            C = M.get_catalog();
+            C.key = key;
+            if (!IDA_siard2sql_catalog_dir.empty()) mkdir(IDA_siard2sql_catalog_dir.c_str(), 0777);
+            if (C.save(catalog_file))
+                cerr << "Catalog '" << catalog_file << "' cannot be saved" << endl; // Debug
+        }
+
         //  If sqlfileout is not null generate sqlite3 SQL from the siard just parsed
         //  else print only a summary of schemas
+        int converr = 0;
         if (sqlfileout) {
-            M.tree_to_sql(sqlfileout, schema_filter);
+            // Record the converted tables, to resume the conversion if interrupted
+            IDA_SIARDcheckpoint K;
+            string journal = string(sqlfileout) + ".ckpt";
+            if (K.open(journal, IDA_siard2sql_checkpoint_key(realsiard, schema_filter), IDA_siard2sql_resume)) {
+                cerr << "Warning: checkpoint journal '" << journal << "' cannot be written" << endl;
+            } else {
+                if (K.is_resumed())
+                    cerr << "Resuming conversion: " << K.get_ndone() << " tables already converted" << endl;
+                M.set_checkpoint(&K);
+            }
+            if (!IDA_siard2sql_stats_file.empty()) M.set_stats(&stats);
+            converr = M.tree_to_sql(sqlfileout, schema_filter);
+            M.set_checkpoint(NULL);
+            if (!converr) K.finish();
+            if (!converr && M.get_failures()) {
+                cerr << "Error: " << M.get_failures() << " errors converting the tables, data may be missing" << endl;
+                converr = -1;
+            }
+            if (!IDA_siard2sql_stats_file.empty() && !M.write_stats(IDA_siard2sql_stats_file))
+                cerr << "Statistics saved to '" << IDA_siard2sql_stats_file << "'" << endl;
         }
 
         // Printing schemas requires only header/metadata.xml
@@ -2947,7 +6704,510 @@ extern "C" {
         }
         #endif
 
-        return 0;
+        return converr ? -1 : 0;
+    }
+
+    // Convert SIARD directly into an open sqlite3 database, without generating
+    // the intermediate SQL file: tables are created and rows are inserted with
+    // prepared statements (sqlite3_bind_*), so cell contents are neither formatted
+    // as SQL text nor parsed again by sqlite
+    //
+    // Argument siardfilein can be a SIARD (.zip) file or a directory with the
+    // unzipped SIARD file, like in IDA_siard2sql()
+    //
+    // The schema_filter is a regular expression to filter schemas
+    // by name; only those schema names matching it will be converted
+    // Use "" to not filter.
+    //
+    int IDA_siard2sqlite_db(const char *siardfilein, sqlite3 *db, const char *schema_filter)
+    {
+        string realsiard = IDA_file_utils::get_realpath(siardfilein);
+        if (realsiard.empty()){
+            fprintf(stderr, "File/directory '%s' not found\n", siardfilein);
+            return -1;
+        }
+
+        if (!db){
+            fprintf(stderr, "No sqlite3 database to load '%s' into\n", siardfilein);
+            return -1;
+        }
+
+        // If schema_filter is NULL, no filter is applied
+        if (!schema_filter){
+            schema_filter = "";
+        }
+
+        if (!IDA_parsing_utils::is_valid_regex(schema_filter)){
+            fprintf(stderr, "Schema filter '%s' is not a valid regexp expression\n", schema_filter);
+            return -1;
+        }
+
+        // Restore the database from the cache, if there
+        string cache_file;
+        if (!IDA_siard2sql_db_cache_dir.empty() && IDA_sqlite_is_empty(db)) {
+            cache_file = IDA_siard2sql_db_cache_file(realsiard, schema_filter);
+            if (!cache_file.empty() && !IDA_sqlite_snapshot_restore(db, cache_file.c_str())) {
+                cerr << "Database restored from cache '" << cache_file << "'" << endl;
+                return 0;
+            }
+        }
+
+        IDA_SIARDmetadata M(siardfilein);
+        M.set_jobs(IDA_siard2sql_njobs);
+        M.set_pipelined(IDA_siard2sql_pipelined);
+        M.set_bulk(IDA_siard2sql_bulk, IDA_siard2sql_batch_rows, IDA_siard2sql_commit_rows);
+        M.set_projection(&IDA_siard2sql_projection);
+        M.set_table_filter(IDA_siard2sql_table_filter);
+        M.set_sampling(IDA_siard2sql_row_limit, IDA_siard2sql_row_every);
+        std::deque<IDA_SIARDtable_stats> stats;
+#ifdef IDA_FULL_UNZIP
+        M.unzip();
+#endif
+        int lerr = M.load();
+        if (lerr == -1){
+            cerr << "Error opening metadata file " << endl;
+            return -1;
+        }
+
+        // Record the converted tables, to resume the conversion if interrupted
+        IDA_SIARDcheckpoint K;
+        if (K.open(db, IDA_siard2sql_checkpoint_key(realsiard, schema_filter), IDA_siard2sql_resume)) {
+            cerr << "Warning: checkpoint journal cannot be written in the database" << endl;
+        } else {
+            if (K.is_resumed())
+                cerr << "Resuming load: " << K.get_ndone() << " tables already loaded" << endl;
+            M.set_checkpoint(&K);
+        }
+        if (!IDA_siard2sql_stats_file.empty()) M.set_stats(&stats);
+        int converr = M.tree_to_sqlite(db, schema_filter);
+        M.set_checkpoint(NULL);
+        if (!converr) K.finish();
+        if (!converr && M.get_failures()) {
+            cerr << "Error: " << M.get_failures() << " errors loading the tables, data may be missing" << endl;
+            converr = -1;
+        }
+        if (!IDA_siard2sql_stats_file.empty() && !M.write_stats(IDA_siard2sql_stats_file))
+            cerr << "Statistics saved to '" << IDA_siard2sql_stats_file << "'" << endl;
+
+        if (!converr && !cache_file.empty()) {
+            mkdir(IDA_siard2sql_db_cache_dir.c_str(), 0777);
+            if (!IDA_sqlite_snapshot_save(db, cache_file.c_str()))
+                cerr << "Database saved to cache '" << cache_file << "'" << endl;
+        }
+
+        puts("");
+        M.print_schemas(schema_filter);
+        puts("");
+
+        #ifdef __ivm64__
+        {
+        char *pbrk = (char*)sbrk(0);
+        char *pstk = (char*)&db;
+        long freeheap = pstk-pbrk;
+        cerr << "\nInfo: " << HUMANSIZE(freeheap) << HUMANPREFIX(freeheap) << "B" << " of free space over heap" << endl;
+        }
+        #endif
+
+        return converr ? -1 : 0;
+    }
+
+    // Virtual table module "siard": a SIARD table queried in place, without loading the
+    // siard file into the database, that is converted only when (and if) it is scanned
+    // (see IDA_SIARDvtab_cache), e.g.:
+    //   CREATE VIRTUAL TABLE payment USING siard('/path/sakila.siard', 'sakila', 'payment');
+    // The arguments are the siard file, and optionally the schema (by default, the first
+    // one with the table) and the table (by default, the name of the virtual table)
+    // The columns are declared from the catalog of the siard file. Comparisons (=, <, <=,
+    // >, >=) of the query are passed to the converted table, which can use its indexes
+
+    struct IDA_siard_vtab : sqlite3_vtab {
+        string siard, schema, table;
+        vector<string> columns;
+        long rows = 0;
+    };
+
+    struct IDA_siard_vtab_cursor : sqlite3_vtab_cursor {
+        string key;                  // Key of the database in IDA_SIARDvtab_cache (empty if none)
+        sqlite3 *db = NULL;          // Database with the converted table
+        sqlite3_stmt *stmt = NULL;   // Scan of the table
+        string idx;                  // Constraints of the scan (idxStr of xBestIndex)
+        bool eof = true;
+    };
+
+    // Quote an SQL identifier: name -> "name"
+    static string IDA_sqlite_quote_name(const string &name)
+    {
+        string q = "\"";
+        for (char c: name) {
+            q += c;
+            if (c == '"') q += c;
+        }
+        return q + "\"";
+    }
+
+    // Argument of CREATE VIRTUAL TABLE without the quotes ('...', "..." or [...])
+    static string IDA_siard_vtab_argument(const char *arg)
+    {
+        string a = IDA_parsing_utils::trim(arg);
+        if (a.size() >= 2 && (a[0] == '\'' || a[0] == '"' || a[0] == '[')) {
+            char close = (a[0] == '[') ? ']' : a[0];
+            if (a.back() == close) {
+                string u;
+                for (unsigned long k = 1; k < a.size() - 1; k++) {
+                    u += a[k];
+                    if (a[k] == close && k + 1 < a.size() - 1 && a[k+1] == close) k++;
+                }
+                return u;
+            }
+        }
+        return a;
+    }
+
+    // Catalog of a siard file, shared by its virtual tables: it is taken from the catalog
+    // cache if enabled and valid (see IDA_siard2sql_set_catalog()), or built by parsing
+    // header/metadata.xml (then it is saved to the cache)
+    static shared_ptr<IDA_SIARDcatalog> IDA_siard_vtab_catalog(const string &realsiard)
+    {
+        static map<string, shared_ptr<IDA_SIARDcatalog>> catalogs;
+    #ifdef IDA_THREADS
+        static std::mutex catalogs_mutex;
+        std::lock_guard<std::mutex> lock(catalogs_mutex);
+    #endif
+        shared_ptr<IDA_SIARDcatalog> C = make_shared<IDA_SIARDcatalog>();
+        bool keyed = !IDA_file_utils::is_directory(realsiard) && !C->set_key(realsiard);
+        auto it = catalogs.find(realsiard);
+        if (it != catalogs.end() && (!keyed || !memcmp(&it->second->key, &C->key, sizeof(C->key)))) {
+            return it->second;
+        }
+
+        string catalog_file;
+        if (keyed && IDA_siard2sql_catalog) {
+            catalog_file = IDA_SIARDcatalog::cache_file(realsiard, IDA_siard2sql_catalog_dir);
+            if (!C->load(catalog_file)) {
+                catalogs[realsiard] = C;
+                return C;
+            }
+        }
+
+        IDA_SIARDmetadata M(realsiard);
+        if (M.load() == -1) {
+            cerr << "Error opening metadata file of '" << realsiard << "'" << endl;
+            return NULL;
+        }
+        IDA_SIARDcatalog_header key = C->key;
+        *C = M.get_catalog();
+        C->key = key;
+        if (!catalog_file.empty()) {
+            if (!IDA_siard2sql_catalog_dir.empty()) mkdir(IDA_siard2sql_catalog_dir.c_str(), 0777);
+            C->save(catalog_file);
+        }
+        catalogs[realsiard] = C;
+        return C;
+    }
+
+    // xCreate/xConnect: CREATE VIRTUAL TABLE name USING siard(siard_file [, schema [, table]])
+    static int IDA_siard_vtab_connect(sqlite3 *db, void *aux, int argc, const char *const *argv,
+                                      sqlite3_vtab **ppvtab, char **errmsg)
+    {
+        (void) aux;
+        // argv[0] is the module, argv[1] the database, argv[2] the virtual table, and then the arguments
+        if (argc < 4 || argc > 6) {
+            *errmsg = sqlite3_mprintf("usage: CREATE VIRTUAL TABLE %s USING siard(siard_file [, schema [, table]])", argv[2]);
+            return SQLITE_ERROR;
+        }
+        string siard = IDA_siard_vtab_argument(argv[3]);
+        string schema = (argc > 4) ? IDA_siard_vtab_argument(argv[4]) : "";
+        string table = (argc > 5) ? IDA_siard_vtab_argument(argv[5]) : argv[2];
+
+        string realsiard = IDA_file_utils::get_realpath(siard);
+        if (realsiard.empty()) {
+            *errmsg = sqlite3_mprintf("File/directory '%s' not found", siard.c_str());
+            return SQLITE_ERROR;
+        }
+        shared_ptr<IDA_SIARDcatalog> C = IDA_siard_vtab_catalog(realsiard);
+        if (!C) {
+            *errmsg = sqlite3_mprintf("Cannot read the metadata of '%s'", siard.c_str());
+            return SQLITE_ERROR;
+        }
+
+        const IDA_SIARDcatalog_schema *S = NULL;
+        const IDA_SIARDcatalog_table *T = NULL;
+        for (auto &s: C->schemas) {
+            if (!schema.empty() && s.name != schema) continue;
+            for (auto &t: s.tables) {
+                if (t.name == table) {
+                    S = &s;
+                    T = &t;
+                    break;
+                }
+            }
+            if (T) break;
+        }
+        if (!T) {
+            *errmsg = sqlite3_mprintf("Table '%s' not found in '%s'", (schema.empty() ? table : schema + "." + table).c_str(), siard.c_str());
+            return SQLITE_ERROR;
+        }
+
+        string SQL_create_table = "CREATE TABLE x(";
+        for (unsigned long ic = 0; ic < T->columns.size(); ic++) {
+            enum IDA_siard_utils::SQLITE_COLTYPES coltype = IDA_siard_utils::siard_type_to_sqlite3(T->columns[ic].type);
+            SQL_create_table += (ic ? ", " : "") + IDA_sqlite_quote_name(T->columns[ic].name)
+                                + " " + IDA_parsing_utils::trim(IDA_siard_utils::coltype_to_str(coltype));
+        }
+        SQL_create_table += ");";
+        int rc = sqlite3_declare_vtab(db, SQL_create_table.c_str());
+        if (rc != SQLITE_OK) {
+            *errmsg = sqlite3_mprintf("%s", sqlite3_errmsg(db));
+            return rc;
+        }
+
+        IDA_siard_vtab *v = new IDA_siard_vtab();
+        v->siard = realsiard;
+        v->schema = S->name;
+        v->table = T->name;
+        for (auto &col: T->columns) v->columns.push_back(col.name);
+        v->rows = T->rows;
+        *ppvtab = v;
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_disconnect(sqlite3_vtab *pvtab)
+    {
+        delete static_cast<IDA_siard_vtab*>(pvtab);
+        return SQLITE_OK;
+    }
+
+    // The comparisons of a column (or the rowid, column -1) with a value passed to the scan
+    // are written in idxStr as "<column><operator> ..." (e.g., "0= 3> "), in the order of
+    // their values in xFilter
+    static int IDA_siard_vtab_best_index(sqlite3_vtab *pvtab, sqlite3_index_info *info)
+    {
+        IDA_siard_vtab *v = static_cast<IDA_siard_vtab*>(pvtab);
+        string idx;
+        int nargs = 0;
+        double rows = std::max(v->rows, 1L);
+        for (int i = 0; i < info->nConstraint; i++) {
+            const struct sqlite3_index_info::sqlite3_index_constraint &c = info->aConstraint[i];
+            const char *op = NULL;
+            switch (c.op) {
+                case SQLITE_INDEX_CONSTRAINT_EQ: op = "="; break;
+                case SQLITE_INDEX_CONSTRAINT_GT: op = ">"; break;
+                case SQLITE_INDEX_CONSTRAINT_GE: op = ">="; break;
+                case SQLITE_INDEX_CONSTRAINT_LT: op = "<"; break;
+                case SQLITE_INDEX_CONSTRAINT_LE: op = "<="; break;
+            }
+            // Only comparisons with the default collation give the same result in the table
+            const char *collation = sqlite3_vtab_collation(info, i);
+            if (!c.usable || !op || (collation && sqlite3_stricmp(collation, "BINARY"))) continue;
+            idx += to_string(c.iColumn) + op + " ";
+            info->aConstraintUsage[i].argvIndex = ++nargs;
+            // Values are checked again by sqlite (omit=0), so this is only an estimation
+            rows /= (c.op == SQLITE_INDEX_CONSTRAINT_EQ) ? 10 : 3;
+        }
+        info->idxStr = sqlite3_mprintf("%s", idx.c_str());
+        info->needToFreeIdxStr = 1;
+        info->estimatedRows = (sqlite3_int64) std::max(rows, 1.0);
+        info->estimatedCost = std::max(rows, 1.0);
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_open(sqlite3_vtab *pvtab, sqlite3_vtab_cursor **ppcursor)
+    {
+        (void) pvtab;
+        *ppcursor = new IDA_siard_vtab_cursor();
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_close(sqlite3_vtab_cursor *pcursor)
+    {
+        IDA_siard_vtab_cursor *c = static_cast<IDA_siard_vtab_cursor*>(pcursor);
+        sqlite3_finalize(c->stmt);
+        if (c->db) IDA_SIARDvtab_cache::instance().release(c->key);
+        delete c;
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_next(sqlite3_vtab_cursor *pcursor)
+    {
+        IDA_siard_vtab_cursor *c = static_cast<IDA_siard_vtab_cursor*>(pcursor);
+        int rc = sqlite3_step(c->stmt);
+        c->eof = (rc != SQLITE_ROW);
+        if (rc != SQLITE_ROW && rc != SQLITE_DONE) {
+            sqlite3_free(c->pVtab->zErrMsg);
+            c->pVtab->zErrMsg = sqlite3_mprintf("%s", sqlite3_errmsg(c->db));
+            return rc;
+        }
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_filter(sqlite3_vtab_cursor *pcursor, int idxnum, const char *idxstr,
+                                     int argc, sqlite3_value **argv)
+    {
+        (void) idxnum;
+        IDA_siard_vtab_cursor *c = static_cast<IDA_siard_vtab_cursor*>(pcursor);
+        IDA_siard_vtab *v = static_cast<IDA_siard_vtab*>(c->pVtab);
+        if (!c->db) {
+            c->db = IDA_SIARDvtab_cache::instance().acquire(v->siard, v->schema, v->table, c->key);
+            if (!c->db) {
+                sqlite3_free(v->zErrMsg);
+                v->zErrMsg = sqlite3_mprintf("Cannot convert table '%s.%s' of '%s'", v->schema.c_str(), v->table.c_str(), v->siard.c_str());
+                return SQLITE_ERROR;
+            }
+        }
+
+        string idx = idxstr ? idxstr : "";
+        if (!c->stmt || c->idx != idx) {
+            string sql = "SELECT rowid";
+            for (auto &col: v->columns) sql += ", " + IDA_sqlite_quote_name(col);
+            sql += " FROM " + IDA_sqlite_quote_name(v->table);
+            istringstream constraints(idx);
+            string cons;
+            for (int n = 1; constraints >> cons; n++) {
+                char *op = NULL;
+                long ic = strtol(cons.c_str(), &op, 10);
+                sql += (n == 1) ? " WHERE " : " AND ";
+                sql += (ic < 0 || ic >= (long) v->columns.size()) ? string("rowid") : IDA_sqlite_quote_name(v->columns[ic]);
+                sql += string(op) + " ?" + to_string(n);
+            }
+            sql += ";";
+            sqlite3_finalize(c->stmt);
+            c->stmt = NULL;
+            if (sqlite3_prepare_v2(c->db, sql.c_str(), -1, &c->stmt, NULL) != SQLITE_OK) {
+                sqlite3_free(v->zErrMsg);
+                v->zErrMsg = sqlite3_mprintf("%s", sqlite3_errmsg(c->db));
+                return SQLITE_ERROR;
+            }
+            c->idx = idx;
+        } else {
+            sqlite3_reset(c->stmt);
+        }
+        for (int i = 0; i < argc; i++) sqlite3_bind_value(c->stmt, i + 1, argv[i]);
+        return IDA_siard_vtab_next(pcursor);
+    }
+
+    static int IDA_siard_vtab_eof(sqlite3_vtab_cursor *pcursor)
+    {
+        return static_cast<IDA_siard_vtab_cursor*>(pcursor)->eof;
+    }
+
+    static int IDA_siard_vtab_column(sqlite3_vtab_cursor *pcursor, sqlite3_context *ctx, int i)
+    {
+        IDA_siard_vtab_cursor *c = static_cast<IDA_siard_vtab_cursor*>(pcursor);
+        sqlite3_result_value(ctx, sqlite3_column_value(c->stmt, i + 1));
+        return SQLITE_OK;
+    }
+
+    static int IDA_siard_vtab_rowid(sqlite3_vtab_cursor *pcursor, sqlite3_int64 *rowid)
+    {
+        *rowid = sqlite3_column_int64(static_cast<IDA_siard_vtab_cursor*>(pcursor)->stmt, 0);
+        return SQLITE_OK;
+    }
+
+    static sqlite3_module IDA_siard_vtab_module = {
+        0,                           // iVersion
+        IDA_siard_vtab_connect,      // xCreate
+        IDA_siard_vtab_connect,      // xConnect
+        IDA_siard_vtab_best_index,   // xBestIndex
+        IDA_siard_vtab_disconnect,   // xDisconnect
+        IDA_siard_vtab_disconnect,   // xDestroy
+        IDA_siard_vtab_open,         // xOpen
+        IDA_siard_vtab_close,        // xClose
+        IDA_siard_vtab_filter,       // xFilter
+        IDA_siard_vtab_next,         // xNext
+        IDA_siard_vtab_eof,          // xEof
+        IDA_siard_vtab_column,       // xColumn
+        IDA_siard_vtab_rowid,        // xRowid
+        0,                           // xUpdate (read only)
+        0,                           // xBegin
+        0,                           // xSync
+        0,                           // xCommit
+        0,                           // xRollback
+        0,                           // xFindFunction
+        0,                           // xRename
+        0,                           // xSavepoint
+        0,                           // xRelease
+        0,                           // xRollbackTo
+        0                            // xShadowName
+    };
+
+    // Register the virtual table module "siard" in the database 'db'
+    // Its signature is that of an extension entry point, so that it can be registered
+    // in every database opened with sqlite3_auto_extension()
+    int IDA_siard_vtab_init(sqlite3 *db, char **errmsg, const struct sqlite3_api_routines *api)
+    {
+        (void) errmsg;
+        (void) api;
+        return sqlite3_create_module(db, "siard", &IDA_siard_vtab_module, NULL);
+    }
+
+    // Set the maximum bytes of the tables converted by the virtual tables "siard" kept in
+    // memory for the next queries (256 MB by default); the least recently used are discarded
+    void IDA_siard_vtab_set_cache_size(unsigned long long bytes)
+    {
+        IDA_SIARDvtab_cache::instance().set_limit(bytes);
+    }
+
+    // Create in 'db' a virtual table "siard" for each table of the schemas of a siard file
+    // matching the regex 'schema_filter' (like IDA_siard2sqlite_db(), only the first table
+    // of each name is used), so the siard can be queried without loading it: each table is
+    // converted when scanned for the first time
+    // Return 0 if OK, -1 if error
+    int IDA_siard2sqlite_vtab(const char *siardfilein, sqlite3 *db, const char *schema_filter)
+    {
+        string realsiard = IDA_file_utils::get_realpath(siardfilein);
+        if (realsiard.empty()){
+            fprintf(stderr, "File/directory '%s' not found\n", siardfilein);
+            return -1;
+        }
+
+        if (!db){
+            fprintf(stderr, "No sqlite3 database to attach '%s' to\n", siardfilein);
+            return -1;
+        }
+
+        // If schema_filter is NULL, no filter is applied
+        if (!schema_filter){
+            schema_filter = "";
+        }
+
+        if (!IDA_parsing_utils::is_valid_regex(schema_filter)){
+            fprintf(stderr, "Schema filter '%s' is not a valid regexp expression\n", schema_filter);
+            return -1;
+        }
+
+        shared_ptr<IDA_SIARDcatalog> C = IDA_siard_vtab_catalog(realsiard);
+        if (!C) return -1;
+        if (IDA_siard_vtab_init(db, NULL, NULL) != SQLITE_OK) {
+            cerr << "Error registering the module 'siard': " << sqlite3_errmsg(db) << endl;
+            return -1;
+        }
+
+        regex schema_re(schema_filter, std::regex_constants::icase);
+        set<string> seen_tables;
+        int rc = 0;
+        for (auto &S: C->schemas) {
+            if (*schema_filter && !regex_search(S.name, schema_re)) continue;
+            for (auto &T: S.tables) {
+                if (!seen_tables.insert(T.name).second) {
+                    cerr << "Warning: skipped table '" << T.name << "' in schema '" << S.name << "' (repeated name)" << endl;
+                    continue;
+                }
+                char *sql = sqlite3_mprintf("CREATE VIRTUAL TABLE \"%w\" USING siard(%Q, %Q, %Q);",
+                                            T.name.c_str(), realsiard.c_str(), S.name.c_str(), T.name.c_str());
+                char *errmsg = NULL;
+                if (sqlite3_exec(db, sql, NULL, NULL, &errmsg) != SQLITE_OK) {
+                    cerr << "Error creating virtual table '" << T.name << "': " << (errmsg ? errmsg : "") << endl;
+                    rc = -1;
+                }
+                sqlite3_free(errmsg);
+                sqlite3_free(sql);
+            }
+        }
+
+        puts("");
+        C->print_schemas(schema_filter);
+        puts("");
+        return rc;
     }
 
 #ifdef __cplusplus
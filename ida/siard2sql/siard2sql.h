@@ -17,18 +17,56 @@
 extern "C" {
 #endif
 
+    struct sqlite3; // see sqlite3.h
+    struct sqlite3_api_routines;
+
     #define HUMANSIZE(x) (round(100*((double)(((x)>1e12)?((x)/1.0e12):((x)>1e9)?((x)/1.0e9):((x)>1.0e6)?((x)/1.0e6):((x)>1e3)?((x)/1.0e3):(x))))/100)
     #define HUMANPREFIX(x)  (((x)>1e12)?"T":((x)>1e9)?"G":((x)>1e6)?"M":((x)>1e3)?"K":"")
 
     // libsiardunzip
     int IDA_unzip(const char* siardfile, char *filename);
     int IDA_unzip_siard_full(const char *siardfile);
+    int IDA_unzip_parallel(const char *siardfile, int njobs);
     int IDA_unzip_siard_metadata(const char* siardfile);
     void IDA_unzip_close_all();
+    void *IDA_unzip_open_entry(const char *siardfile, const char *filename);
+    long IDA_unzip_read_entry(void *entry, char *buf, long n);
+    int IDA_unzip_close_entry(void *entry);
+    long IDA_unzip_entry_to_callback(const char *siardfile, const char *filename,
+                                     int (*fn)(void *ctx, const char *buf, long n), void *ctx);
+    long IDA_unzip_entry_to_buffer(const char *siardfile, const char *filename, char *buf, long size);
+    int IDA_unzip_entry_range(const char *siardfile, const char *filename,
+                              unsigned long long *offset, unsigned long long *size);
+    int IDA_unzip_entry_info(const char *siardfile, const char *filename, unsigned long *crc, unsigned long long *size);
+    void IDA_unzip_set_persistent_index(int enable);
+    int IDA_unzip_digest(const char *siardfile, char *digest, int n);
+
+    // libsiardhex
+    unsigned long IDA_hex_encode(const unsigned char *in, unsigned long n, char *out);
+    const char *IDA_hex_encode_kernel(void);
+    int IDA_hex_encode_select(const char *kernel);
+    unsigned long IDA_find_byte2(const char *p, unsigned long n, char c1, char c2);
 
     // libsiardxml
     char *IDA_get_siard_version_from_dir(const char *path_to_siard, char *buff, long size);
     int IDA_siard2sql(const char *siardfilein, const char* sqlfileout, const char *schema_filter);
+    int IDA_siard2sqlite_db(const char *siardfilein, struct sqlite3 *db, const char *schema_filter);
+    void IDA_siard2sql_set_jobs(int njobs);
+    void IDA_siard2sql_set_pipeline(int pipelined);
+    void IDA_siard2sql_set_bulk(int enable, long batch_rows, long commit_rows);
+    void IDA_siard2sql_set_catalog(int enable, const char *cachedir);
+    void IDA_siard2sql_set_resume(int resume);
+    void IDA_siard2sql_set_db_cache(const char *cachedir);
+    int IDA_siard2sql_set_projection(const char *spec);
+    void IDA_siard2sql_set_projection_sql(const char *sql);
+    int IDA_siard2sql_set_table_filter(const char *filter);
+    void IDA_siard2sql_set_rows(long limit, long every);
+    void IDA_siard2sql_set_stats(const char *jsonfile);
+    int IDA_sqlite_snapshot_save(struct sqlite3 *db, const char *file);
+    int IDA_sqlite_snapshot_restore(struct sqlite3 *db, const char *file);
+    int IDA_siard_vtab_init(struct sqlite3 *db, char **errmsg, const struct sqlite3_api_routines *api);
+    void IDA_siard_vtab_set_cache_size(unsigned long long bytes);
+    int IDA_siard2sqlite_vtab(const char *siardfilein, struct sqlite3 *db, const char *schema_filter);
 
 #ifdef __cplusplus
 }
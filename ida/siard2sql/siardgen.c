@@ -0,0 +1,712 @@
+/*
+    siardgen - A generator of synthetic SIARD archives
+    for scale testing of siard2sql
+
+    Immortal Database Access (iDA) EUROSTARS project
+
+    Eladio Gutierrez, Sergio Romero, Oscar Plata
+    University of Malaga, Spain
+*/
+
+// Writes a SIARD 2.1 archive (zip) with a configurable number of schemas,
+// tables, rows and columns, whose column types are taken from a type mix
+// (simple types, CLOB/BLOB columns whose contents are stored in lob
+// folders, arrays and user-defined types). The contents only depend on the
+// options and the seed, so the same command always produces the same archive
+// (zip entries have a fixed date).
+//
+// Type mix letters (the mix is cycled along the columns after the 'id'
+// primary key, that is always INTEGER):
+//   i INTEGER      n DECIMAL(12,2)    f DOUBLE PRECISION    b BOOLEAN
+//   v VARCHAR(64)  d DATE             t TIMESTAMP
+//   C CLOB         B BLOB             (external files, or inline if small)
+//   a ARRAY(4) of VARCHAR(16)         u UDT (street, city, zip)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <time.h>
+#include <unistd.h>
+#include <zip.h>
+
+//------------------------------------------------------------------
+
+// Options of the generator
+typedef struct {
+    int schemas;
+    int tables;
+    long rows;
+    int columns;
+    const char *mix;
+    long lob_size;        // Mean size of a LOB (actual size is in [size/2, 3*size/2])
+    long lob_inline;      // LOBs up to this size are written inline in the table
+    int level;            // Deflate level of the table and header entries (0 = stored)
+    int lob_level;        // Deflate level of the LOB entries (0 = stored)
+    int special;          // Percentage of text values with special chars
+    int nulls;            // Percentage of NULL values (nullable columns)
+    unsigned long long target; // Target size of the contents (rows are ignored if not 0)
+    uint64_t seed;
+} siardgen_opts;
+
+// Statistics of a generated table
+typedef struct {
+    long rows;
+    long lobs;
+    unsigned long long bytes; // Uncompressed bytes (table xml + lobs)
+} siardgen_table;
+
+// Zip entry writer with an output buffer
+typedef struct {
+    zipFile zf;
+    char *buf;
+    size_t n, cap;
+    unsigned long long total;
+    int failed;
+} siardgen_out;
+
+#define SIARDGEN_FLUSH (1 << 20)
+
+static const char *words[] = {
+    "alpha", "bravo", "charlie", "delta", "echo", "foxtrot", "golf", "hotel",
+    "india", "juliett", "kilo", "lima", "mike", "november", "oscar", "papa",
+    "quebec", "romeo", "sierra", "tango", "uniform", "victor", "whiskey", "xray",
+    "yankee", "zulu", "archive", "record", "table", "value", "immortal", "data"
+};
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+// Special chars of SIARD texts: xml entities, multibyte utf-8 and
+// chars escaped as \u00XX (control chars, backslash, multiple spaces)
+static const char *specials[] = {
+    "&amp;", "&lt;", "&gt;", "&quot;", "'", "\xc3\xa1", "\xc3\xb1", "\xe2\x82\xac",
+    "\xe6\xbc\xa2", "\\u005c", "\\u0001", "\\u001f", "\\u0020\\u0020", "\\u0000"
+};
+#define NSPECIALS (sizeof(specials) / sizeof(specials[0]))
+
+//------------------------------------------------------------------
+
+// splitmix64: small, fast and the same sequence on every platform
+static uint64_t rnd_next(uint64_t *s)
+{
+    uint64_t z = (*s += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static long rnd_range(uint64_t *s, long lo, long hi)
+{
+    return lo + (long) (rnd_next(s) % (uint64_t) (hi - lo + 1));
+}
+
+static int rnd_pct(uint64_t *s, int pct)
+{
+    return pct > 0 && (int) (rnd_next(s) % 100) < pct;
+}
+
+//------------------------------------------------------------------
+
+// Open a new entry in the zip; level 0 stores it
+static int out_open(siardgen_out *o, const char *name, int level)
+{
+    zip_fileinfo zi;
+    memset(&zi, 0, sizeof(zi));
+    zi.tmz_date.tm_year = 2024; // Fixed date, for reproducible archives
+    zi.tmz_date.tm_mon = 0;
+    zi.tmz_date.tm_mday = 1;
+    o->n = 0;
+    int err = zipOpenNewFileInZip3_64(o->zf, name, &zi, NULL, 0, NULL, 0, NULL,
+                                      level ? Z_DEFLATED : 0, level, 0,
+                                      -MAX_WBITS, DEF_MEM_LEVEL, Z_DEFAULT_STRATEGY,
+                                      NULL, 0, 1);
+    if (err != ZIP_OK) {
+        fprintf(stderr, "Cannot add '%s' to the archive (error %d)\n", name, err);
+        o->failed = 1;
+    }
+    return err == ZIP_OK;
+}
+
+static void out_flush(siardgen_out *o)
+{
+    if (o->n && !o->failed) {
+        if (zipWriteInFileInZip(o->zf, o->buf, (unsigned) o->n) != ZIP_OK) {
+            fprintf(stderr, "Error writing the archive\n");
+            o->failed = 1;
+        }
+    }
+    o->total += o->n;
+    o->n = 0;
+}
+
+static void out_close(siardgen_out *o)
+{
+    out_flush(o);
+    if (!o->failed) zipCloseFileInZip(o->zf);
+}
+
+// Directory entry
+static void out_dir(siardgen_out *o, const char *name)
+{
+    if (out_open(o, name, 0)) out_close(o);
+}
+
+static void out_write(siardgen_out *o, const void *s, size_t len)
+{
+    if (o->n + len > o->cap) {
+        out_flush(o);
+        if (len > o->cap) {
+            if (!o->failed && zipWriteInFileInZip(o->zf, s, (unsigned) len) != ZIP_OK) o->failed = 1;
+            o->total += len;
+            return;
+        }
+    }
+    memcpy(o->buf + o->n, s, len);
+    o->n += len;
+}
+
+static void out_puts(siardgen_out *o, const char *s)
+{
+    out_write(o, s, strlen(s));
+}
+
+static void out_printf(siardgen_out *o, const char *fmt, ...)
+{
+    char tmp[1024];
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+    va_end(ap);
+    if (n > 0) out_write(o, tmp, (size_t) n < sizeof(tmp) ? (size_t) n : sizeof(tmp) - 1);
+}
+
+//------------------------------------------------------------------
+
+static const char *mix_type(char c)
+{
+    switch (c) {
+        case 'i': return "INTEGER";
+        case 'n': return "DECIMAL(12,2)";
+        case 'f': return "DOUBLE PRECISION";
+        case 'b': return "BOOLEAN";
+        case 'v': return "VARCHAR(64)";
+        case 'd': return "DATE";
+        case 't': return "TIMESTAMP";
+        case 'C': return "CLOB";
+        case 'B': return "BLOB";
+        case 'a': return "VARCHAR(16)"; // Type of the array elements
+        default:  return NULL;
+    }
+}
+
+static const char *mix_xsd(char c)
+{
+    switch (c) {
+        case 'i': return "xs:integer";
+        case 'n': return "xs:decimal";
+        case 'f': return "xs:double";
+        case 'b': return "xs:boolean";
+        case 'd': return "dateType";
+        case 't': return "dateTimeType";
+        case 'C': return "clobType";
+        case 'B': return "blobType";
+        default:  return "xs:string";
+    }
+}
+
+// Type letter of column ic (0 is the primary key)
+static char column_type(const siardgen_opts *opt, int ic)
+{
+    return ic ? opt->mix[(ic - 1) % strlen(opt->mix)] : 'i';
+}
+
+// Random words (up to maxlen bytes), with a special char when requested
+static void gen_text(siardgen_out *o, uint64_t *r, int maxlen, int special)
+{
+    int len = 0, nw = (int) rnd_range(r, 1, 6);
+    int sp = special ? (int) rnd_range(r, 0, nw - 1) : -1;
+    for (int i = 0; i < nw; i++) {
+        const char *w = words[rnd_next(r) % NWORDS];
+        int wl = (int) strlen(w);
+        if (len + wl + 1 > maxlen - 2) break;
+        if (len) { out_write(o, " ", 1); len++; }
+        out_write(o, w, wl);
+        len += wl;
+        if (i == sp) {
+            out_puts(o, specials[rnd_next(r) % NSPECIALS]);
+            len += 2;
+        }
+    }
+}
+
+// Contents of a LOB: words for CLOBs, random bytes for BLOBs
+static void gen_lob(siardgen_out *o, uint64_t *r, char type, long size, int hex)
+{
+    static const char hexdigits[] = "0123456789ABCDEF";
+    char chunk[4096];
+    long done = 0;
+    while (done < size) {
+        long n = size - done;
+        if (n > (long) sizeof(chunk) / 2) n = sizeof(chunk) / 2;
+        if (type == 'C') {
+            for (long k = 0; k < n; ) {
+                const char *w = words[rnd_next(r) % NWORDS];
+                while (*w && k < n) chunk[k++] = *w++;
+                if (k < n) chunk[k++] = ' ';
+            }
+            out_write(o, chunk, n);
+        } else if (hex) {
+            for (long k = 0; k < n; k++) {
+                uint8_t b = (uint8_t) rnd_next(r);
+                chunk[2 * k] = hexdigits[b >> 4];
+                chunk[2 * k + 1] = hexdigits[b & 15];
+            }
+            out_write(o, chunk, 2 * n);
+        } else {
+            for (long k = 0; k < n; k += 8) {
+                uint64_t v = rnd_next(r);
+                memcpy(chunk + k, &v, n - k < 8 ? n - k : 8);
+            }
+            out_write(o, chunk, n);
+        }
+        done += n;
+    }
+}
+
+
+// Random value k of the cell (row, col) of a table; LOB cells use it instead
+// of the row sequence, so that their files can be generated again after the
+// table entry is closed (minizip writes one entry at a time)
+static uint64_t cell_random(uint64_t tseed, long row, int col, int k)
+{
+    uint64_t s = tseed ^ ((uint64_t) row * 0xd1342543de82ef95ULL) ^ ((uint64_t) col << 40) ^ (uint64_t) k;
+    return rnd_next(&s);
+}
+
+// Size of a LOB cell, or -1 if NULL
+static long lob_cell_size(const siardgen_opts *opt, uint64_t tseed, long row, int col)
+{
+    if (opt->nulls > 0 && (int) (cell_random(tseed, row, col, 0) % 100) < opt->nulls) return -1;
+    if (opt->lob_size <= 1) return opt->lob_size;
+    return opt->lob_size / 2 + (long) (cell_random(tseed, row, col, 1) % (uint64_t) (opt->lob_size + 1));
+}
+
+// Seed of table <it> of schema <is>
+static uint64_t table_seed(const siardgen_opts *opt, int is, int it)
+{
+    return opt->seed ^ (((uint64_t) is << 32 | (uint64_t) it) * 0x2545f4914f6cdd1dULL);
+}
+
+//------------------------------------------------------------------
+
+// Write content/schema<is>/table<it>/table<it>.xml
+static int gen_table(siardgen_out *o, const siardgen_opts *opt, int is, int it, siardgen_table *st)
+{
+    char name[256];
+    uint64_t tseed = table_seed(opt, is, it);
+    uint64_t r = tseed;
+
+    memset(st, 0, sizeof(*st));
+    snprintf(name, sizeof(name), "content/schema%d/table%d/table%d.xml", is, it, it);
+    if (!out_open(o, name, opt->level)) return 0;
+    unsigned long long total0 = o->total;
+    out_printf(o, "<?xml version='1.0' encoding='UTF-8'?>\n"
+                  "<table xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd\" "
+                  "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
+                  "xsi:schemaLocation=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd table%d.xsd\" "
+                  "version=\"2.1\">\n", it);
+
+    // With a target size, rows are added until the share of this table is reached
+    unsigned long long budget = opt->target / ((unsigned long long) opt->schemas * opt->tables);
+    unsigned long long lob_bytes = 0;
+    for (long row = 0; ; row++) {
+        if (opt->target) {
+            if (row && lob_bytes + (o->total + o->n - total0) >= budget) break;
+        } else if (row >= opt->rows) break;
+
+        out_puts(o, "<row>");
+        for (int ic = 0; ic < opt->columns; ic++) {
+            char c = column_type(opt, ic);
+            int col = ic + 1;
+            if (c == 'C' || c == 'B') {
+                long size = lob_cell_size(opt, tseed, row, col);
+                if (size < 0) continue;
+                if (size <= opt->lob_inline) {
+                    // Inline: text for CLOBs, hex digits for BLOBs
+                    uint64_t lr = cell_random(tseed, row, col, 2);
+                    out_printf(o, "<c%d>", col);
+                    gen_lob(o, &lr, c, size, 1);
+                    out_printf(o, "</c%d>", col);
+                } else {
+                    out_printf(o, "<c%d file=\"content/schema%d/table%d/lob%d/record%ld.%s\" length=\"%ld\"/>",
+                               col, is, it, col, row, c == 'C' ? "txt" : "bin", size);
+                    lob_bytes += size;
+                    st->lobs++;
+                }
+                continue;
+            }
+            if (ic && rnd_pct(&r, opt->nulls)) continue; // NULL: the element is omitted
+            switch (c) {
+                case 'i':
+                    out_printf(o, "<c%d>%ld</c%d>", col, ic ? rnd_range(&r, -1000000, 1000000) : row + 1, col);
+                    break;
+                case 'n':
+                    out_printf(o, "<c%d>%ld.%02ld</c%d>", col, rnd_range(&r, 0, 9999999), rnd_range(&r, 0, 99), col);
+                    break;
+                case 'f':
+                    out_printf(o, "<c%d>%.6g</c%d>", col, (double) rnd_range(&r, -1000000, 1000000) / 7.0, col);
+                    break;
+                case 'b':
+                    out_printf(o, "<c%d>%s</c%d>", col, rnd_next(&r) & 1 ? "true" : "false", col);
+                    break;
+                case 'd':
+                    out_printf(o, "<c%d>%04ld-%02ld-%02ldZ</c%d>", col, rnd_range(&r, 1950, 2030),
+                               rnd_range(&r, 1, 12), rnd_range(&r, 1, 28), col);
+                    break;
+                case 't':
+                    out_printf(o, "<c%d>%04ld-%02ld-%02ldT%02ld:%02ld:%02ldZ</c%d>", col, rnd_range(&r, 1950, 2030),
+                               rnd_range(&r, 1, 12), rnd_range(&r, 1, 28), rnd_range(&r, 0, 23),
+                               rnd_range(&r, 0, 59), rnd_range(&r, 0, 59), col);
+                    break;
+                case 'v':
+                    out_printf(o, "<c%d>", col);
+                    gen_text(o, &r, 64, rnd_pct(&r, opt->special));
+                    out_printf(o, "</c%d>", col);
+                    break;
+                case 'a':
+                    out_printf(o, "<c%d>", col);
+                    for (int k = 1; k <= 4; k++) {
+                        out_printf(o, "<a%d>", k);
+                        gen_text(o, &r, 16, rnd_pct(&r, opt->special));
+                        out_printf(o, "</a%d>", k);
+                    }
+                    out_printf(o, "</c%d>", col);
+                    break;
+                case 'u':
+                    out_printf(o, "<c%d><u1>", col);
+                    gen_text(o, &r, 64, rnd_pct(&r, opt->special));
+                    out_puts(o, "</u1><u2>");
+                    gen_text(o, &r, 32, 0);
+                    out_printf(o, "</u2><u3>%ld</u3></c%d>", rnd_range(&r, 10000, 99999), col);
+                    break;
+            }
+        }
+        out_puts(o, "</row>\n");
+        st->rows++;
+    }
+    out_puts(o, "</table>\n");
+    out_close(o);
+    st->bytes = o->total - total0 + lob_bytes;
+    return !o->failed;
+}
+
+// Write the external LOB files of a table (content/schema<is>/table<it>/lob<col>/record<row>.*)
+static int gen_table_lobs(siardgen_out *o, const siardgen_opts *opt, int is, int it, const siardgen_table *st)
+{
+    char name[256];
+    uint64_t tseed = table_seed(opt, is, it);
+    if (!st->lobs) return 1;
+    for (int ic = 1; ic < opt->columns && !o->failed; ic++) {
+        char c = column_type(opt, ic);
+        int col = ic + 1;
+        if (c != 'C' && c != 'B') continue;
+        snprintf(name, sizeof(name), "content/schema%d/table%d/lob%d/", is, it, col);
+        out_dir(o, name);
+        for (long row = 0; row < st->rows && !o->failed; row++) {
+            long size = lob_cell_size(opt, tseed, row, col);
+            if (size < 0 || size <= opt->lob_inline) continue;
+            uint64_t lr = cell_random(tseed, row, col, 2);
+            snprintf(name, sizeof(name), "content/schema%d/table%d/lob%d/record%ld.%s",
+                     is, it, col, row, c == 'C' ? "txt" : "bin");
+            if (!out_open(o, name, opt->lob_level)) break;
+            gen_lob(o, &lr, c, size, 0);
+            out_close(o);
+        }
+    }
+    return !o->failed;
+}
+
+// Write content/schema<is>/table<it>/table<it>.xsd
+static void gen_table_xsd(siardgen_out *o, const siardgen_opts *opt, int is, int it)
+{
+    char name[256];
+    snprintf(name, sizeof(name), "content/schema%d/table%d/table%d.xsd", is, it, it);
+    if (!out_open(o, name, opt->level)) return;
+    out_puts(o, "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n"
+                "<xs:schema xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd\" "
+                "xmlns:xs=\"http://www.w3.org/2001/XMLSchema\" attributeFormDefault=\"unqualified\" "
+                "elementFormDefault=\"qualified\" targetNamespace=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd\" "
+                "version=\"2.1\">\n"
+                "  <xs:element name=\"table\">\n"
+                "    <xs:complexType>\n"
+                "      <xs:sequence>\n"
+                "        <xs:element maxOccurs=\"unbounded\" minOccurs=\"0\" name=\"row\" type=\"recordType\"/>\n"
+                "      </xs:sequence>\n"
+                "      <xs:attribute name=\"version\" type=\"versionType\" use=\"required\"/>\n"
+                "    </xs:complexType>\n"
+                "  </xs:element>\n"
+                "  <xs:complexType name=\"recordType\">\n"
+                "    <xs:sequence>\n");
+    for (int ic = 0; ic < opt->columns; ic++) {
+        char c = column_type(opt, ic);
+        const char *min = ic ? " minOccurs=\"0\"" : "";
+        if (c == 'a' || c == 'u') {
+            out_printf(o, "      <xs:element%s name=\"c%d\">\n"
+                          "        <xs:complexType>\n"
+                          "          <xs:sequence>\n", min, ic + 1);
+            for (int k = 1; k <= (c == 'a' ? 4 : 3); k++)
+                out_printf(o, "            <xs:element minOccurs=\"0\" name=\"%c%d\" type=\"%s\"/>\n",
+                           c, k, c == 'u' && k == 3 ? "xs:integer" : "xs:string");
+            out_puts(o, "          </xs:sequence>\n"
+                        "        </xs:complexType>\n"
+                        "      </xs:element>\n");
+        } else {
+            out_printf(o, "      <xs:element%s name=\"c%d\" type=\"%s\"/>\n", min, ic + 1, mix_xsd(c));
+        }
+    }
+    out_puts(o, "    </xs:sequence>\n"
+                "  </xs:complexType>\n"
+                "  <xs:complexType name=\"clobType\">\n"
+                "    <xs:simpleContent>\n"
+                "      <xs:extension base=\"xs:string\">\n"
+                "        <xs:attribute name=\"file\" type=\"xs:anyURI\"/>\n"
+                "        <xs:attribute name=\"length\" type=\"xs:integer\"/>\n"
+                "        <xs:attribute name=\"digestType\" type=\"xs:string\"/>\n"
+                "        <xs:attribute name=\"digest\" type=\"xs:string\"/>\n"
+                "      </xs:extension>\n"
+                "    </xs:simpleContent>\n"
+                "  </xs:complexType>\n"
+                "  <xs:complexType name=\"blobType\">\n"
+                "    <xs:simpleContent>\n"
+                "      <xs:extension base=\"xs:hexBinary\">\n"
+                "        <xs:attribute name=\"file\" type=\"xs:anyURI\"/>\n"
+                "        <xs:attribute name=\"length\" type=\"xs:integer\"/>\n"
+                "        <xs:attribute name=\"digestType\" type=\"xs:string\"/>\n"
+                "        <xs:attribute name=\"digest\" type=\"xs:string\"/>\n"
+                "      </xs:extension>\n"
+                "    </xs:simpleContent>\n"
+                "  </xs:complexType>\n"
+                "  <xs:simpleType name=\"dateType\">\n"
+                "    <xs:restriction base=\"xs:date\"/>\n"
+                "  </xs:simpleType>\n"
+                "  <xs:simpleType name=\"dateTimeType\">\n"
+                "    <xs:restriction base=\"xs:dateTime\"/>\n"
+                "  </xs:simpleType>\n"
+                "  <xs:simpleType name=\"versionType\">\n"
+                "    <xs:restriction base=\"xs:string\">\n"
+                "      <xs:enumeration value=\"2.1\"/>\n"
+                "    </xs:restriction>\n"
+                "  </xs:simpleType>\n"
+                "</xs:schema>\n");
+    out_close(o);
+}
+
+// Write header/metadata.xml, once the rows of all tables are known
+static void gen_metadata(siardgen_out *o, const siardgen_opts *opt, const siardgen_table *tables)
+{
+    char date[32];
+    time_t t = 1704067200; // 2024-01-01, for reproducible archives
+    strftime(date, sizeof(date), "%Y-%m-%dZ", gmtime(&t));
+
+    if (!out_open(o, "header/metadata.xml", opt->level)) return;
+    out_printf(o, "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+                  "<siardArchive xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd\" "
+                  "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" version=\"2.1\" "
+                  "xsi:schemaLocation=\"http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd metadata.xsd\">\n"
+                  "    <dbname>siardgen</dbname>\n"
+                  "    <dataOwner>(synthetic)</dataOwner>\n"
+                  "    <dataOriginTimespan>(synthetic)</dataOriginTimespan>\n"
+                  "    <producerApplication>siardgen (seed %llu, mix %s)</producerApplication>\n"
+                  "    <archivalDate>%s</archivalDate>\n"
+                  "    <schemas>\n", (unsigned long long) opt->seed, opt->mix, date);
+    for (int is = 0; is < opt->schemas; is++) {
+        out_printf(o, "        <schema>\n"
+                      "            <name>s%d</name>\n"
+                      "            <folder>schema%d</folder>\n", is, is);
+        if (strchr(opt->mix, 'u')) {
+            out_puts(o, "            <types>\n"
+                        "                <type>\n"
+                        "                    <name>address_t</name>\n"
+                        "                    <category>udt</category>\n"
+                        "                    <instantiable>true</instantiable>\n"
+                        "                    <final>true</final>\n"
+                        "                    <attributes>\n"
+                        "                        <attribute><name>street</name><type>VARCHAR(64)</type></attribute>\n"
+                        "                        <attribute><name>city</name><type>VARCHAR(32)</type></attribute>\n"
+                        "                        <attribute><name>zip</name><type>INTEGER</type></attribute>\n"
+                        "                    </attributes>\n"
+                        "                </type>\n"
+                        "            </types>\n");
+        }
+        out_puts(o, "            <tables>\n");
+        for (int it = 0; it < opt->tables; it++) {
+            out_printf(o, "                <table>\n"
+                          "                    <name>s%d_t%d</name>\n"
+                          "                    <folder>table%d</folder>\n"
+                          "                    <columns>\n", is, it, it);
+            for (int ic = 0; ic < opt->columns; ic++) {
+                char c = column_type(opt, ic);
+                out_puts(o, "                        <column>\n");
+                if (ic) out_printf(o, "                            <name>c%d</name>\n", ic + 1);
+                else out_puts(o, "                            <name>id</name>\n");
+                if (c == 'u') {
+                    out_printf(o, "                            <typeSchema>s%d</typeSchema>\n"
+                                  "                            <typeName>address_t</typeName>\n", is);
+                } else {
+                    out_printf(o, "                            <type>%s</type>\n", mix_type(c));
+                    if (c == 'a') out_puts(o, "                            <cardinality>4</cardinality>\n");
+                }
+                if (!ic) out_puts(o, "                            <nullable>false</nullable>\n");
+                out_puts(o, "                        </column>\n");
+            }
+            out_printf(o, "                    </columns>\n"
+                          "                    <primaryKey>\n"
+                          "                        <name>PRIMARY</name>\n"
+                          "                        <column>id</column>\n"
+                          "                    </primaryKey>\n"
+                          "                    <rows>%ld</rows>\n"
+                          "                </table>\n", tables[is * opt->tables + it].rows);
+        }
+        out_puts(o, "            </tables>\n"
+                    "        </schema>\n");
+    }
+    out_puts(o, "    </schemas>\n"
+                "    <users>\n"
+                "        <user>\n"
+                "            <name>siardgen</name>\n"
+                "        </user>\n"
+                "    </users>\n"
+                "</siardArchive>\n");
+    out_close(o);
+}
+
+//------------------------------------------------------------------
+
+// Parse a size with an optional K, M or G suffix
+static unsigned long long parse_size(const char *s)
+{
+    char *end;
+    double v = strtod(s, &end);
+    switch (*end) {
+        case 'k': case 'K': v *= 1024; break;
+        case 'm': case 'M': v *= 1024 * 1024; break;
+        case 'g': case 'G': v *= 1024.0 * 1024 * 1024; break;
+    }
+    return v > 0 ? (unsigned long long) v : 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "Usage: %s [options] out.siard\n", prog);
+    fprintf(stderr, "  -s N       schemas (default 1)\n");
+    fprintf(stderr, "  -t N       tables per schema (default 4)\n");
+    fprintf(stderr, "  -r N       rows per table (default 1000)\n");
+    fprintf(stderr, "  -g SIZE    generate rows until the contents reach SIZE bytes (K, M, G suffixes),\n");
+    fprintf(stderr, "             evenly split among the tables (overrides -r)\n");
+    fprintf(stderr, "  -c N       columns per table, including the 'id' primary key (default 8)\n");
+    fprintf(stderr, "  -m MIX     type mix cycled along the columns (default 'ivCndtfb'):\n");
+    fprintf(stderr, "             i INTEGER, n DECIMAL, f DOUBLE, b BOOLEAN, v VARCHAR, d DATE,\n");
+    fprintf(stderr, "             t TIMESTAMP, C CLOB, B BLOB, a ARRAY, u UDT\n");
+    fprintf(stderr, "  -L SIZE    mean size of LOBs (default 4K)\n");
+    fprintf(stderr, "  -i SIZE    LOBs up to SIZE bytes are inline in the table (default 0)\n");
+    fprintf(stderr, "  -z LEVEL   deflate level of the tables, 0 = stored entries (default 6)\n");
+    fprintf(stderr, "  -Z LEVEL   deflate level of the LOB files (default: as -z)\n");
+    fprintf(stderr, "  -x PCT     percentage of texts with special chars (default 5)\n");
+    fprintf(stderr, "  -n PCT     percentage of NULL values (default 2)\n");
+    fprintf(stderr, "  -S SEED    random seed (default 1)\n");
+}
+
+int main(int argc, char *argv[]) {
+    siardgen_opts opt = { 1, 4, 1000, 8, "ivCndtfb", 4096, 0, 6, -1, 5, 2, 0, 1 };
+    int c;
+
+    while ((c = getopt(argc, argv, "s:t:r:g:c:m:L:i:z:Z:x:n:S:h")) != -1) {
+        switch (c) {
+            case 's': opt.schemas = atoi(optarg); break;
+            case 't': opt.tables = atoi(optarg); break;
+            case 'r': opt.rows = atol(optarg); break;
+            case 'g': opt.target = parse_size(optarg); break;
+            case 'c': opt.columns = atoi(optarg); break;
+            case 'm': opt.mix = optarg; break;
+            case 'L': opt.lob_size = (long) parse_size(optarg); break;
+            case 'i': opt.lob_inline = (long) parse_size(optarg); break;
+            case 'z': opt.level = atoi(optarg); break;
+            case 'Z': opt.lob_level = atoi(optarg); break;
+            case 'x': opt.special = atoi(optarg); break;
+            case 'n': opt.nulls = atoi(optarg); break;
+            case 'S': opt.seed = strtoull(optarg, NULL, 10); break;
+            default: usage(argv[0]); return EXIT_FAILURE;
+        }
+    }
+    if (optind != argc - 1) {
+        usage(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (opt.lob_level < 0) opt.lob_level = opt.level;
+    if (opt.schemas < 1 || opt.tables < 1 || opt.columns < 1 || opt.rows < 0
+        || opt.level < 0 || opt.level > 9 || opt.lob_level > 9 || !*opt.mix) {
+        fprintf(stderr, "Invalid options\n");
+        return EXIT_FAILURE;
+    }
+    for (const char *m = opt.mix; *m; m++) {
+        if (*m != 'u' && !mix_type(*m)) {
+            fprintf(stderr, "Unknown type '%c' in the type mix\n", *m);
+            return EXIT_FAILURE;
+        }
+    }
+
+    const char *siardfile = argv[optind];
+    zipFile zf = zipOpen64(siardfile, APPEND_STATUS_CREATE);
+    if (!zf) {
+        fprintf(stderr, "Cannot create '%s'\n", siardfile);
+        return EXIT_FAILURE;
+    }
+    siardgen_out o = { zf, NULL, 0, SIARDGEN_FLUSH, 0, 0 };
+    siardgen_table *tables = calloc((size_t) opt.schemas * opt.tables, sizeof(siardgen_table));
+    o.buf = malloc(o.cap);
+    if (!o.buf || !tables) {
+        fprintf(stderr, "Out of memory\n");
+        zipClose(zf, NULL);
+        return EXIT_FAILURE;
+    }
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    long rows = 0, lobs = 0;
+    unsigned long long bytes = 0;
+    out_dir(&o, "header/");
+    out_dir(&o, "header/siardversion/");
+    out_dir(&o, "header/siardversion/2.1/");
+    out_dir(&o, "content/");
+    char name[256];
+    for (int is = 0; is < opt.schemas && !o.failed; is++) {
+        snprintf(name, sizeof(name), "content/schema%d/", is);
+        out_dir(&o, name);
+        for (int it = 0; it < opt.tables && !o.failed; it++) {
+            siardgen_table *st = &tables[is * opt.tables + it];
+            snprintf(name, sizeof(name), "content/schema%d/table%d/", is, it);
+            out_dir(&o, name);
+            gen_table(&o, &opt, is, it, st);
+            gen_table_xsd(&o, &opt, is, it);
+            gen_table_lobs(&o, &opt, is, it, st);
+            rows += st->rows;
+            lobs += st->lobs;
+            bytes += st->bytes;
+        }
+    }
+    gen_metadata(&o, &opt, tables);
+
+    int failed = o.failed;
+    if (zipClose(zf, NULL) != ZIP_OK) {
+        fprintf(stderr, "Error closing '%s'\n", siardfile);
+        failed = 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+    printf("%s: %d schemas, %d tables, %ld rows, %ld lob files, %.1f MB of contents in %.2f s\n",
+           siardfile, opt.schemas, opt.schemas * opt.tables, rows, lobs, bytes / 1048576.0, secs);
+
+    free(o.buf);
+    free(tables);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,121 @@
+// Test: lobs in a key column are inserted with their real content
+//
+// Two lobs of the same length but different content in a column of the
+// primary key (and of a candidate key) must not collide when loading into a
+// sqlite3 database: large lobs are inserted as zeroblob(length) and written
+// after the insert, unless they are in an index, where that placeholder would
+// collide with a previous lob of the same length made of zeros.
+//
+// Usage: test_lobkey [workdir]    (default workdir: /tmp)
+//
+// A siard directory is created in 'workdir' and converted to an in-memory
+// database; the exit status is 0 if both rows are loaded with their lobs.
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "siard2sql.h"
+#include "sqlite3.h"
+
+using namespace std;
+
+#define LOB_SIZE (2*1024*1024)  // Larger than the size of lobs streamed into the rows
+#define NLOBS 2
+
+static bool write_file(const string &path, const string &content)
+{
+    ofstream f(path.c_str(), ios::binary);
+    f << content;
+    return f.good();
+}
+
+// The first lob is all zeros, as the placeholder inserted for the others
+static string lob_content(int n)
+{
+    string s(LOB_SIZE, '\0');
+    for (unsigned long i = 0; n && i < s.size(); i++) s[i] = (char) ((i * (n + 1) + n) & 0xff);
+    return s;
+}
+
+static bool make_siard(const string &dir)
+{
+    string table = dir + "/content/schema0/table0";
+    const char *dirs[] = { "", "/header", "/content", "/content/schema0", "/content/schema0/table0",
+                           "/content/schema0/table0/lob2" };
+    for (auto d: dirs) mkdir((dir + d).c_str(), 0755);
+
+    string metadata =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<siardArchive xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/metadata.xsd\" version=\"2.1\">\n"
+        "  <dbname>test_lobkey</dbname>\n"
+        "  <schemas>\n"
+        "    <schema>\n"
+        "      <name>s0</name>\n"
+        "      <folder>schema0</folder>\n"
+        "      <tables>\n"
+        "        <table>\n"
+        "          <name>t0</name>\n"
+        "          <folder>table0</folder>\n"
+        "          <columns>\n"
+        "            <column><name>id</name><type>INTEGER</type></column>\n"
+        "            <column><name>data</name><type>BLOB</type></column>\n"
+        "          </columns>\n"
+        "          <primaryKey><name>PRIMARY</name><column>data</column></primaryKey>\n"
+        "          <candidateKeys>\n"
+        "            <candidateKey><name>ck_data</name><column>id</column><column>data</column></candidateKey>\n"
+        "          </candidateKeys>\n"
+        "          <rows>2</rows>\n"
+        "        </table>\n"
+        "      </tables>\n"
+        "    </schema>\n"
+        "  </schemas>\n"
+        "</siardArchive>\n";
+    if (!write_file(dir + "/header/metadata.xml", metadata)) return false;
+
+    string rows = "<?xml version='1.0' encoding='UTF-8'?>\n"
+                  "<table xmlns=\"http://www.bar.admin.ch/xmlns/siard/2/table.xsd\" version=\"2.1\">\n";
+    for (int n = 0; n < NLOBS; n++) {
+        string lob = "content/schema0/table0/lob2/record" + to_string(n) + ".bin";
+        if (!write_file(dir + "/" + lob, lob_content(n))) return false;
+        rows += "<row><c1>" + to_string(n + 1) + "</c1><c2 file=\"" + lob + "\" length=\""
+                + to_string(LOB_SIZE) + "\"/></row>\n";
+    }
+    rows += "</table>\n";
+    return write_file(table + "/table0.xml", rows);
+}
+
+int main(int argc, char *argv[])
+{
+    string dir = string(argc > 1 ? argv[1] : "/tmp") + "/test_lobkey." + to_string(getpid()) + ".siard";
+    if (!make_siard(dir)) {
+        cerr << "Error: cannot create '" << dir << "'" << endl;
+        return 1;
+    }
+
+    sqlite3 *db = NULL;
+    sqlite3_open(":memory:", &db);
+    int err = IDA_siard2sqlite_db(dir.c_str(), db, NULL);
+
+    int nok = 0;
+    sqlite3_stmt *stmt = NULL;
+    sqlite3_prepare_v2(db, "SELECT id, data FROM t0 ORDER BY id;", -1, &stmt, NULL);
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        int n = sqlite3_column_int(stmt, 0) - 1;
+        const char *p = (const char *) sqlite3_column_blob(stmt, 1);
+        string data(p ? p : "", sqlite3_column_bytes(stmt, 1));
+        if (data == lob_content(n)) nok++;
+        else cerr << "Error: wrong lob in row " << n + 1 << endl;
+    }
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    string rm = "rm -rf '" + dir + "'";
+    if (system(rm.c_str())) cerr << "Warning: cannot remove '" << dir << "'" << endl;
+
+    bool ok = !err && nok == NLOBS;
+    cout << (ok ? "OK" : "FAILED") << ": " << nok << " of " << NLOBS << " lobs in a key column loaded" << endl;
+    return ok ? 0 : 1;
+}
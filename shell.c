@@ -2575,14 +2575,149 @@ static int main_tree(int argc, char *argv[]) {
 }
 
 extern int IDA_siard2sql(const char*, const char*, const char*);
-static void help_siard(int argc, char *argv[]) {
-    printf("Usage: %s tosql <siard file>   sqlitefile.sql\n",argv[0]);
-    printf("       %s tosql <siard folder> sqlitefile.sql\n",argv[0]);
-    printf("       %s tosql <siard file>   sqlitefile.sql [schema regex filter]\n",argv[0]);
-    printf("       %s tosql <siard folder> sqlitefile.sql [schema regex filter]\n",argv[0]);
-    printf("       %s schemas <siard file or folder> \n",argv[0]);
-    printf("       %s schemas <siard file or folder> [schema regex filter]\n",argv[0]);
+extern void IDA_siard2sql_set_jobs(int njobs);
+extern void IDA_siard2sql_set_pipeline(int pipelined);
+extern void IDA_siard2sql_set_bulk(int enable, long batch_rows, long commit_rows);
+extern void IDA_siard2sql_set_catalog(int enable, const char *cachedir);
+extern void IDA_siard2sql_set_resume(int resume);
+extern int IDA_siard2sql_set_projection(const char *spec);
+extern void IDA_siard2sql_set_projection_sql(const char *sql);
+extern int IDA_siard2sql_set_table_filter(const char *filter);
+extern void IDA_siard2sql_set_rows(long limit, long every);
+extern void IDA_siard2sql_set_stats(const char *jsonfile);
+extern void IDA_unzip_set_persistent_index(int enable);
+// Environment variable with the default directory of the caches (converted databases
+// and catalogs of siard files)
+#define SIARD_DB_CACHE_ENV "SIARD_DB_CACHE"
+
+// Whether to resume an interrupted conversion (option --resume)
+static int siard_opt_resume = 0;
+// Rows converted of each table (options --limit and --sample)
+static long siard_opt_row_limit = 0, siard_opt_row_every = 1;
+// Rows per INSERT statement and per transaction in bulk-load mode (options -B and -T)
+static long siard_opt_batch_rows = 0, siard_opt_commit_rows = 0;
+static int set_projection_from_roae();
+
+// Parse one of the conversion options shared by "siard tosql" and "sqlite -- loadsiard"
+// starting at argv[*ia], and set it in the siard2sql library
+// Return 0 if the option was consumed (*ia points to the next argument),
+// 1 if it is not a conversion option, or -1 if it is wrong
+static int parse_siard_option(char *argv[], int *ia) {
+    char *o = argv[*ia];
+    if (!strcmp(o, "-j") && argv[*ia+1] && atoi(argv[*ia+1]) > 0) {
+        IDA_siard2sql_set_jobs(atoi(argv[*ia+1]));
+        *ia += 2;
+    } else if (!strcmp(o, "-p")) {
+        IDA_siard2sql_set_pipeline(1);
+        *ia += 1;
+    } else if (!strcmp(o, "-b")) {
+        IDA_siard2sql_set_bulk(1, siard_opt_batch_rows, siard_opt_commit_rows);
+        *ia += 1;
+    } else if (!strcmp(o, "-I")) {
+        IDA_unzip_set_persistent_index(1);
+        *ia += 1;
+    } else if (!strcmp(o, "-P") && argv[*ia+1]) {
+        if (IDA_siard2sql_set_projection(argv[*ia+1])) {
+            fprintf(stderr, "Wrong projection '%s'\n", argv[*ia+1]);
+            return -1;
+        }
+        *ia += 2;
+    } else if (!strcmp(o, "-R")) {
+        if (set_projection_from_roae()) return -1;
+        *ia += 1;
+    } else if (!strcmp(o, "--tables") && argv[*ia+1]) {
+        if (IDA_siard2sql_set_table_filter(argv[*ia+1])) return -1;
+        *ia += 2;
+    } else if (!strcmp(o, "--limit") && argv[*ia+1] && atol(argv[*ia+1]) >= 0) {
+        siard_opt_row_limit = atol(argv[*ia+1]);
+        IDA_siard2sql_set_rows(siard_opt_row_limit, siard_opt_row_every);
+        *ia += 2;
+    } else if (!strcmp(o, "--sample") && argv[*ia+1]) {
+        // "1/k" or "k": one row of every k rows
+        char *k = argv[*ia+1];
+        if (!strncmp(k, "1/", 2)) k += 2;
+        if (atol(k) <= 0) return -1;
+        siard_opt_row_every = atol(k);
+        IDA_siard2sql_set_rows(siard_opt_row_limit, siard_opt_row_every);
+        *ia += 2;
+    } else if (!strcmp(o, "--stats") && argv[*ia+1]) {
+        IDA_siard2sql_set_stats(argv[*ia+1]);
+        *ia += 2;
+    } else if (!strcmp(o, "--resume")) {
+        IDA_siard2sql_set_resume(1);
+        siard_opt_resume = 1;
+        *ia += 1;
+    } else if ((!strcmp(o, "-B") || !strcmp(o, "-T")) && argv[*ia+1] && atol(argv[*ia+1]) > 0) {
+        if (o[1] == 'B') siard_opt_batch_rows = atol(argv[*ia+1]);
+        else siard_opt_commit_rows = atol(argv[*ia+1]);
+        IDA_siard2sql_set_bulk(1, siard_opt_batch_rows, siard_opt_commit_rows); // Implies -b
+        *ia += 2;
+    } else if (o[0] == '-' && (!strcmp(o, "-j") || !strcmp(o, "-B") || !strcmp(o, "-T") || !strcmp(o, "-P")
+                           || !strcmp(o, "--tables") || !strcmp(o, "--limit") || !strcmp(o, "--sample")
+                           || !strcmp(o, "--stats"))) {
+        return -1;
+    } else {
+        return 1;
+    }
+    return 0;
 }
+
+// Restore the default conversion options after a conversion
+static void reset_siard_options() {
+    IDA_siard2sql_set_jobs(1);
+    IDA_siard2sql_set_pipeline(0);
+    IDA_siard2sql_set_bulk(0, 0, 0);
+    siard_opt_batch_rows = 0;
+    siard_opt_commit_rows = 0;
+    IDA_unzip_set_persistent_index(0);
+    IDA_siard2sql_set_resume(0);
+    siard_opt_resume = 0;
+    IDA_siard2sql_set_projection(NULL);
+    IDA_siard2sql_set_table_filter(NULL);
+    siard_opt_row_limit = 0;
+    siard_opt_row_every = 1;
+    IDA_siard2sql_set_rows(0, 1);
+    IDA_siard2sql_set_stats(NULL);
+}
+
+static void help_siard_options() {
+    printf("              # -j N: convert N tables in parallel (same output)\n");
+    printf("              # -p: inflate, parse and convert the rows of each table in a pipeline of threads\n");
+    printf("              # -b: bulk-load mode (transactions, journal and sync off, primary keys\n");
+    printf("              #     created as unique indexes after the data, multi-row INSERTs)\n");
+    printf("              # -B N: bulk-load mode with N rows per INSERT statement (default 100)\n");
+    printf("              # -T N: bulk-load mode with N rows per transaction (default: one per table)\n");
+    printf("              # -I: save the index of the siard zip to '<siard file>.zidx' and reuse it\n");
+    printf("              # -P \"table.column, table.*, table2, ...\": convert only these tables and\n");
+    printf("              #     columns (and the primary keys); other columns are not decoded\n");
+    printf("              # -R: like -P, with the tables and columns used by the SQL of the loaded roae file\n");
+    printf("              # --tables regex: convert only the tables whose names match this regex\n");
+    printf("              # --limit N: convert only the first N rows of each table\n");
+    printf("              # --sample 1/K: convert only one row of every K rows of each table\n");
+    printf("              #     (rows not converted are skipped without parsing them)\n");
+    printf("              # --stats file.json: save the rows, cells, bytes and unzip/parse/emit times\n");
+    printf("              #     of each table to this file, and print a summary\n");
+    printf("              # --resume: resume an interrupted conversion, skipping the tables already\n");
+    printf("              #     converted (recorded in '<sql file>.ckpt' or in the database)\n");
+}
+
+static void help_siard(int argc, char *argv[]) {
+    printf("Usage: %s tosql [options] <siard file>   sqlitefile.sql\n",argv[0]);
+    printf("       %s tosql [options] <siard folder> sqlitefile.sql\n",argv[0]);
+    printf("       %s tosql [options] <siard file>   sqlitefile.sql [schema regex filter]\n",argv[0]);
+    printf("       %s tosql [options] <siard folder> sqlitefile.sql [schema regex filter]\n",argv[0]);
+    printf("              options:\n");
+    help_siard_options();
+    printf("       %s preview [options] <siard file or folder> [schema regex filter]\n",argv[0]);
+    printf("              # load the first rows of every table into the sqlite3 database (that is\n");
+    printf("              # cleared) and print them; --limit 10 by default\n");
+    printf("       %s schemas [-n] [-C dir] <siard file or folder> \n",argv[0]);
+    printf("       %s schemas [-n] [-C dir] <siard file or folder> [schema regex filter]\n",argv[0]);
+    printf("              # -C dir: cache the summary of the siard file in this directory (by\n");
+    printf("              #   default in $%s, if defined; otherwise it is not cached)\n", SIARD_DB_CACHE_ENV);
+    printf("              # -n: do not use the catalog cache\n");
+}
+static int siard_preview(const char *siardarg, const char *filter);
 int main_siard(int argc, char *argv[]) {
     char *siardfile=NULL, *sqlfile=NULL;
 
@@ -2593,7 +2728,16 @@ int main_siard(int argc, char *argv[]) {
 
     const char *schema_filter = ""; 
     if (!strcmp(argv[1], "tosql")){
-        if (argc < 4) { help_siard(argc,argv); return -1;}
+        // Options before the siard file
+        int ia = 2;
+        while (ia < argc && argv[ia][0] == '-') {
+            if (parse_siard_option(argv, &ia)) {
+                reset_siard_options();
+                help_siard(argc,argv); return -1;
+            }
+        }
+        argv += ia - 2; argc -= ia - 2;
+        if (argc < 4) { reset_siard_options(); help_siard(argc,argv); return -1;}
         siardfile = argv[2];
         sqlfile = argv[3];
         if (argv[4]){
@@ -2601,14 +2745,53 @@ int main_siard(int argc, char *argv[]) {
         }
         // SIARD -> SQL
         IDA_siard2sql(siardfile, sqlfile, schema_filter);
+        reset_siard_options();
+    }
+    else if (!strcmp(argv[1], "preview")) {
+        siard_opt_row_limit = 10; // Default --limit
+        IDA_siard2sql_set_rows(siard_opt_row_limit, siard_opt_row_every);
+        int ia = 2;
+        while (ia < argc && argv[ia][0] == '-') {
+            if (parse_siard_option(argv, &ia)) {
+                reset_siard_options();
+                help_siard(argc,argv); return -1;
+            }
+        }
+        argv += ia - 2; argc -= ia - 2;
+        if (argc < 3) { reset_siard_options(); help_siard(argc,argv); return -1;}
+        siardfile = argv[2];
+        if (argv[3]){
+            schema_filter = argv[3];
+        }
+        int err = siard_preview(siardfile, schema_filter);
+        reset_siard_options();
+        if (err) return -1;
     }
     else if (!strcmp(argv[1], "schemas")) {
+        int catalog = 1;
+        const char *cachedir = getenv(SIARD_DB_CACHE_ENV);
+        int ia = 2;
+        while (ia < argc && argv[ia][0] == '-') {
+            if (!strcmp(argv[ia], "-n")) {
+                catalog = 0;
+                ia += 1;
+            } else if (!strcmp(argv[ia], "-C") && argv[ia+1]) {
+                cachedir = argv[ia+1];
+                ia += 2;
+            } else {
+                help_siard(argc,argv); return -1;
+            }
+        }
+        argv += ia - 2; argc -= ia - 2;
         if (argc < 3) { help_siard(argc,argv); return -1;}
         siardfile = argv[2];
         if (argv[3]){
             schema_filter = argv[3];
         }
+        // The catalog is only cached in a directory, never next to the siard file
+        IDA_siard2sql_set_catalog(catalog && cachedir && *cachedir, cachedir);
         IDA_siard2sql(siardfile, NULL, schema_filter);
+        IDA_siard2sql_set_catalog(0, NULL);
     }
     else {
         help_siard(argc, argv);
@@ -2619,11 +2802,19 @@ int main_siard(int argc, char *argv[]) {
 }
 
 extern int IDA_unzip(const char *zipfile, const char *onefile);
+extern int IDA_unzip_parallel(const char *zipfile, int njobs);
 int main_unzip(int argc, char *argv[]) {
-    if (argc < 2) {
-        fprintf(stderr, "Usage: %s file.zip\n", argv[0]);
+    int njobs = 1;
+    if (argc > 3 && !strcmp(argv[1], "-j") && atoi(argv[2]) > 0) {
+        njobs = atoi(argv[2]);
+        argv += 2; argc -= 2;
+    }
+    if (argc < 2 || argv[1][0] == '-') {
+        fprintf(stderr, "Usage: %s [-j N] file.zip\n", argv[0]);
+        fprintf(stderr, "       -j N: extract with N threads\n");
         return -1;
     }
+    if (njobs > 1) return IDA_unzip_parallel(argv[1], njobs);
     return IDA_unzip(argv[1], NULL);
 }
 
@@ -2637,6 +2828,20 @@ extern int IDA_SQLITE_shell_exec(char *cmd);
 extern int IDA_SQLITE_run(char *cmd);
 // Run an sequence of internal or SQL commands separated by "\n" (without blanks) 
 extern int IDA_SQLITE_run_sequence(char *cmd);
+// Get the handle of the database currently open in the sqlite shell
+struct sqlite3;
+extern struct sqlite3 *IDA_SQLITE_get_db();
+// Get the first column of the first row of a query as a string (free() it)
+extern char *IDA_SQLITE_query_text(const char *sql);
+// Convert siard directly into a sqlite3 database
+extern int IDA_siard2sqlite_db(const char*, struct sqlite3*, const char*);
+// Cache of converted databases, and snapshots of the current database
+extern void IDA_siard2sql_set_db_cache(const char *cachedir);
+extern int IDA_sqlite_snapshot_save(struct sqlite3 *db, const char *file);
+extern int IDA_sqlite_snapshot_restore(struct sqlite3 *db, const char *file);
+// Virtual tables of the module "siard", converted when queried
+extern int IDA_siard2sqlite_vtab(const char*, struct sqlite3*, const char*);
+extern void IDA_siard_vtab_set_cache_size(unsigned long long bytes);
 
 #define SQLBUFFSIZE 4096*2
 static void sqlite_shell_init(){
@@ -2657,6 +2862,50 @@ static void sqlite_shell_init(){
     }
 }
 
+// Load the rows selected by the conversion options (see "siard preview") of the
+// tables of a siard file into the sqlite3 database, and print them table by table
+static int siard_preview(const char *siardarg, const char *filter) {
+    char realsiard[PATH_MAX];
+    if (!realpath(siardarg, realsiard)) {
+        fprintf(stderr, "File '%s' not found\n", siardarg);
+        return -1;
+    }
+    sqlite_shell_init();
+    char cmd[SQLBUFFSIZE];
+    strcpy(cmd, ".open :memory:");
+    IDA_SQLITE_do_meta_command(cmd);
+    if (IDA_siard2sqlite_db(realsiard, IDA_SQLITE_get_db(), filter)) {
+        fprintf(stderr, "Error loading SIARD\n");
+        return -1;
+    }
+
+    // Tables in creation order, one per line
+    char *tables = IDA_SQLITE_query_text(
+        "SELECT group_concat(name, char(10)) FROM (SELECT name FROM sqlite_schema"
+        " WHERE type = 'table' AND name NOT LIKE 'sqlite\\_%' ESCAPE '\\'"
+        " AND name NOT LIKE '\\_ida\\_%' ESCAPE '\\' ORDER BY rowid);");
+    if (!tables) return 0; // No tables
+    char *name = tables;
+    while (*name) {
+        char *eol = strchr(name, '\n');
+        if (eol) *eol = '\0';
+        // Quote the name as an SQL identifier
+        int n = snprintf(cmd, SQLBUFFSIZE, "SELECT * FROM \"");
+        for (char *c = name; *c && n < SQLBUFFSIZE - 4; c++) {
+            if (*c == '"') cmd[n++] = '"';
+            cmd[n++] = *c;
+        }
+        snprintf(cmd + n, SQLBUFFSIZE - n, "\";");
+        printf("\n%s:\n", name);
+        fflush(stdout);
+        IDA_SQLITE_shell_exec(cmd);
+        if (!eol) break;
+        name = eol + 1;
+    }
+    free(tables);
+    return 0;
+}
+
 static void help_sqlite(int argc, char *argv[]) {
     printf("Usage:\n");
     printf("       %s \"<sqlite shell command>\" \n",argv[0]);
@@ -2665,8 +2914,21 @@ static void help_sqlite(int argc, char *argv[]) {
     printf("              # equivalent to \".open :memory:\"\n");
     printf("       %s -- load <sql_file>\n",argv[0]);
     printf("              # equivalent to \".read <sql_file>\"\n");
-    printf("       %s -- loadsiard <siard_file> [schema_filter_regex]\n",argv[0]);
-    printf("              # equivalent to unzip + convert siard->sql + clear + read sql\n");
+    printf("       %s -- loadsiard [-s] [-L] [-M MB] [-C dir] [-n] [options] <siard_file> [schema_filter_regex]\n",argv[0]);
+    printf("              # equivalent to clear + insert siard content directly into sqlite3\n");
+    printf("              # (with --resume the current database is not cleared)\n");
+    printf("              # -s: equivalent to unzip + convert siard->sql + clear + read sql\n");
+    printf("              # -C dir: keep the converted databases in this cache directory (default:\n");
+    printf("              #     $%s if set), and restore them from there when loaded again\n", SIARD_DB_CACHE_ENV);
+    printf("              # -n: do not use the cache of converted databases\n");
+    printf("              # -L: do not load the tables, but create virtual tables (module 'siard')\n");
+    printf("              #     that convert each table when it is queried for the first time\n");
+    printf("              # -M MB: keep up to MB megabytes of tables converted by virtual tables (default 256)\n");
+    help_siard_options();
+    printf("       %s -- snapshot save <db_file>\n",argv[0]);
+    printf("              # save the current database to a sqlite3 database file\n");
+    printf("       %s -- snapshot restore <db_file>\n",argv[0]);
+    printf("              # replace the current database with a copy in memory of a database file\n");
     printf("       %s -- tables\n",argv[0]);
     printf("              # equivalent to \"ANALYZE main; select * from sqlite_stat1;\"\n");
     printf("              # this shows non-empty tables; a table with multiple indexed may appear once per index\"\n");
@@ -2703,20 +2965,95 @@ static int main_sqlite(int argc, char *argv[]) {
             IDA_SQLITE_do_meta_command(buff);
         }
         else if (!strcmp(argv[2], "loadsiard")){
-            if (argc < 3) {
+            // Options before the siard file
+            int opt_via_sql = 0; // -s: convert to a temporary SQL file and read it (slower)
+            int opt_lazy = 0; // -L: create virtual tables converted when queried
+            char *cachedir = getenv(SIARD_DB_CACHE_ENV); // -C dir, -n: cache of converted databases
+            int ia = 3;
+            while (argv[ia] && argv[ia][0] == '-') {
+                int optok = parse_siard_option(argv, &ia); // Conversion options (-j N, -b, ...)
+                if (optok > 0 && !strcmp(argv[ia], "-s")) {
+                    opt_via_sql = 1;
+                    ia++;
+                } else if (optok > 0 && !strcmp(argv[ia], "-C") && argv[ia+1]) {
+                    cachedir = argv[ia+1];
+                    ia += 2;
+                } else if (optok > 0 && !strcmp(argv[ia], "-n")) {
+                    cachedir = NULL;
+                    ia++;
+                } else if (optok > 0 && !strcmp(argv[ia], "-L")) {
+                    opt_lazy = 1;
+                    ia++;
+                } else if (optok > 0 && !strcmp(argv[ia], "-M") && argv[ia+1] && atol(argv[ia+1]) >= 0) {
+                    IDA_siard_vtab_set_cache_size((unsigned long long) atol(argv[ia+1]) << 20);
+                    ia += 2;
+                } else if (optok) {
+                    reset_siard_options();
+                    help_sqlite(argc, argv);
+                    return -1;
+                }
+            }
+            if (!argv[ia]) {
+                reset_siard_options();
                 help_sqlite(argc, argv);
                 return -1;
             }
+            char *siardarg = argv[ia];
+            char *filter = ""; // To be get as parameter
+            if (argv[ia+1]) filter = argv[ia+1];
 
             // Get realpath for siard file and, current dir 
             char realsiard[PATH_MAX], currwd[PATH_MAX];
-            char *rl = realpath(argv[3], realsiard);
+            char *rl = realpath(siardarg, realsiard);
             if (!rl) {
-                fprintf(stderr, "File '%s' not found\n", argv[3]);
+                fprintf(stderr, "File '%s' not found\n", siardarg);
+                reset_siard_options();
                 return -1;
             }
+
+            if (opt_lazy) {
+                // Reset current sqlite state and create a virtual table for each
+                // siard table, which is converted when queried for the first time
+                fprintf(stderr, "\n");
+                fprintf(stderr, "Cleaning sqlite3 engine and attaching SIARD ...\n");
+                snprintf(buff, SQLBUFFSIZE, ".open :memory:");
+                IDA_SQLITE_do_meta_command(buff);
+                int sqlerr = IDA_siard2sqlite_vtab(realsiard, IDA_SQLITE_get_db(), filter);
+                reset_siard_options();
+                if (sqlerr) {
+                    fprintf(stderr, "Error attaching SIARD\n");
+                    return -1;
+                }
+                fprintf(stderr, "done\n");
+                return 0;
+            }
+
+            if (!opt_via_sql) {
+                // Reset current sqlite state and insert the siard content
+                // directly into it (no intermediate SQL file)
+                fprintf(stderr, "\n");
+                if (siard_opt_resume) {
+                    // Continue loading into the current database
+                    fprintf(stderr, "Resuming the load of SIARD ...\n");
+                } else {
+                    fprintf(stderr, "Cleaning sqlite3 engine and loading SIARD ...\n");
+                    snprintf(buff, SQLBUFFSIZE, ".open :memory:");
+                    IDA_SQLITE_do_meta_command(buff);
+                }
+                IDA_siard2sql_set_db_cache(cachedir);
+                int sqlerr = IDA_siard2sqlite_db(realsiard, IDA_SQLITE_get_db(), filter);
+                IDA_siard2sql_set_db_cache(NULL);
+                reset_siard_options();
+                if (sqlerr) {
+                    fprintf(stderr, "Error loading SIARD\n");
+                    return -1;
+                }
+                fprintf(stderr, "done\n");
+                return 0;
+            }
+
             char *wd = getcwd(currwd, PATH_MAX);
-            if (!wd) return -1;
+            if (!wd) { reset_siard_options(); return -1; }
             
             // Create tmp dir, chdir to it and unzip siard
             #define TMPDIR_SIARD2SQL "_roaesh_ld_siard_tmp_" 
@@ -2736,15 +3073,14 @@ static int main_sqlite(int argc, char *argv[]) {
                 // Convert siard -> sql
                 fprintf(stderr, "\n");
                 fprintf(stderr, "Converting to SQL ...\n");
-                char *filter = ""; // To be get as parameter
-                if (argv[4]) filter = argv[4];
-                unlink(sqlfile);
+                if (!siard_opt_resume) unlink(sqlfile); // Kept to resume its conversion
                 int sqlerr = 1;
                 //if (!trydir) {
                 //    sqlerr = IDA_siard2sql(tmpdir, sqlfile, filter);
                 //} else {
                     // Perhaps is a dir with an already unzipped siard
                     sqlerr = IDA_siard2sql(realsiard, sqlfile, filter);
+                    reset_siard_options();
                 //}
                 if (sqlerr) {
                     int d_ = chdir(wd);
@@ -2754,6 +3090,7 @@ static int main_sqlite(int argc, char *argv[]) {
             }
             else {
                 fprintf(stderr, "Unable to change to temporary directory '%s'\n", tmpdir);
+                reset_siard_options();
                 return -1;
             }
 
@@ -2772,6 +3109,18 @@ static int main_sqlite(int argc, char *argv[]) {
 
             fprintf(stderr, "done\n");
         }
+        else if (!strcmp(argv[2], "snapshot")){
+            if (argc < 5 || (strcmp(argv[3], "save") && strcmp(argv[3], "restore"))) {
+                help_sqlite(argc, argv);
+                return -1;
+            }
+            if (!strcmp(argv[3], "save")) {
+                if (IDA_sqlite_snapshot_save(IDA_SQLITE_get_db(), argv[4])) return -1;
+            } else if (IDA_sqlite_snapshot_restore(IDA_SQLITE_get_db(), argv[4])) {
+                fprintf(stderr, "Cannot restore database '%s'\n", argv[4]);
+                return -1;
+            }
+        }
         else if (!strcmp(argv[2], "tables")){
             strcpy(buff, "ANALYZE main; select * from sqlite_stat1 order by cast(stat as integer);");
             IDA_SQLITE_shell_exec(buff);
@@ -2810,6 +3159,31 @@ extern char* IDA_ROAE_eval_command(long nc, char *buff, long buffsize, char *val
 extern char**IDA_ROAE_command_bind_list(long nc, char *values[], ...);
 extern char* IDA_ROAE_command_bind_list_to_sqlite(char *bind_list[]);
 
+// Set the projection of the siard conversions (option -R) from the SQL bodies
+// of the commands of the loaded roae file
+// Return 0 if OK, -1 if no roae file is loaded
+static int set_projection_from_roae() {
+    long ncommands = IDA_ROAE_count();
+    if (ncommands <= 0) {
+        fprintf(stderr, "No roae file loaded to get the tables and columns to convert (use 'roae load')\n");
+        return -1;
+    }
+    size_t len = 0;
+    char *sql = NULL;
+    for (long nc = 0; nc < ncommands; nc++) {
+        char *body = IDA_ROAE_eval_command(nc, NULL, 0, NULL); // With '?' for the parameters
+        if (!body) continue;
+        char *p = realloc(sql, len + strlen(body) + 3);
+        if (!p) { free(body); free(sql); return -1; }
+        sql = p;
+        len += sprintf(sql + len, "%s;\n", body);
+        free(body);
+    }
+    IDA_siard2sql_set_projection_sql(sql);
+    free(sql);
+    return 0;
+}
+
 #define ROAEBUFFSIZE (1024*16)
 #define FREEARGS(args)  do{long i=0; if (args){ while(args[i]){free(args[i]);i++;}; free(args);}}while(0)
 
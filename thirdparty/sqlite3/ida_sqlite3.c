@@ -20,6 +20,10 @@
   int IDA_SQLITE_run(char *cmd);
   // Run an sequence of internal or SQL commands separated by "\n" (without blanks) 
   int IDA_SQLITE_run_sequence(char *cmd);
+  // Get the handle of the database currently open in the shell
+  struct sqlite3 *IDA_SQLITE_get_db();
+  // Get the first column of the first row of a query as a string (free() it)
+  char *IDA_SQLITE_query_text(const char *sql);
   
   // Include sqlite3 shell stuff w/o main routine
   #ifndef main 
@@ -30,11 +34,16 @@
 
   static ShellState IDA_SQLITE_data;
 
+  // Virtual table module "siard" of libsiard2sql (weak, so that this file can be linked without it)
+  extern int IDA_siard_vtab_init(sqlite3 *db, char **errmsg, const sqlite3_api_routines *api) __attribute__((weak));
+
   void IDA_SQLITE_shell_init()
   {
     ShellState *s = &IDA_SQLITE_data;
     main_init(s);
     s->out = stdout;
+    // Register the module "siard" in every database opened by the shell
+    if (IDA_siard_vtab_init) sqlite3_auto_extension((void (*)(void)) IDA_siard_vtab_init);
   }
 
   // Run an internal sqlite command, that is, those that start with "."
@@ -50,6 +59,36 @@
     return rc;
   }
 
+  // Get the handle of the database currently open in the shell (opening
+  // it if needed), so that it can be accessed through the sqlite3 C API
+  struct sqlite3 *IDA_SQLITE_get_db()
+  {
+    ShellState *s = &IDA_SQLITE_data;
+    open_db(s, 0);
+    return s->db;
+  }
+
+  // Run a query on the database currently open in the shell, and return the first
+  // column of the first row as a string that must be free()'d; NULL if error
+  // or no rows (the query is not printed, unlike IDA_SQLITE_shell_exec())
+  char *IDA_SQLITE_query_text(const char *sql)
+  {
+    ShellState *s = &IDA_SQLITE_data;
+    sqlite3_stmt *stmt = NULL;
+    char *text = NULL;
+    open_db(s, 0);
+    if (sqlite3_prepare_v2(s->db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+      utf8_printf(stderr, "Error: %s\n", sqlite3_errmsg(s->db));
+      return NULL;
+    }
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+      const char *t = (const char *) sqlite3_column_text(stmt, 0);
+      text = strdup(t ? t : "");
+    }
+    sqlite3_finalize(stmt);
+    return text;
+  }
+
   // Run an SQL command
   int IDA_SQLITE_shell_exec(char *cmd) {
     char *cmd_dup = strdup(cmd); // Duplicate as it can be modified when parsed
@@ -24,6 +24,8 @@ unzFile get_open_zip_by_name(const char* zipname, int *open);
 void IDA_ZIP_add_open_zip(unzFile uf, const char* zipname);
 extern void IDA_ZIP_add_file_to_index(unzFile uf, const char* filename, unz_file_pos pos);
 extern int IDA_ZIP_get_file_pos(unzFile uf, const char *filename, unz_file_pos *pos);
+extern long IDA_ZIP_create_index(unzFile uf, const char *zipname);
+extern int IDA_ZIP_extract_parallel(const char *zipname, int njobs);
 void IDA_ZIP_remove_open_zip(unzFile uf);
 void IDA_ZIP_add_zip_pending_to_close(unzFile uf);
 unzFile IDA_ZIP_get_zip_pending_to_close();
@@ -31,7 +33,7 @@ long IDA_ZIP_get_zip_number_of_entries(unzFile uf);
 void IDA_ZIP_print_index(unzFile uf);
 
 // Prototypes for this file
-static int IDA_miniunz_create_index(unzFile uf);
+static int IDA_miniunz_create_index(unzFile uf, const char *zipfilename);
 static void IDA_miniunz_close(unzFile uf);
 static unzFile IDA_miniunz_open_indexed(const char *zipfilename);
 static int IDA_miniunz_do_extract_onefile_indexed(unzFile uf, const char *filename, int opt_extract_without_path, int opt_overwrite, const char *password);
@@ -39,6 +41,143 @@ static unzFile IDA_miniunz_open(const char *zipfilename);
 static void IDA_miniunz_close_indexed(unzFile uf);
 static int IDA_miniunz_do_extract(unzFile uf, int opt_extract_without_path, int opt_overwrite, const char *password);
 
+// An ioapi (zlib_filefunc64_def) reading the zip from a read-only memory mapping
+// of the whole file, so that seeking and reading headers and compressed data do not
+// need system calls. If the file cannot be mapped (or mmap() is not available, as in
+// ivm64) it is read with stdio, like the default ioapi
+
+#ifndef __ivm64__
+#define IDA_MINIUNZ_MMAP
+#include <sys/mman.h>
+#endif
+
+typedef struct {
+    const unsigned char *base;  // Mapping of the file (NULL if read with f)
+    ZPOS64_T size;
+    ZPOS64_T pos;
+    FILE *f;
+} ida_mmap_file;
+
+static voidpf ZCALLBACK ida_mmap_open64(voidpf opaque, const void *filename, int mode)
+{
+    (void) opaque;
+    if (!filename || (mode & ZLIB_FILEFUNC_MODE_READWRITEFILTER) != ZLIB_FILEFUNC_MODE_READ) {
+        return NULL; // Only reading
+    }
+    ida_mmap_file *mf = (ida_mmap_file*) calloc(1, sizeof(ida_mmap_file));
+    if (!mf) return NULL;
+#ifdef IDA_MINIUNZ_MMAP
+    int fd = open((const char*) filename, O_RDONLY);
+    if (fd < 0) {
+        free(mf);
+        return NULL;
+    }
+    struct stat st;
+    if (!fstat(fd, &st) && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m != MAP_FAILED) {
+            mf->base = (const unsigned char*) m;
+            mf->size = st.st_size;
+        }
+    }
+    close(fd);
+    if (mf->base) return mf;
+#endif
+    mf->f = FOPEN_FUNC((const char*) filename, "rb");
+    if (!mf->f) {
+        free(mf);
+        return NULL;
+    }
+    return mf;
+}
+
+static uLong ZCALLBACK ida_mmap_read(voidpf opaque, voidpf stream, void *buf, uLong size)
+{
+    (void) opaque;
+    ida_mmap_file *mf = (ida_mmap_file*) stream;
+    if (!mf->base) return (uLong) fread(buf, 1, size, mf->f);
+    if (mf->pos >= mf->size) return 0;
+    if (size > mf->size - mf->pos) size = (uLong)(mf->size - mf->pos);
+    memcpy(buf, mf->base + mf->pos, size);
+    mf->pos += size;
+    return size;
+}
+
+static uLong ZCALLBACK ida_mmap_write(voidpf opaque, voidpf stream, const void *buf, uLong size)
+{
+    (void) opaque; (void) stream; (void) buf; (void) size;
+    return 0; // Read-only
+}
+
+static ZPOS64_T ZCALLBACK ida_mmap_tell64(voidpf opaque, voidpf stream)
+{
+    (void) opaque;
+    ida_mmap_file *mf = (ida_mmap_file*) stream;
+    if (!mf->base) return (ZPOS64_T) FTELLO_FUNC(mf->f);
+    return mf->pos;
+}
+
+static long ZCALLBACK ida_mmap_seek64(voidpf opaque, voidpf stream, ZPOS64_T offset, int origin)
+{
+    (void) opaque;
+    ida_mmap_file *mf = (ida_mmap_file*) stream;
+    if (!mf->base) {
+        int whence = (origin == ZLIB_FILEFUNC_SEEK_CUR) ? SEEK_CUR : (origin == ZLIB_FILEFUNC_SEEK_END) ? SEEK_END : SEEK_SET;
+        return FSEEKO_FUNC(mf->f, offset, whence) ? -1 : 0;
+    }
+    ZPOS64_T newpos;
+    switch (origin) {
+    case ZLIB_FILEFUNC_SEEK_CUR: newpos = mf->pos + offset; break;
+    case ZLIB_FILEFUNC_SEEK_END: newpos = mf->size + offset; break;
+    case ZLIB_FILEFUNC_SEEK_SET: newpos = offset; break;
+    default: return -1;
+    }
+    if (newpos > mf->size) return -1;
+    mf->pos = newpos;
+    return 0;
+}
+
+static int ZCALLBACK ida_mmap_close(voidpf opaque, voidpf stream)
+{
+    (void) opaque;
+    ida_mmap_file *mf = (ida_mmap_file*) stream;
+    int ret = 0;
+#ifdef IDA_MINIUNZ_MMAP
+    if (mf->base) munmap((void*) mf->base, mf->size);
+#endif
+    if (mf->f) ret = fclose(mf->f);
+    free(mf);
+    return ret;
+}
+
+static int ZCALLBACK ida_mmap_error(voidpf opaque, voidpf stream)
+{
+    (void) opaque;
+    ida_mmap_file *mf = (ida_mmap_file*) stream;
+    return mf->f ? ferror(mf->f) : 0;
+}
+
+void fill_mmap_filefunc64(zlib_filefunc64_def *pzlib_filefunc_def)
+{
+    pzlib_filefunc_def->zopen64_file = ida_mmap_open64;
+    pzlib_filefunc_def->zread_file = ida_mmap_read;
+    pzlib_filefunc_def->zwrite_file = ida_mmap_write;
+    pzlib_filefunc_def->ztell64_file = ida_mmap_tell64;
+    pzlib_filefunc_def->zseek64_file = ida_mmap_seek64;
+    pzlib_filefunc_def->zclose_file = ida_mmap_close;
+    pzlib_filefunc_def->zerror_file = ida_mmap_error;
+    pzlib_filefunc_def->opaque = NULL;
+}
+
+// Open a zip to read it with the mmap-backed ioapi
+unzFile IDA_miniunz_unzOpen(const char *zipfilename)
+{
+    zlib_filefunc64_def ffunc;
+    fill_mmap_filefunc64(&ffunc);
+    return unzOpen2_64(zipfilename, &ffunc);
+}
+
+
 // Public functions (to be used in libsiardunzip.c)
 
 // Close all pending open zips and remove from the cache
@@ -83,6 +222,230 @@ int IDA_miniunz_do_unzip(const char *zipfilename, char* filename)
     return err;
 }
 
+// Unzip a full zip file with up to njobs threads (see IDA_ZIP_extract_parallel()
+// in ida_miniunz_utils.cpp); it is extracted sequentially if njobs <= 1
+// Return 0 if ok
+int IDA_miniunz_do_unzip_parallel(const char *zipfilename, int njobs)
+{
+    if (njobs <= 1) {
+        return IDA_miniunz_do_unzip(zipfilename, NULL);
+    }
+    return IDA_ZIP_extract_parallel(zipfilename, njobs);
+}
+
+// Extract the current file of an open zip (used by the threads of IDA_ZIP_extract_parallel(),
+// each one with its own descriptor), overwriting it if it exists
+int IDA_miniunz_extract_current(unzFile uf)
+{
+    int opt_extract_without_path = 0;
+    int opt_overwrite = 1;
+    return do_extract_currentfile(uf, &opt_extract_without_path, &opt_overwrite, NULL);
+}
+
+// Create a directory and its parents (see miniunz.c)
+void IDA_miniunz_makedir(const char *dirname)
+{
+    makedir(dirname);
+}
+
+// Open one file inside a zip to read it sequentially with IDA_miniunz_read_entry(),
+// without extracting it to disk
+// The position of the file is taken from the index of the (cached) open zip,
+// but the entry is read with its own descriptor, so that other files can be extracted
+// from the same zip meanwhile
+// Return NULL if the file cannot be found or opened
+unzFile IDA_miniunz_open_entry(const char *zipfilename, const char *filename)
+{
+    unzFile uf_index = IDA_miniunz_open_indexed(zipfilename);
+    if (!uf_index) return NULL;
+
+    unz_file_pos pos;
+    int err = IDA_ZIP_get_file_pos(uf_index, filename, &pos);
+    IDA_miniunz_close_indexed(uf_index);
+    if (err) return NULL;
+
+    unzFile uf = IDA_miniunz_unzOpen(zipfilename);
+    if (!uf) return NULL;
+
+    // Check the name, as the index may not have the file
+    char filename_inzip[UNZ_MAXFILENAMEINZIP + 1];
+    err = unzGoToFilePos(uf, &pos);
+    if (err == UNZ_OK) {
+        err = unzGetCurrentFileInfo64(uf, NULL, filename_inzip, sizeof(filename_inzip) - 1, NULL, 0, NULL, 0);
+    }
+    if (err == UNZ_OK && strcmp(filename_inzip, filename)) {
+        err = UNZ_END_OF_LIST_OF_FILE;
+    }
+    if (err == UNZ_OK) {
+        err = unzOpenCurrentFile(uf);
+    }
+    if (err != UNZ_OK) {
+        unzClose(uf);
+        return NULL;
+    }
+    return uf;
+}
+
+// Read up to len bytes from a file opened by IDA_miniunz_open_entry()
+// Return the number of bytes read, 0 at the end of the file, or <0 if error
+long IDA_miniunz_read_entry(unzFile uf, char *buf, long len)
+{
+    return unzReadCurrentFile(uf, buf, len);
+}
+
+// Close a file opened by IDA_miniunz_open_entry()
+// Return UNZ_OK, or the error of unzCloseCurrentFile() (e.g., UNZ_CRCERROR if the
+// file was fully read but its CRC-32 does not match)
+int IDA_miniunz_close_entry(unzFile uf)
+{
+    int err = UNZ_OK;
+    if (uf) {
+        err = unzCloseCurrentFile(uf);
+        unzClose(uf);
+    }
+    return err;
+}
+
+
+
+// Inflate one file of a zip in memory, without extracting it to disk: the callback
+// fn(ctx, buf, n) is called with each chunk of n inflated bytes, and it must return
+// 0 to go on, or != 0 to stop
+// The file is located with the index of the (cached) open zip, which is also used to
+// read it, so the zip is neither reopened nor its directory traversed for each file
+// Return the number of bytes inflated, or <0 if error (file not found, corrupted
+// or stopped by the callback)
+long IDA_miniunz_extract_entry_cb(const char *zipfilename, const char *filename,
+                                  int (*fn)(void *ctx, const char *buf, long n), void *ctx)
+{
+    unzFile uf = IDA_miniunz_open_indexed(zipfilename);
+    if (!uf) return UNZ_ERRNO;
+
+    unz_file_pos pos;
+    char filename_inzip[UNZ_MAXFILENAMEINZIP + 1];
+    int err = IDA_ZIP_get_file_pos(uf, filename, &pos);
+    if (err == UNZ_OK) {
+        err = unzGoToFilePos(uf, &pos);
+    }
+    if (err == UNZ_OK) {
+        err = unzGetCurrentFileInfo64(uf, NULL, filename_inzip, sizeof(filename_inzip) - 1, NULL, 0, NULL, 0);
+    }
+    // Check the name, as the index may not have the file
+    if (err == UNZ_OK && strcmp(filename_inzip, filename)) {
+        err = UNZ_END_OF_LIST_OF_FILE;
+    }
+    if (err == UNZ_OK) {
+        err = unzOpenCurrentFile(uf);
+    }
+    if (err != UNZ_OK) {
+        IDA_miniunz_close_indexed(uf);
+        return err < 0 ? err : UNZ_ERRNO;
+    }
+
+    char buf[WRITEBUFFERSIZE];
+    long total = 0;
+    long n;
+    while ((n = unzReadCurrentFile(uf, buf, sizeof(buf))) > 0) {
+        if (fn(ctx, buf, n)) {
+            n = UNZ_INTERNALERROR;
+            break;
+        }
+        total += n;
+    }
+    // unzCloseCurrentFile() checks the CRC once the file is fully read
+    err = unzCloseCurrentFile(uf);
+    IDA_miniunz_close_indexed(uf);
+    if (n < 0) return n;
+    if (err != UNZ_OK) return err;
+    return total;
+}
+
+// Check if one file of a zip is STORED (not compressed nor encrypted); if so, set
+// 'offset' to the position of its bytes in the zip file and 'size' to its length,
+// so that they can be read straight from the zip file, without inflating them
+// The file is located with the index of the (cached) open zip
+// Return 0 if the file is stored, 1 if it is compressed, or <0 if error
+int IDA_miniunz_entry_range(const char *zipfilename, const char *filename,
+                            unsigned long long *offset, unsigned long long *size)
+{
+    unzFile uf = IDA_miniunz_open_indexed(zipfilename);
+    if (!uf) return UNZ_ERRNO;
+
+    unz_file_pos pos;
+    unz_file_info64 file_info;
+    char filename_inzip[UNZ_MAXFILENAMEINZIP + 1];
+    int err = IDA_ZIP_get_file_pos(uf, filename, &pos);
+    if (err == UNZ_OK) {
+        err = unzGoToFilePos(uf, &pos);
+    }
+    if (err == UNZ_OK) {
+        err = unzGetCurrentFileInfo64(uf, &file_info, filename_inzip, sizeof(filename_inzip) - 1, NULL, 0, NULL, 0);
+    }
+    if (err == UNZ_OK && strcmp(filename_inzip, filename)) {
+        err = UNZ_END_OF_LIST_OF_FILE;
+    }
+    if (err == UNZ_OK && (file_info.compression_method != 0 || (file_info.flag & 1)
+                          || file_info.compressed_size != file_info.uncompressed_size)) {
+        IDA_miniunz_close_indexed(uf);
+        return 1;
+    }
+    // Opening the file reads its local header, which gives where its bytes start
+    if (err == UNZ_OK) {
+        err = unzOpenCurrentFile(uf);
+    }
+    if (err == UNZ_OK) {
+        *offset = unzGetCurrentFileZStreamPos64(uf);
+        *size = file_info.uncompressed_size;
+        unzCloseCurrentFile(uf);
+    }
+    IDA_miniunz_close_indexed(uf);
+    return err < 0 ? err : (err == UNZ_OK ? 0 : UNZ_ERRNO);
+}
+
+struct IDA_miniunz_buffer {
+    char *buf;
+    long size;
+    long len;
+};
+
+static int IDA_miniunz_to_buffer(void *ctx, const char *buf, long n)
+{
+    struct IDA_miniunz_buffer *b = (struct IDA_miniunz_buffer*)ctx;
+    if (n > b->size - b->len) return 1;
+    memcpy(b->buf + b->len, buf, n);
+    b->len += n;
+    return 0;
+}
+
+// Inflate one file of a zip into the buffer buf of size bytes (see IDA_miniunz_extract_entry_cb())
+// Return the number of bytes written, or <0 if error (also if the file does not fit in the buffer)
+long IDA_miniunz_extract_entry(const char *zipfilename, const char *filename, char *buf, long size)
+{
+    struct IDA_miniunz_buffer b = {buf, size, 0};
+    return IDA_miniunz_extract_entry_cb(zipfilename, filename, IDA_miniunz_to_buffer, &b);
+}
+
+// Get the CRC-32 and the uncompressed size of one file inside a zip, as recorded
+// in the central directory (the file is neither extracted nor inflated)
+// Return 0 if ok, or an error if the zip cannot be opened or the file is not found
+int IDA_miniunz_entry_info(const char *zipfilename, const char *filename, unsigned long *crc, unsigned long long *size)
+{
+    unzFile uf = IDA_miniunz_unzOpen(zipfilename);
+    if (!uf) return UNZ_ERRNO;
+
+    unz_file_info64 file_info;
+    int err = unzLocateFile(uf, filename, 1);
+    if (err == UNZ_OK) {
+        err = unzGetCurrentFileInfo64(uf, &file_info, NULL, 0, NULL, 0, NULL, 0);
+    }
+    if (err == UNZ_OK) {
+        if (crc) *crc = file_info.crc;
+        if (size) *size = file_info.uncompressed_size;
+    }
+    unzClose(uf);
+    return err;
+}
+
 
 
 // Static private functions (not to be used outside this file)
@@ -97,7 +460,7 @@ static unzFile IDA_miniunz_open(const char *zipfilename)
         strncpy(filename_try, zipfilename, MAXFILENAME-1);
         /* strncpy doesnt append the trailing NULL, if the string is too long. */
         filename_try[MAXFILENAME] = '\0';
-        uf = unzOpen64(zipfilename);
+        uf = IDA_miniunz_unzOpen(zipfilename);
     }
 
     if (uf==NULL) {
@@ -125,7 +488,7 @@ static unzFile IDA_miniunz_open_indexed(const char *zipfilename){
     if (uf) {
         // TODO: check errors
         IDA_ZIP_add_open_zip(uf, zipfilename); // Add to open zipfile cache
-        IDA_miniunz_create_index(uf); // Create its index
+        IDA_miniunz_create_index(uf, zipfilename); // Create its index
 
         printf("File '%s' open and indexed: found %ld entries\n", zipfilename, IDA_ZIP_get_zip_number_of_entries(uf));
         // Debugging
@@ -187,8 +550,14 @@ static int IDA_miniunz_do_extract_onefile_indexed(unzFile uf, const char *filena
 }
 // Traverse all the files in one open zip, and add a pair (filename,position)
 // to the index of such an open zip
-static int IDA_miniunz_create_index(unzFile uf)
+// The central directory is scanned at once by IDA_ZIP_create_index(); the files
+// are only traversed one by one with minizip if that is not possible
+static int IDA_miniunz_create_index(unzFile uf, const char *zipfilename)
 {
+    if (IDA_ZIP_create_index(uf, zipfilename) >= 0) {
+        return UNZ_OK;
+    }
+
     long c=0;
     int err = unzGoToFirstFile(uf);
     while (err == UNZ_OK)
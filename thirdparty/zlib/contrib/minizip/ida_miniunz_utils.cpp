@@ -12,20 +12,241 @@
 
 #include <iostream>
 #include <string>
+#include <vector>
 #include <queue>
 #include <set>
+#include <map>
 #include <regex>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "unzip.h"
 
+#ifndef UNZ_MAXFILENAMEINZIP
+#define UNZ_MAXFILENAMEINZIP (256)
+#endif
+
+// Zips can be extracted by several threads (see IDA_ZIP_extract_parallel())
+// Threads are not available on ivm64
+#if !defined(__ivm64__) && !defined(IDA_NO_THREADS)
+#define IDA_THREADS
+#include <thread>
+#endif
+
+// From ida_miniunz.c
+extern "C" int IDA_miniunz_do_unzip(const char *zipfilename, char *filename);
+extern "C" int IDA_miniunz_extract_current(unzFile uf);
+extern "C" unzFile IDA_miniunz_unzOpen(const char *zipfilename);
+extern "C" void IDA_miniunz_makedir(const char *dirname);
+
 using namespace std;
 
 namespace IDA {
 
     // This index is a dictionary with pairs (filename, position)
     // There must be an index for each open zip
+    //
+    // Entries are kept in an array, with their names one after another in a single
+    // buffer, and looked up by an open-addressing hash table (linear probing, kept
+    // at most half full) of entry numbers. The entries and names can be written to
+    // and read from a file as plain arrays (see save()/load())
     class IDA_ZIP_index {
-        map<string, unz_file_pos> zipindex;
+        struct entry {
+            uint64_t name;       // Offset of the name in 'names'
+            uint32_t len;        // Length of the name
+            uint32_t hash;
+            unz_file_pos pos;
+        };
+        vector<entry> entries;
+        string names;
+        vector<uint32_t> slots;  // Entry number plus 1 (0 if the slot is empty)
+
+        // Header of an index saved to a file; the index is only valid for the
+        // same zip (same size, modification time and central directory offset)
+        struct file_header {
+            char magic[8];
+            uint64_t zip_size;
+            int64_t zip_mtime;
+            int64_t zip_mtime_ns;
+            uint64_t cd_offset;
+            uint64_t nentries;
+            uint64_t names_size;
+        };
+
+        static uint32_t hash(const char *s, unsigned long n) {
+            // FNV-1a
+            uint32_t h = 2166136261U;
+            for (unsigned long k = 0; k < n; k++) {
+                h = (h ^ (unsigned char)s[k]) * 16777619U;
+            }
+            return h;
+        }
+
+        // Slot where the name is, or the empty slot where it would be inserted
+        uint32_t &find(const char *s, unsigned long n, uint32_t h) {
+            unsigned long mask = slots.size() - 1;
+            for (unsigned long i = h & mask; ; i = (i + 1) & mask) {
+                uint32_t &slot = slots[i];
+                if (!slot) return slot;
+                const entry &e = entries[slot - 1];
+                if (e.hash == h && e.len == n && !memcmp(names.data() + e.name, s, n)) return slot;
+            }
+        }
+
+        void rehash(unsigned long nslots) {
+            slots.assign(nslots, 0);
+            unsigned long mask = nslots - 1;
+            for (unsigned long k = 0; k < entries.size(); k++) {
+                unsigned long i = entries[k].hash & mask;
+                while (slots[i]) i = (i + 1) & mask;
+                slots[i] = k + 1;
+            }
+        }
+
+    public:
+        // Prepare the index for n entries (so that it is not rehashed while filling it)
+        void reserve(unsigned long n, unsigned long names_size = 0) {
+            unsigned long nslots = 16;
+            while (nslots < 2*n) nslots *= 2;
+            entries.reserve(n);
+            names.reserve(names_size);
+            if (nslots > slots.size()) rehash(nslots);
+        }
+
+        void add(const char *s, unsigned long n, unz_file_pos pos) {
+            if (2*(entries.size() + 1) > slots.size()) reserve(2*(entries.size() + 1));
+            uint32_t h = hash(s, n);
+            uint32_t &slot = find(s, n, h);
+            if (!slot) {
+                entry e;
+                e.name = names.size();
+                e.len = n;
+                e.hash = h;
+                names.append(s, n);
+                entries.push_back(e);
+                slot = entries.size();
+            }
+            entries[slot - 1].pos = pos;
+        }
+
+        // Return 0 if found, 1 otherwise
+        int get(const char *s, unsigned long n, unz_file_pos *pos) {
+            if (slots.empty()) return 1;
+            uint32_t slot = find(s, n, hash(s, n));
+            if (!slot) return 1;
+            *pos = entries[slot - 1].pos;
+            return 0;
+        }
+
+        unsigned long size() const { return entries.size(); }
+
+        void clear() {
+            entries.clear();
+            names.clear();
+            slots.clear();
+        }
+
+        // Call fn(name, len, pos) for each entry (in the order they were added)
+        template <typename F>
+        void for_each(F fn) const {
+            for (auto &e: entries) {
+                fn(names.data() + e.name, e.len, e.pos);
+            }
+        }
+
+        // Save the index of the zip 'zipname' (whose central directory starts
+        // at 'cd_offset') to 'file'; it is written to a temporary file which is renamed
+        // Return 0 if ok
+        int save(const string &file, const string &zipname, uint64_t cd_offset) const {
+            file_header h;
+            if (make_header(h, zipname, cd_offset)) return -1;
+            h.nentries = entries.size();
+            h.names_size = names.size();
+
+            string tmpfile = file + ".tmpXXXXXX";
+            vector<char> tmpname(tmpfile.begin(), tmpfile.end());
+            tmpname.push_back('\0');
+            int fd = mkstemp(tmpname.data());
+            if (fd < 0) return -1;
+            fchmod(fd, 0644); // mkstemp() creates it only readable by the owner
+            bool ok = write_all(fd, (const char*)&h, sizeof(h))
+                      && write_all(fd, (const char*)entries.data(), entries.size()*sizeof(entry))
+                      && write_all(fd, names.data(), names.size());
+            ok = !close(fd) && ok;
+            if (ok) ok = !rename(tmpname.data(), file.c_str());
+            if (!ok) unlink(tmpname.data());
+            return ok ? 0 : -1;
+        }
+
+        // Load the index saved in 'file' if it was built from this very zip
+        // Return 0 if ok, -1 if not found or not valid
+        int load(const string &file, const string &zipname, uint64_t cd_offset) {
+            file_header h, k;
+            if (make_header(k, zipname, cd_offset)) return -1;
+            int fd = open(file.c_str(), O_RDONLY);
+            if (fd < 0) return -1;
+            struct stat st;
+            bool ok = read_all(fd, (char*)&h, sizeof(h))
+                      && !memcmp(h.magic, k.magic, sizeof(h.magic))
+                      && h.zip_size == k.zip_size && h.zip_mtime == k.zip_mtime
+                      && h.zip_mtime_ns == k.zip_mtime_ns && h.cd_offset == k.cd_offset
+                      && h.nentries < (1UL << 31) && !fstat(fd, &st)
+                      && (uint64_t)st.st_size == sizeof(h) + h.nentries*sizeof(entry) + h.names_size;
+            if (ok) {
+                clear();
+                entries.resize(h.nentries);
+                names.resize(h.names_size);
+                ok = read_all(fd, (char*)entries.data(), h.nentries*sizeof(entry))
+                     && read_all(fd, &names[0], h.names_size);
+                for (auto &e: entries) {
+                    if (e.name + e.len > names.size()) ok = false;
+                }
+                if (ok) reserve(entries.size());
+                else clear();
+            }
+            close(fd);
+            return ok ? 0 : -1;
+        }
+
+    private:
+        static int make_header(file_header &h, const string &zipname, uint64_t cd_offset) {
+            struct stat st;
+            if (stat(zipname.c_str(), &st)) return -1;
+            memset(&h, 0, sizeof(h));
+            memcpy(h.magic, "S2SZIDX1", sizeof(h.magic));
+            h.zip_size = st.st_size;
+            h.zip_mtime = st.st_mtime;
+        #ifndef __ivm64__
+            h.zip_mtime_ns = st.st_mtim.tv_nsec;
+        #endif
+            h.cd_offset = cd_offset;
+            return 0;
+        }
+
+        static bool write_all(int fd, const char *p, unsigned long n) {
+            while (n > 0) {
+                long w = write(fd, p, n);
+                if (w <= 0) return false;
+                p += w; n -= w;
+            }
+            return true;
+        }
+
+        static bool read_all(int fd, char *p, unsigned long n) {
+            while (n > 0) {
+                long r = read(fd, p, n);
+                if (r <= 0) return false;
+                p += r; n -= r;
+            }
+            return true;
+        }
+
         friend class IDA_ZIP_opentable;
     };
 
@@ -65,18 +286,108 @@ namespace IDA {
         // This index is a dictionary with pairs (filename, position)
         void add_file_pos(unzFile uf, const string &filename, unz_file_pos pos) {
             try {
-                ZT.at(uf).zipindex[filename] = pos;
+                ZT.at(uf).add(filename.data(), filename.size(), pos);
             } catch (...) {
                 // TODO: show error message or something
             }
         }
 
+        // Build the index of an open zip with one raw scan of its central directory,
+        // which is read at once, instead of calling unzGetCurrentFileInfo64() per entry
+        // If 'persist', the index is loaded from (or saved to) the file "<zipname>.zidx"
+        // Return the number of entries, or -1 if the zip cannot be scanned this way
+        long create_index(unzFile uf, const string &zipname, bool persist) {
+            IDA_ZIP_index *zindex;
+            try {
+                zindex = &ZT.at(uf);
+            } catch (...) {
+                return -1;
+            }
+
+            unz_global_info64 gi;
+            if (unzGetGlobalInfo64(uf, &gi) != UNZ_OK) return -1;
+            if (gi.number_entry == 0) return 0;
+            if (unzGoToFirstFile(uf) != UNZ_OK) return -1;
+            uint64_t cd_offset = unzGetOffset64(uf);
+
+            string index_file = zipname + ".zidx";
+            if (persist && !zindex->load(index_file, zipname, cd_offset)) {
+                if (zindex->size() == gi.number_entry && check_index(uf, *zindex)) return zindex->size();
+                zindex->clear();
+            }
+
+            vector<unsigned char> cd;
+            if (!read_central_directory(zipname, cd_offset, cd)) return -1;
+
+            // Central directory file header: signature 0x02014b50 and 46 bytes
+            // with the lengths of the name, extra field and comment at offsets 28, 30, 32
+            auto u16 = [&](uint64_t o) { return (unsigned long)cd[o] | ((unsigned long)cd[o+1] << 8); };
+            zindex->reserve(gi.number_entry, cd.size());
+            uint64_t off = 0;
+            for (uint64_t k = 0; k < gi.number_entry; k++) {
+                if (off + 46 > cd.size()
+                    || cd[off] != 0x50 || cd[off+1] != 0x4b || cd[off+2] != 0x01 || cd[off+3] != 0x02) {
+                    zindex->clear();
+                    return -1;
+                }
+                unsigned long namelen = u16(off + 28);
+                uint64_t reclen = 46 + namelen + u16(off + 30) + u16(off + 32);
+                if (off + reclen > cd.size()) {
+                    zindex->clear();
+                    return -1;
+                }
+                unz_file_pos pos;
+                pos.pos_in_zip_directory = cd_offset + off;
+                pos.num_of_file = k;
+                zindex->add((const char*)&cd[off + 46], namelen, pos);
+                off += reclen;
+            }
+
+            if (!check_index(uf, *zindex)) {
+                zindex->clear();
+                return -1;
+            }
+            if (persist) zindex->save(index_file, zipname, cd_offset);
+            return zindex->size();
+        }
+
+        // Read the central directory of a zip, which starts at 'cd_offset' (and the end
+        // records following it, up to the end of the file)
+        static bool read_central_directory(const string &zipname, uint64_t cd_offset, vector<unsigned char> &cd) {
+            FILE *f = fopen(zipname.c_str(), "rb");
+            if (!f) return false;
+            bool ok = !fseek(f, 0, SEEK_END);
+            long end = ok ? ftell(f) : -1;
+            ok = end > 0 && (uint64_t)end > cd_offset && !fseek(f, cd_offset, SEEK_SET);
+            if (ok) {
+                cd.resize(end - cd_offset);
+                ok = fread(cd.data(), 1, cd.size(), f) == cd.size();
+            }
+            fclose(f);
+            return ok;
+        }
+
+    private:
+        // Check that the index agrees with minizip for the first entry of the zip
+        bool check_index(unzFile uf, IDA_ZIP_index &zindex) {
+            bool ok = false;
+            char name[UNZ_MAXFILENAMEINZIP + 1];
+            unz_file_pos pos, p;
+            if (unzGoToFirstFile(uf) == UNZ_OK && unzGetFilePos(uf, &pos) == UNZ_OK
+                && unzGetCurrentFileInfo64(uf, NULL, name, sizeof(name) - 1, NULL, 0, NULL, 0) == UNZ_OK) {
+                ok = !zindex.get(name, strlen(name), &p)
+                     && p.pos_in_zip_directory == pos.pos_in_zip_directory && p.num_of_file == pos.num_of_file;
+            }
+            unzGoToFirstFile(uf);
+            return ok;
+        }
+
+    public:
         // Get the index position in the zip associated to a filename
         // Return 0 if OK, or an error code otherwise
-        int get_file_pos(unzFile uf, const string &filename, unz_file_pos *pos) {
+        int get_file_pos(unzFile uf, const char *filename, unz_file_pos *pos) {
             try {
-                *pos = ZT.at(uf).zipindex[filename];
-                return 0;
+                return ZT.at(uf).get(filename, strlen(filename), pos);
             } catch (...) {
                 // TODO: show error message or something
             }
@@ -114,7 +425,7 @@ namespace IDA {
         // Return the number of files in the ZIP index, for an open zip file
         long get_zip_number_of_entries(unzFile uf) {
             try {
-                return  ZT.at(uf).zipindex.size();
+                return  ZT.at(uf).size();
             } catch (...) {
             }
             return 0;
@@ -122,17 +433,15 @@ namespace IDA {
 
         // Debugging function, print the ZIP index for an open zip file
         void print_zip_index(unzFile uf, long limit=0) {
-            cout << "Index has " << ZT.at(uf).zipindex.size() << " entries" << endl;
+            cout << "Index has " << ZT.at(uf).size() << " entries" << endl;
             if (limit > 0){
                 cout << "Showing the first " << limit << " ones:" << endl;
             }
             long c = 0;
-            for (auto i = ZT.at(uf).zipindex.begin(); i != ZT.at(uf).zipindex.end(); i++) {
-                cout << i->first << " \t\t\t" << i->second.num_of_file << endl;
-                if (limit > 0)
-                    if (c++ > limit)
-                        break;
-            }
+            ZT.at(uf).for_each([&](const char *name, unsigned long len, unz_file_pos pos) {
+                if (limit > 0 && c++ > limit) return;
+                cout << string(name, len) << " \t\t\t" << pos.num_of_file << endl;
+            });
         }
     };
 
@@ -148,6 +457,8 @@ extern "C" {
 
     // Global Table of open zips
     static IDA_ZIP_opentable Z;
+    // Save the index of open zips next to them (see IDA_ZIP_set_persistent_index())
+    static int IDA_ZIP_persistent_index = 0;
 
     // Get the descriptor of an open zip present in the table
     unzFile get_open_zip_by_name(const char* zipname, int *open) {
@@ -165,6 +476,142 @@ extern "C" {
         Z.add_file_pos(uf, filename, pos);
     }
 
+    // Build the index of an open zip scanning its central directory at once
+    // Return the number of entries, or -1 if it could not be built this way
+    long IDA_ZIP_create_index(unzFile uf, const char *zipname) {
+        return Z.create_index(uf, zipname, IDA_ZIP_persistent_index);
+    }
+
+    // Enable (or disable) saving the index of each zip to "<zip>.zidx" when it is
+    // first built, and loading it from there next times (if the zip did not change)
+    void IDA_ZIP_set_persistent_index(int enable) {
+        IDA_ZIP_persistent_index = enable;
+    }
+
+    // Write to 'hex' (at least 33 chars) a digest of the content of a zip, computed from
+    // its central directory, which has the name, size and CRC-32 of every file (so the
+    // whole zip is not read): 64-bit FNV-1a and CRC-32 of the directory, and its length
+    // Return 0 if ok, -1 if the zip cannot be read
+    int IDA_ZIP_digest(const char *zipname, char *hex, int n) {
+        if (n < 33) return -1;
+        unzFile uf = IDA_miniunz_unzOpen(zipname);
+        if (!uf) return -1;
+        unz_global_info64 gi;
+        bool ok = (unzGetGlobalInfo64(uf, &gi) == UNZ_OK) && gi.number_entry > 0
+                  && (unzGoToFirstFile(uf) == UNZ_OK);
+        uint64_t cd_offset = ok ? unzGetOffset64(uf) : 0;
+        unzClose(uf);
+        vector<unsigned char> cd;
+        if (!ok || !IDA_ZIP_opentable::read_central_directory(zipname, cd_offset, cd)) return -1;
+
+        uint64_t fnv = 14695981039346656037ULL;
+        for (unsigned char c: cd) {
+            fnv = (fnv ^ c) * 1099511628211ULL;
+        }
+        unsigned long crc = crc32(0L, cd.data(), cd.size());
+        snprintf(hex, n, "%016llx%08lx%08lx", (unsigned long long)fnv, crc & 0xffffffffUL,
+                 (unsigned long)(cd.size() & 0xffffffffUL));
+        return 0;
+    }
+
+    // Extract all the files of a zip to the current directory with up to 'njobs'
+    // threads, each one with its own descriptor of the zip. Directories are created
+    // first; then files are split among threads by their compressed size (each file
+    // to the thread with the smallest load so far, from the largest file to the smallest),
+    // and every thread extracts its files in the order they are in the zip
+    // Without threads (e.g., ivm64) the zip is extracted sequentially
+    // Return 0 if ok, or the first error found
+    int IDA_ZIP_extract_parallel(const char *zipname, int njobs) {
+    #ifndef IDA_THREADS
+        return IDA_miniunz_do_unzip(zipname, NULL);
+    #else
+        struct job {
+            unz_file_pos pos;
+            uint64_t csize;
+        };
+        vector<job> jobs;
+
+        unzFile uf = IDA_miniunz_unzOpen(zipname);
+        if (!uf) {
+            fprintf(stderr, "Path '%s' cannot be unzipped\n", zipname);
+            return UNZ_ERRNO;
+        }
+        set<string> dirs;
+        int err = unzGoToFirstFile(uf);
+        while (err == UNZ_OK) {
+            char name[UNZ_MAXFILENAMEINZIP + 1];
+            unz_file_info64 info;
+            job j;
+            err = unzGetCurrentFileInfo64(uf, &info, name, sizeof(name) - 1, NULL, 0, NULL, 0);
+            if (err == UNZ_OK) err = unzGetFilePos(uf, &j.pos);
+            if (err != UNZ_OK) break;
+
+            // Create the directories now, so that threads do not race to create them
+            string dir(name);
+            size_t slash = dir.find_last_of("/\\");
+            bool isdir = (slash != string::npos && slash == dir.size() - 1);
+            dir = (slash == string::npos) ? "" : dir.substr(0, slash);
+            if (!dir.empty() && dirs.insert(dir).second) IDA_miniunz_makedir(dir.c_str());
+            if (!isdir) {
+                j.csize = info.compressed_size;
+                jobs.push_back(j);
+            }
+            err = unzGoToNextFile(uf);
+        }
+        unzClose(uf);
+        if (err != UNZ_END_OF_LIST_OF_FILE) {
+            fprintf(stderr, "Error %d reading the directory of '%s'\n", err, zipname);
+            return err;
+        }
+
+        // Split the files among threads by compressed size
+        unsigned long nthreads = std::min<unsigned long>(njobs, jobs.size());
+        if (nthreads < 1) return UNZ_OK;
+        vector<vector<unz_file_pos>> work(nthreads);
+        vector<uint64_t> load(nthreads, 0);
+        vector<unsigned long> bysize(jobs.size());
+        for (unsigned long k = 0; k < jobs.size(); k++) bysize[k] = k;
+        std::stable_sort(bysize.begin(), bysize.end(),
+                         [&](unsigned long a, unsigned long b) { return jobs[a].csize > jobs[b].csize; });
+        for (unsigned long k: bysize) {
+            unsigned long t = std::min_element(load.begin(), load.end()) - load.begin();
+            work[t].push_back(jobs[k].pos);
+            load[t] += jobs[k].csize + 1;
+        }
+        for (auto &w: work) {
+            std::sort(w.begin(), w.end(),
+                      [](const unz_file_pos &a, const unz_file_pos &b) { return a.num_of_file < b.num_of_file; });
+        }
+
+        vector<int> errs(nthreads, UNZ_OK);
+        vector<std::thread> threads;
+        for (unsigned long t = 0; t < nthreads; t++) {
+            threads.emplace_back([&, t]() {
+                unzFile tuf = IDA_miniunz_unzOpen(zipname);
+                if (!tuf) {
+                    errs[t] = UNZ_ERRNO;
+                    return;
+                }
+                for (auto &pos: work[t]) {
+                    int e = unzGoToFilePos(tuf, &pos);
+                    if (e == UNZ_OK) e = IDA_miniunz_extract_current(tuf);
+                    if (e != UNZ_OK) {
+                        errs[t] = e;
+                        break;
+                    }
+                }
+                unzClose(tuf);
+            });
+        }
+        for (auto &th: threads) th.join();
+
+        for (int e: errs) {
+            if (e != UNZ_OK) return e;
+        }
+        return UNZ_OK;
+    #endif
+    }
+
     // Get the index position in the zip associated to a filename
     // Return 0 if OK, or an error code otherwise
     int IDA_ZIP_get_file_pos(unzFile uf, const char *filename, unz_file_pos *pos) {